@@ -53,6 +53,7 @@ public:
 	static void			yield(); // Why do users need this?
 	static void			sleep(int milliseconds); // Why do users need this?
 	static unsigned		num_hardware_threads(); // Why is this needed?
+	uint64_t			select_retries() const; // Times worker threads backed off while choosing a service
 
 private:
 	struct implementation;
@@ -0,0 +1,98 @@
+// This source file is part of marbles library.
+//
+// Copyright (c) 2023 Dan Cobban
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// --------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <application/service.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// --------------------------------------------------------------------------------------------------------------------
+namespace marbles
+{
+
+// --------------------------------------------------------------------------------------------------------------------
+// Service provider that keeps memory within a budget. A timer thread owned by the provider calls memory::collect() 
+// every interval and sleeps in between, registered pools are trimmed when usage rises toward the budget. No work is 
+// posted to the application's worker threads. The previous budget is restored when the service is destroyed.
+//   app.start<memory_service>(512 * mb);
+class memory_service
+{
+public:
+	static const int default_interval_ms = 100;
+
+	memory_service(size_t budget, int interval_ms = default_interval_ms)
+	: _interval(Max(1, interval_ms))
+	, _pressure(memory_pressure::none)
+	, _collections(0)
+	, _previous_budget(memory::budget())
+	, _stopping(false)
+	{
+		memory::set_budget(budget);
+		std::thread timer([this]() { this->run(); });
+		_timer.swap(timer);
+	}
+
+	~memory_service()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stopping = true;
+		}
+		_wake.notify_one();
+		_timer.join();
+		memory::set_budget(_previous_budget);
+	}
+
+	memory_pressure	pressure() const	{ return _pressure.load(); }	// Level seen by the last collection
+	uint32_t		collections() const	{ return _collections.load(); }
+
+private:
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		while (!_wake.wait_for(lock, _interval, [this]() { return _stopping; }))
+		{
+			lock.unlock();
+			_pressure.store(memory::collect());
+			++_collections;
+			lock.lock();
+		}
+	}
+
+	std::chrono::milliseconds	_interval;
+	atomic<memory_pressure>		_pressure;
+	atomic<uint32_t>			_collections;
+	size_t						_previous_budget;
+	bool						_stopping;	// Guarded by _mutex
+	std::mutex					_mutex;
+	std::condition_variable		_wake;
+	std::thread					_timer;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+} // namespace marbles
+
+// End of file --------------------------------------------------------------------------------------------------------
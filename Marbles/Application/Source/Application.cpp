@@ -24,6 +24,7 @@
 #include <application\application.h>
 #include <application\service.h>
 #include <common\common.h>
+#include <common\backoff.h>
 #include <chrono>
 #include <thread>
 #include <mutex>
@@ -48,6 +49,8 @@ struct application::implementation
 	typedef application*				ActiveApplication;
 	typedef vector<weak_service>		service_list;
 	typedef vector<thread>		        thread_list;
+	typedef exponential_backoff<>		select_backoff;	// Contention on _next_service between worker threads
+	typedef park_backoff<>				idle_backoff;	// Every service is busy, wait for one to be queued
 
 	implementation()
 	: _next_service(0)
@@ -61,6 +64,7 @@ struct application::implementation
 	thread_list                             _threads;
 
 	atomic<unsigned>                        _next_service;
+	retry_counter                           _select_retries;
 	int                                     _run_result;
 
 	thread_local static ActiveApplication	sApplication;
@@ -153,6 +157,12 @@ void application::yield()
 	this_thread::yield();
 }
 
+// --------------------------------------------------------------------------------------------------------------------
+uint64_t application::select_retries() const
+{
+	return _implementation->_select_retries.load();
+}
+
 // --------------------------------------------------------------------------------------------------------------------
 void application::sleep(int milliseconds)
 {
@@ -214,17 +224,24 @@ shared_service application::select_service()
 	const size_t size = application->_services.size();
 	if (0 != size)
 	{
+		implementation::select_backoff select_backoff;
+		implementation::idle_backoff idle_backoff;
 		do
 		{
 			unsigned int next = 0;
 			unsigned int index = 0;
-			do 
+			for (;;)
 			{	
 				index = application->_next_service.load();
 				next = (index + 1) % size;
 				ASSERT(index != next); // Ensures that 2 <= mServiceList.size()
+				if (application->_next_service.compare_exchange_strong(index, next))
+				{
+					break;
+				}
 				// try again if another _thread has changed the value before me 
-			} while (!application->_next_service.compare_exchange_strong(index, next));
+				select_backoff();
+			}
 
 			service::execution_state state = service::queued;
 			candidate = application->_services[index].lock();
@@ -242,10 +259,12 @@ shared_service application::select_service()
 			selected = accepted || exit;
 			if (yield)
 			{
-				application::yield();
+				idle_backoff();
 			}
 			// If the service is valid and is being processed then pick another.
 		} while(!selected);
+		application->_select_retries.record(select_backoff);
+		application->_select_retries.record(idle_backoff);
 	}
 	ASSERT(!candidate || service::queued != candidate->_state.load());
 	return candidate;
@@ -24,114 +24,260 @@
 #pragma once
 
 #include <Common/Common.h>
+#include <Common/AtomicEpoch.h>
 #include <Common/AtomicList.h>
+#include <Common/AtomicTagged.h>
+#include <Common/Backoff.h>
+#include <Common/VirtualMemory.h>
+#include <new>
 
 // --------------------------------------------------------------------------------------------------------------------
 namespace marbles
 {
 
 // --------------------------------------------------------------------------------------------------------------------
-template<size_t block_size = 64>
+template<size_t block_size = 64, int32_t magazine_size = 32, typename Backoff = pause_backoff>
+class magazine_allocator;
+
+// --------------------------------------------------------------------------------------------------------------------
+// Lock-free pool of fixed size blocks. Blocks are carved from slabs aligned to slab_size so that a block can find 
+// its slab, slabs are returned to the Slabs source only once every block in them is free. Threads popping the free 
+// list are pinned with atomic_epoch, released slabs are retired and handed back to the Slabs source once no pop can
+// still be reading them. An allocator must not be destroyed by a thread holding an atomic_epoch::guard.
+// Backoff is applied when a compare and swap on the free list fails
+template<size_t block_size = 64, typename Backoff = pause_backoff, typename Slabs = heap_slabs>
 class block_allocator
 {
+protected:
+	union block_t;
+	struct slab_t;
+
 public:
+	static constexpr size_t page_size = 4 * kb;
+	static constexpr size_t slab_size = page_size < block_size * 8 ? block_size * 8 : page_size;
+
     block_allocator() 
     : _free(nullptr)
+    , _slabs(nullptr)
+    , _reserved(0)
     , _outstanding(0)
+    , _peak(0)
+    , _reserve_calls(0)
+    , _failed(0)
+    , _releasing(false)
+    , _retiring(0)
     {
     }
 
     ~block_allocator()
     {
         ASSERT(_outstanding == 0);
-        release();
+        while (0 < _retiring.load())
+        {	// Wait for released slabs to be reclaimed
+            atomic_epoch::collect();
+            this_thread::yield();
+        }
+
+        slab_t* slab = _slabs.exchange(nullptr);
+        while (nullptr != slab)
+        {
+            slab_t* next = slab->_next.load();
+            free_slab(slab);
+            slab = next;
+        }
     }
 
-    // Can a block be allocated
+    block_allocator(const block_allocator&) = delete;
+    block_allocator& operator=(const block_allocator&) = delete;
+
+    // Can a block be allocated, blocks held by a release in progress are counted as they are about to return
     bool can_allocate() const 
     {
-        return nullptr != _free.load();
+        return nullptr != _free.load().ptr || _releasing.load();
     }
 
-	// Total number of blocks available for allocation
+	// Total number of blocks available for allocation, approximate while other threads allocate
     int32_t num_available() const
     {
-		int32_t count = 0;
-		block_t* head = nullptr;
-		do {
-			count = 0;
-			head = _free.load();
-			block_t* next = head;
-			while (nullptr != next)
-			{
-                ++count;
-				next = next->_next.load();
-			}
-		} while (head != _free.load()); // Another thread changed the free list
-
-		return count;
+		return Max(0, _reserved.load(std::memory_order_relaxed) - _outstanding.load(std::memory_order_relaxed));
     }
 
     // Total number of blocks managed by this allocator
     int32_t num_reserved() const
     {
-        return num_available() + _outstanding.load();
+        return _reserved.load(std::memory_order_relaxed);
+    }
+
+    // Number of blocks allocated and not yet freed
+    int32_t num_outstanding() const
+    {
+        return _outstanding.load(std::memory_order_relaxed);
+    }
+
+    // Counters are maintained as blocks move so polling is O(1)
+    allocator_stats stats() const
+    {
+        allocator_stats out;
+        out.reserved = num_reserved();
+        out.outstanding = num_outstanding();
+        out.available = Max(0, out.reserved - out.outstanding);
+        out.peak_outstanding = _peak.load(std::memory_order_relaxed);
+        out.reserve_calls = _reserve_calls.load(std::memory_order_relaxed);
+        out.failed_allocations = _failed.load(std::memory_order_relaxed);
+        out.retries = retries();
+        return out;
+    }
+
+    // Number of times the free list has backed off due to contention
+    uint64_t retries() const
+    {
+        return _retries.load();
     }
 
-    // Increases the number of blocks available for allocation
+    // Increases the number of blocks available for allocation, rounded up to whole slabs
     bool reserve(int32_t count)
     {
-		allocator<int8_t> blockAllocator;
-        block_t* block = nullptr;
-        do { 
-			block = reinterpret_cast<block_t*>(blockAllocator.allocate(sizeof(block_t)));
+        _reserve_calls.fetch_add(1, std::memory_order_relaxed);
+        do {
+            slab_t* slab = allocate_slab();
+            if (nullptr == slab)
+            {
+                return false;
+            }
 
-            push_block(block);
-            if (nullptr != block)
+            // Chain the slab's blocks together then publish them with a single exchange
+            block_t* first = slab->block(0);
+            for (int32_t i = 1; i < blocks_per_slab; ++i)
             {
-                count = count - 1;
+                slab->block(i - 1)->_next.store(slab->block(i), std::memory_order_relaxed);
             }
-        } while (nullptr != block && 0 != count);
+            _reserved.fetch_add(blocks_per_slab, std::memory_order_relaxed);
+            push_blocks(first, slab->block(blocks_per_slab - 1));
+            count -= blocks_per_slab;
+        } while (0 < count);
 
-        return nullptr != block;
+        return true;
     }
 
-    // Release the number of given blocks or release all blocks in reserve
-    // @param count     release on 'count' number of buffers. if count <= 0 all buffers are removed.
-    // @return          number of buffers released from the pool
+    // Release whole slabs in which every block is free, slabs are returned to the Slabs source once no thread
+    // popping the free list can reference them
+    // @param count     release at most 'count' blocks. if count <= 0 all free slabs are released.
+    // @return          number of blocks released from the pool
     int32_t release(int32_t count = 0) 
     {
-		allocator<int8_t> blockAllocator;
-        int32_t pop_count = 0;
+        if (0 < count && count < blocks_per_slab)
+        {	// Less than a slab can never be released
+            return 0;
+        }
+        if (_releasing.exchange(true))
+        {	// Releasing is opportunistic, another thread is already doing it
+            return 0;
+        }
+
+        // Take every free block so none can be allocated from a slab while it is being inspected, allocations wait
+        // for them to be returned rather than fail
+        block_t* drained = _free.exchange(nullptr);
+        for (block_t* block = drained; nullptr != block; block = block->_next.load())
+        {
+            ++slab_t::of(block)->_drained;
+        }
+
+        // Unlink slabs that are entirely free, new slabs are only ever pushed onto the head of _slabs. An unlinked 
+        // slab keeps its link so a concurrent owns() standing on it still reaches the rest of the list, the pin keeps 
+        // retired slabs from being reclaimed before their blocks are filtered out below
+        atomic_epoch::guard pin;
+        int32_t release_count = 0;
+        slab_t* prev = nullptr;
+        slab_t* slab = _slabs.load();
+        while (nullptr != slab)
+        {
+            slab_t* next = slab->_next.load();
+            const bool within_count = 0 >= count || release_count + blocks_per_slab <= count;
+            if (blocks_per_slab == slab->_drained && within_count && unlink_slab(prev, slab))
+            {
+                slab->_drained = released_marker;
+                _retiring.fetch_add(1);
+                atomic_epoch::retire(slab, &reclaim_slab);
+                release_count += blocks_per_slab;
+            }
+            else
+            {
+                prev = slab;
+            }
+            slab = next;
+        }
+
+        // Return blocks of the remaining slabs to the free list
         block_t* head = nullptr;
-        do 
+        block_t* tail = nullptr;
+        while (nullptr != drained)
         {
-            head = pop_block();
-            if (nullptr != head)
+            block_t* block = drained;
+            drained = block->_next.load();
+            slab_t* owner = slab_t::of(block);
+            if (released_marker != owner->_drained)
             {
-                --count;
-				++pop_count;
-				blockAllocator.deallocate(reinterpret_cast<int8_t*>(head), sizeof(block_t));
+                owner->_drained = 0;
+                block->_next.store(head);
+                tail = nullptr == head ? block : tail;
+                head = block;
             }
-        } while (nullptr != head && 0 != count);
+        }
+        push_blocks(head, tail);
+        _reserved.fetch_sub(release_count, std::memory_order_relaxed);
+
+        _releasing.store(false);
+        return release_count;
+    }
+
+    // Was the block carved from one of this allocator's slabs, O(slabs)
+    bool owns(const void* block) const
+    {
+        atomic_epoch::guard pin;
+        const slab_t* owner = slab_t::of(reinterpret_cast<block_t*>(const_cast<void*>(block)));
+        for (const slab_t* slab = _slabs.load(); nullptr != slab; slab = slab->_next.load())
+        {
+            if (owner == slab)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Allocate uninitialized memory for one block, blocks are aligned to block_size
+    void* allocate_block()
+    {
+        block_t* head = pop_block();
+        count_allocated(nullptr != head ? 1 : 0);
+        return head;
+    }
+
+    // Return a block previously returned by allocate_block
+    bool free_block(void* block)
+    {
+        if (nullptr != block)
+        {
+            ASSERT(owns(block)); // Block was not allocated by this allocator
+			_outstanding.fetch_sub(1, std::memory_order_relaxed);
 
-        return pop_count;
+            block_t* blockItem = reinterpret_cast<block_t*>(block);
+            push_blocks(blockItem, blockItem);
+        }
+	    return nullptr != block;
     }
 
     // Allocate a new object from the pool 
-    template<typename T, typename ...args> T* allocate(args...)
+    template<typename T, typename ...Args> T* allocate(Args&&... args)
     {
         STATIC_ASSERT(sizeof(T) <= block_size);
-        block_t* head = pop_block();
-        if (nullptr != head)
+        T* out = reinterpret_cast<T*>(allocate_block());
+        if (nullptr != out)
         {
-            ++_outstanding;
 			allocator<T> tAllocator;
-            T* out = reinterpret_cast<T*>(head);
-            allocator_traits<allocator<T>>::construct(tAllocator, out, args...);
-            return out;
+            allocator_traits<allocator<T>>::construct(tAllocator, out, forward<Args>(args)...);
         }
-        return nullptr;
+        return out;
     }
 
     // Free the given pointer to the pool
@@ -141,18 +287,13 @@ public:
         {
 			allocator<T> tAllocator;
             allocator_traits<allocator<T>>::destroy(tAllocator, item);
-			--_outstanding;
-
-            // TODO: Validate that this block was previously owned by the allocator?
-            block_t* blockItem = reinterpret_cast<block_t*>(item);
-            push_block(blockItem);
         }
-	    return nullptr != item;
+	    return free_block(item);
     }
 
 protected:
+	template<size_t, int32_t, typename> friend class magazine_allocator;
 
-	static const size_t page_size = 4 * kb;
 	static_assert(block_size <= (page_size >> 1), "Blocks must be smaller than the page size. (BLOCK_SIZE <= (page_size >> 1)");
 	static_assert(0 == page_size % block_size, "page_size must be be divisable by BLOCK_SIZE (0 == page_size % BLOCK_SIZE)");
 	union block_t
@@ -161,29 +302,454 @@ protected:
 		ubyte_t _block[block_size];
 	};
 
+	// Header placed in the first blocks of every slab, the retired hook is used once the slab is released
+	struct slab_t : public atomic_epoch::retired
+	{
+		atomic<slab_t*>		_next;	// Written by release while owns() may be walking the list
+		int32_t				_drained; // Free blocks counted while releasing, guarded by _releasing
+		block_allocator*	_owner;
+
+		block_t* block(int32_t index)
+		{
+			return reinterpret_cast<block_t*>(reinterpret_cast<ubyte_t*>(this) + header_size) + index;
+		}
+
+		static slab_t* of(block_t* block)
+		{
+			return reinterpret_cast<slab_t*>(reinterpret_cast<uintptr_t>(block) & ~(slab_size - 1));
+		}
+	};
+
+	static constexpr size_t header_size = ((sizeof(slab_t) + block_size - 1) / block_size) * block_size;
+	static constexpr int32_t released_marker = -1;
+
+public:
+	// Number of blocks added by each slab reserved
+	static constexpr int32_t blocks_per_slab = static_cast<int32_t>((slab_size - header_size) / block_size);
+
+protected:
+
+    slab_t* allocate_slab()
+    {
+        void* memory = _source.allocate(slab_size, slab_size);
+        if (nullptr == memory)
+        {
+            return nullptr;
+        }
+
+        slab_t* slab = new (memory) slab_t();
+        slab->_drained = 0;
+        slab->_owner = this;
+        slab_t* head = _slabs.load();
+        do {
+            slab->_next.store(head);
+        } while (!_slabs.compare_exchange_weak(head, slab));
+        return slab;
+    }
+
+    void free_slab(slab_t* slab)
+    {
+        slab->~slab_t();
+        _source.deallocate(slab, slab_size, slab_size);
+    }
+
+    static void reclaim_slab(atomic_epoch::retired* item)
+    {
+        slab_t* slab = static_cast<slab_t*>(item);
+        block_allocator* owner = slab->_owner;
+        owner->free_slab(slab);
+        owner->_retiring.fetch_sub(1);
+    }
+
+    // Only called while _releasing is held, reserve can concurrently push onto the head
+    bool unlink_slab(slab_t* prev, slab_t* slab)
+    {
+        if (nullptr != prev)
+        {
+            prev->_next.store(slab->_next.load());
+            return true;
+        }
+        slab_t* expected = slab;
+        return _slabs.compare_exchange_strong(expected, slab->_next.load());
+    }
+
+    // Record count blocks leaving the free list, no blocks means the allocation failed
+    void count_allocated(int32_t count)
+    {
+        if (0 == count)
+        {
+            _failed.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        const int32_t outstanding = _outstanding.fetch_add(count, std::memory_order_relaxed) + count;
+        int32_t peak = _peak.load(std::memory_order_relaxed);
+        while (peak < outstanding && !_peak.compare_exchange_weak(peak, outstanding, std::memory_order_relaxed)) {}
+    }
+
     block_t* pop_block()
     {
-		block_t* head = nullptr;
-		do {
-			head = _free.load();
-		} while (nullptr != head && !_free.compare_exchange_weak(head, head->_next.load()));
-        return head;
+		atomic_epoch::guard pin;
+		return pop_pinned();
     }
 
-    void push_block(block_t* block)
+    // Pop a chain of up to max blocks under a single pin, one block at a time. Only the head's link is read before
+    // it is popped, a block behind the head may be popped and written by its new owner at any moment.
+    // @param count     number of blocks in the returned chain
+    block_t* pop_blocks(int32_t max, int32_t& count)
     {
-        if (nullptr != block)
+		atomic_epoch::guard pin;
+		block_t* first = nullptr;
+		block_t* last = nullptr;
+		count = 0;
+		while (count < max)
+		{
+			block_t* block = pop_pinned();
+			if (nullptr == block)
+			{
+				break;
+			}
+			if (nullptr == last)
+			{
+				first = block;
+			}
+			else
+			{
+				last->_next.store(block, std::memory_order_relaxed);
+			}
+			last = block;
+			++count;
+		}
+		if (nullptr != last)
+		{
+			last->_next.store(nullptr, std::memory_order_relaxed);
+		}
+        return first;
+    }
+
+    // The caller holds an atomic_epoch::guard
+    block_t* pop_pinned()
+    {	// The tag on _free guards against the head being popped and pushed back between the load and exchange, the 
+		// pin keeps the slab behind head mapped while its link is read
+		Backoff backoff;
+		tagged_ptr<block_t> head = _free.load();
+		for (;;)
+		{
+			if (nullptr == head.ptr)
+			{
+				if (!_releasing.load())
+				{
+					break;
+				}
+				this_thread::yield(); // A release holds the free blocks while it inspects the slabs
+				head = _free.load();
+			}
+			else if (_free.compare_exchange_weak(head, head.ptr->_next.load()))
+			{
+				break;
+			}
+			else
+			{
+				backoff();
+			}
+		}
+		_retries.record(backoff);
+        return head.ptr;
+    }
+
+    // Push the chain of blocks from first to last onto the free list
+    void push_blocks(block_t* first, block_t* last)
+    {
+        if (nullptr != first)
         {
-		    block_t* head = nullptr;
-            do {
-                head = _free.load();
-                block->_next = head;
-            } while (!_free.compare_exchange_weak(head, block));
+		    Backoff backoff;
+		    tagged_ptr<block_t> head = _free.load();
+            last->_next = head.ptr;
+            while (!_free.compare_exchange_weak(head, first))
+            {
+                backoff();
+                last->_next = head.ptr;
+            }
+		    _retries.record(backoff);
 		}
     }
 
-    atomic<block_t*> _free;
+    atomic_tagged_ptr<block_t> _free;
+    atomic<slab_t*> _slabs;
+    atomic<int32_t> _reserved;
     atomic<int32_t> _outstanding;
+    atomic<int32_t> _peak;
+    atomic<uint64_t> _reserve_calls;
+    atomic<uint64_t> _failed;
+    atomic<bool> _releasing;
+    atomic<int32_t> _retiring; // Released slabs waiting to be reclaimed
+    Slabs _source;
+    retry_counter _retries;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// Thread caching front end for block_allocator. Each thread allocates from and frees to its own magazine, a chain of
+// at most magazine_size blocks, and only touches the shared free list to move half a magazine at a time. 
+// Allocations are counted per magazine and summed on demand so there is no shared counter to contend on. Threads 
+// started once every magazine slot is claimed allocate from the shared free list directly.
+template<size_t block_size, int32_t magazine_size, typename Backoff>
+class magazine_allocator
+{
+public:
+	static const int32_t max_threads = 128;
+	static const int32_t batch_size = magazine_size / 2;
+	static_assert(2 <= magazine_size, "Magazines must hold at least two blocks");
+
+	magazine_allocator()
+	: _unslotted(0)
+	{
+		for (auto& magazine : _magazines)
+		{
+			magazine.store(nullptr);
+		}
+	}
+
+	~magazine_allocator()
+	{	// Every thread must be done with the allocator, return cached blocks so the slabs can be released
+		ASSERT(0 == num_outstanding());
+		for (auto& slot : _magazines)
+		{
+			magazine* cache = slot.exchange(nullptr);
+			if (nullptr != cache)
+			{
+				flush(*cache, cache->_count.load());
+				delete cache;
+			}
+		}
+	}
+
+	magazine_allocator(const magazine_allocator&) = delete;
+	magazine_allocator& operator=(const magazine_allocator&) = delete;
+
+	// Can the calling thread allocate a block
+	bool can_allocate() const
+	{
+		const magazine* cache = cached();
+		return (nullptr != cache && 0 != cache->_count.load(std::memory_order_relaxed)) || _shared.can_allocate();
+	}
+
+	// Total number of blocks available in the shared free list and all magazines
+	int32_t num_available() const
+	{
+		int32_t count = _shared.num_available();
+		for (auto& slot : _magazines)
+		{
+			const magazine* cache = slot.load();
+			count += nullptr != cache ? cache->_count.load(std::memory_order_relaxed) : 0;
+		}
+		return count;
+	}
+
+	// Number of blocks allocated and not yet freed
+	int32_t num_outstanding() const
+	{
+		int32_t count = _unslotted.load(std::memory_order_relaxed);
+		for (auto& slot : _magazines)
+		{
+			const magazine* cache = slot.load();
+			count += nullptr != cache ? cache->_outstanding.load(std::memory_order_relaxed) : 0;
+		}
+		return count;
+	}
+
+	// Total number of blocks managed by this allocator
+	int32_t num_reserved() const
+	{
+		return _shared.num_reserved();
+	}
+
+	// Shared pool counters with blocks cached in magazines counted as available, peak_outstanding includes them
+	allocator_stats stats() const
+	{
+		allocator_stats out = _shared.stats();
+		out.available = num_available();
+		out.outstanding = num_outstanding();
+		return out;
+	}
+
+	// Increases the number of blocks available for allocation, rounded up to whole slabs
+	bool reserve(int32_t count)
+	{
+		return _shared.reserve(count);
+	}
+
+	// Release whole slabs that are free, blocks cached in magazines keep their slabs alive
+	int32_t release(int32_t count = 0)
+	{
+		return _shared.release(count);
+	}
+
+	// Return the calling thread's cached blocks to the shared free list
+	void flush()
+	{
+		magazine* cache = cached();
+		if (nullptr != cache)
+		{
+			flush(*cache, cache->_count.load(std::memory_order_relaxed));
+		}
+	}
+
+	// Allocate a new object from the calling thread's magazine
+	template<typename T, typename ...Args> T* allocate(Args&&... args)
+	{
+		STATIC_ASSERT(sizeof(T) <= block_size);
+		magazine* slot = local();
+		if (nullptr == slot)
+		{	// No magazine for this thread
+			T* out = _shared.template allocate<T>(forward<Args>(args)...);
+			_unslotted.fetch_add(nullptr != out ? 1 : 0, std::memory_order_relaxed);
+			return out;
+		}
+
+		magazine& cache = *slot;
+		int32_t count = cache._count.load(std::memory_order_relaxed);
+		if (0 == count)
+		{	// Refill half a magazine from the shared free list
+			cache._head = _shared.pop_blocks(batch_size, count);
+			_shared.count_allocated(count);
+		}
+
+		block_t* block = cache._head;
+		if (nullptr == block)
+		{
+			return nullptr;
+		}
+		cache._head = block->_next.load(std::memory_order_relaxed);
+		cache._count.store(count - 1, std::memory_order_relaxed);
+		cache._outstanding.store(cache._outstanding.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+		allocator<T> tAllocator;
+		T* out = reinterpret_cast<T*>(block);
+		allocator_traits<allocator<T>>::construct(tAllocator, out, forward<Args>(args)...);
+		return out;
+	}
+
+	// Free the given pointer to the calling thread's magazine
+	template<typename T> bool free(T* item)
+	{
+		if (nullptr != item)
+		{
+			allocator<T> tAllocator;
+			allocator_traits<allocator<T>>::destroy(tAllocator, item);
+
+			magazine* slot = local();
+			if (nullptr == slot)
+			{	// No magazine for this thread
+				_unslotted.fetch_sub(1, std::memory_order_relaxed);
+				return _shared.free_block(item);
+			}
+
+			magazine& cache = *slot;
+			if (magazine_size == cache._count.load(std::memory_order_relaxed))
+			{	// Return half a magazine to the shared free list
+				flush(cache, batch_size);
+			}
+
+			block_t* block = reinterpret_cast<block_t*>(item);
+			block->_next.store(cache._head, std::memory_order_relaxed);
+			cache._head = block;
+			cache._count.store(cache._count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			cache._outstanding.store(cache._outstanding.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+		}
+		return nullptr != item;
+	}
+
+private:
+	typedef block_allocator<block_size, Backoff> shared_allocator;
+	typedef typename shared_allocator::block_t block_t;
+	static const int32_t no_slot = -1;
+
+	// Blocks cached for one thread slot, only the thread owning the slot modifies it
+	struct alignas(64) magazine
+	{
+		magazine() : _head(nullptr), _count(0), _outstanding(0) {}
+
+		block_t*			_head;
+		atomic<int32_t>		_count;
+		atomic<int32_t>		_outstanding; // May go negative when blocks are freed by another thread
+	};
+
+	// Per thread index shared by every magazine_allocator, released when the thread exits. A thread that finds 
+	// every slot in use keeps no_slot and bypasses the magazines.
+	struct thread_slot
+	{
+		thread_slot() : _slot(no_slot)
+		{
+			for (int32_t i = 0; no_slot == _slot && i < max_threads; ++i)
+			{
+				bool expected = false;
+				if (claimed()[i].compare_exchange_strong(expected, true))
+				{
+					_slot = i;
+				}
+			}
+		}
+
+		~thread_slot()
+		{	// The next thread to claim the slot inherits its magazines
+			if (no_slot != _slot)
+			{
+				claimed()[_slot].store(false);
+			}
+		}
+
+		static atomic<bool>* claimed() { static atomic<bool> s_claimed[max_threads] = {}; return s_claimed; }
+		static thread_slot& local() { static thread_local thread_slot s_local; return s_local; }
+
+		int32_t _slot;
+	};
+
+	// The calling thread's magazine, created on first use, nullptr when the thread has no slot
+	magazine* local()
+	{
+		const int32_t index = thread_slot::local()._slot;
+		if (no_slot == index)
+		{
+			return nullptr;
+		}
+
+		atomic<magazine*>& slot = _magazines[index];
+		magazine* cache = slot.load(std::memory_order_relaxed);
+		if (nullptr == cache)
+		{
+			cache = new magazine();
+			slot.store(cache);
+		}
+		return cache;
+	}
+
+	// The calling thread's magazine if it has one
+	magazine* cached() const
+	{
+		const int32_t index = thread_slot::local()._slot;
+		return no_slot != index ? _magazines[index].load() : nullptr;
+	}
+
+	// Move count blocks from the front of the magazine to the shared free list
+	void flush(magazine& cache, int32_t count)
+	{
+		if (0 < count)
+		{
+			block_t* first = cache._head;
+			block_t* last = first;
+			for (int32_t i = 1; i < count; ++i)
+			{
+				last = last->_next.load(std::memory_order_relaxed);
+			}
+			cache._head = last->_next.load(std::memory_order_relaxed);
+			cache._count.store(cache._count.load(std::memory_order_relaxed) - count, std::memory_order_relaxed);
+			_shared.push_blocks(first, last);
+			_shared._outstanding.fetch_sub(count, std::memory_order_relaxed);
+		}
+	}
+
+	shared_allocator				_shared;
+	atomic<magazine*>				_magazines[max_threads];
+	atomic<int32_t>					_unslotted; // Blocks allocated by threads without a magazine, may go negative
 };
 
 // --------------------------------------------------------------------------------------------------------------------
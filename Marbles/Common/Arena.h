@@ -0,0 +1,331 @@
+// This source file is part of marbles library.
+//
+// Copyright (c) 2023 Dan Cobban
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// --------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <Common/Common.h>
+#include <memory_resource>
+
+// --------------------------------------------------------------------------------------------------------------------
+namespace marbles
+{
+
+// --------------------------------------------------------------------------------------------------------------------
+// Linear allocator for temporaries that share a lifetime, such as the work of one frame or request. Memory is bumped
+// from chunks and only reclaimed all at once by rewinding to a marker, chunks are kept for reuse until released.
+// Objects made with create() are destroyed in reverse order when they are rewound. Not thread-safe.
+// {
+//   arena scratch;
+//   auto start = scratch.mark();
+//   foo* object = scratch.create<foo>(args...);
+//   scratch.rewind(start); // ~foo() called, memory reused by the next allocation
+// }
+class arena
+{
+	struct chunk;
+	struct destructor;
+
+public:
+	static const size_t default_chunk_size = 64 * kb;
+
+	// Position in the arena to rewind to
+	struct marker
+	{
+		chunk*		_chunk;
+		size_t		_used;
+		destructor*	_destructors;
+	};
+
+	explicit arena(size_t chunk_size = default_chunk_size)
+	: _first(nullptr)
+	, _current(nullptr)
+	, _destructors(nullptr)
+	, _chunk_size(chunk_size)
+	{
+	}
+
+	~arena()
+	{
+		release();
+	}
+
+	arena(const arena&) = delete;
+	arena& operator=(const arena&) = delete;
+
+	void* allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+	{
+		ASSERT(0 != alignment && 0 == (alignment & (alignment - 1)));
+		if (nullptr != _current)
+		{
+			void* out = _current->bump(size, alignment);
+			if (nullptr != out)
+			{
+				return out;
+			}
+		}
+		return allocate_chunk(size, alignment)->bump(size, alignment);
+	}
+
+	// Construct a T in the arena, the destructor is run when the arena is rewound past it
+	template<typename T, typename... Args>
+	T* create(Args&&... args)
+	{
+		T* out = new (allocate(sizeof(T), alignof(T))) T(forward<Args>(args)...);
+		if constexpr (!std::is_trivially_destructible<T>::value)
+		{
+			destructor* entry = new (allocate(sizeof(destructor), alignof(destructor))) destructor();
+			entry->_destroy = [](void* object) { static_cast<T*>(object)->~T(); };
+			entry->_object = out;
+			entry->_next = _destructors;
+			_destructors = entry;
+		}
+		return out;
+	}
+
+	marker mark() const
+	{
+		return marker{ _current, nullptr != _current ? _current->_used : 0, _destructors };
+	}
+
+	// Destroy objects created after the marker and reuse their memory
+	void rewind(const marker& position)
+	{
+		while (_destructors != position._destructors)
+		{
+			ASSERT(nullptr != _destructors);
+			destructor* entry = _destructors;
+			_destructors = entry->_next;
+			entry->_destroy(entry->_object);
+		}
+
+		for (chunk* item = nullptr != position._chunk ? position._chunk->_next : _first; nullptr != item; item = item->_next)
+		{
+			item->_used = 0;
+		}
+		_current = position._chunk;
+		if (nullptr != _current)
+		{
+			_current->_used = position._used;
+		}
+	}
+
+	// Rewind to the start, chunks are kept
+	void reset()
+	{
+		rewind(marker{ nullptr, 0, nullptr });
+	}
+
+	// Rewind to the start and return every chunk to the heap
+	void release()
+	{
+		reset();
+		while (nullptr != _first)
+		{
+			chunk* next = _first->_next;
+			::operator delete(_first);
+			_first = next;
+		}
+	}
+
+	// Bytes allocated since the start, including alignment padding
+	size_t bytes_used() const
+	{
+		size_t used = 0;
+		for (const chunk* item = _first; nullptr != item; item = item->_next)
+		{
+			used += item->_used;
+			if (item == _current)
+			{
+				break;
+			}
+		}
+		return nullptr != _current ? used : 0;
+	}
+
+	// Bytes held in chunks
+	size_t bytes_reserved() const
+	{
+		size_t reserved = 0;
+		for (const chunk* item = _first; nullptr != item; item = item->_next)
+		{
+			reserved += item->_size;
+		}
+		return reserved;
+	}
+
+private:
+	struct chunk
+	{
+		chunk*	_next;
+		size_t	_size;
+		size_t	_used;
+
+		uint8_t* data() { return reinterpret_cast<uint8_t*>(this + 1); }
+
+		void* bump(size_t size, size_t alignment)
+		{
+			const uintptr_t base = reinterpret_cast<uintptr_t>(data());
+			const uintptr_t start = (base + _used + alignment - 1) & ~(uintptr_t(alignment) - 1);
+			const size_t end = static_cast<size_t>(start - base) + size;
+			if (end > _size)
+			{
+				return nullptr;
+			}
+			_used = end;
+			return reinterpret_cast<void*>(start);
+		}
+	};
+
+	struct destructor
+	{
+		void		(*_destroy)(void*);
+		void*		_object;
+		destructor*	_next;
+	};
+
+	// Move to the next kept chunk when the request fits, otherwise insert a new chunk after the current one
+	chunk* allocate_chunk(size_t size, size_t alignment)
+	{
+		const size_t required = size + alignment;
+		chunk* next = nullptr != _current ? _current->_next : _first;
+		if (nullptr == next || next->_size < required)
+		{
+			const size_t capacity = Max(_chunk_size, required);
+			chunk* fresh = new (::operator new(sizeof(chunk) + capacity)) chunk();
+			fresh->_size = capacity;
+			fresh->_used = 0;
+			fresh->_next = next;
+			if (nullptr != _current)
+			{
+				_current->_next = fresh;
+			}
+			else
+			{
+				_first = fresh;
+			}
+			next = fresh;
+		}
+		_current = next;
+		return next;
+	}
+
+	chunk*		_first;
+	chunk*		_current;
+	destructor*	_destructors;
+	size_t		_chunk_size;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// Rewinds an arena to where it was when the scope was entered
+class scoped_arena
+{
+public:
+	explicit scoped_arena(arena& parent)
+	: _parent(parent)
+	, _start(parent.mark())
+	{
+	}
+
+	~scoped_arena()
+	{
+		_parent.rewind(_start);
+	}
+
+	scoped_arena(const scoped_arena&) = delete;
+	scoped_arena& operator=(const scoped_arena&) = delete;
+
+	void* allocate(size_t size, size_t alignment = alignof(std::max_align_t))	{ return _parent.allocate(size, alignment); }
+	template<typename T, typename... Args> T* create(Args&&... args)			{ return _parent.create<T>(forward<Args>(args)...); }
+
+	arena& parent() const { return _parent; }
+
+private:
+	arena&			_parent;
+	arena::marker	_start;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// std allocator adapter for arena, deallocate does nothing
+template<typename T>
+class arena_allocator
+{
+public:
+	typedef T value_type;
+
+	arena_allocator(arena& source) noexcept : _arena(&source) {}
+	arena_allocator(scoped_arena& source) noexcept : _arena(&source.parent()) {}
+	template<typename U> arena_allocator(const arena_allocator<U>& other) noexcept : _arena(other.source()) {}
+
+	T* allocate(size_t count)
+	{
+		if (count > numeric_limits<size_t>::max() / sizeof(T))
+		{
+			throw std::bad_array_new_length();
+		}
+		return static_cast<T*>(_arena->allocate(count * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T*, size_t) {}
+
+	arena* source() const { return _arena; }
+
+	template<typename U> bool operator==(const arena_allocator<U>& rhs) const { return _arena == rhs.source(); }
+	template<typename U> bool operator!=(const arena_allocator<U>& rhs) const { return _arena != rhs.source(); }
+
+private:
+	arena* _arena;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// Polymorphic memory resource adapter for arena
+class arena_resource : public std::pmr::memory_resource
+{
+public:
+	arena_resource(arena& source) : _arena(&source) {}
+
+	arena* source() const { return _arena; }
+
+protected:
+	void* do_allocate(size_t bytes, size_t alignment) override
+	{
+		return _arena->allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void*, size_t, size_t) override
+	{
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+	{
+		const arena_resource* rhs = dynamic_cast<const arena_resource*>(&other);
+		return nullptr != rhs && _arena == rhs->_arena;
+	}
+
+private:
+	arena* _arena;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+} // namespace marbles
+
+// End of file --------------------------------------------------------------------------------------------------------
@@ -25,12 +25,13 @@
 
 #include <type_traits> 
 #include "definitions.h"
+#include <Common/Backoff.h>
 
 namespace marbles
 {
 
-// Lock-free circular buffer
-template<typename T, size_t N> 
+// Lock-free circular buffer, Backoff is applied while waiting on other threads to publish or clean their elements
+template<typename T, size_t N, typename Backoff = exponential_backoff<>> 
 class alignas(alignment_of<T>::value) atomic_buffer final
 {
 public:
@@ -47,8 +48,8 @@ public:
 		clear();
 	}
 
-    atomic_buffer(const atomic_buffer<T, N>&) = delete;
-    atomic_buffer<T, N>& operator=(const atomic_buffer<T, N>&) = delete;
+    atomic_buffer(const atomic_buffer&) = delete;
+    atomic_buffer& operator=(const atomic_buffer&) = delete;
 
 	inline unsigned size() const
 	{
@@ -74,69 +75,134 @@ public:
 		return (N - 1) == size();
 	}
 
+	// Number of times any operation has backed off due to contention
+	inline uint64_t retries() const
+	{
+		return _retries.load();
+	}
+
 	void clear()
 	{
-		T out; // Review: Causes all template types to require a default constructor, this API may not be appropriate
-		while (try_pop(out)) 
+		while (try_consume([](T&&) {}))
 		{
 			this_thread::yield();
 		}
 	}
 
-	bool try_push(T value)
+	// Stop any further element from being reserved, then wait for the elements already reserved to be published.
+	// Elements remaining in a closed buffer can still be consumed.
+	void close()
+	{
+		Backoff backoff;
+		const unsigned reserved = _init.fetch_or(closed_bit) & ~closed_bit;
+		while (reserved != _end.load())
+		{
+			backoff();
+		}
+		_retries.record(backoff);
+	}
+
+	inline bool closed() const
 	{
+		return 0 != (_init.load() & closed_bit);
+	}
+
+	// Construct an element in place from args, args are only consumed when an element is reserved
+	template<typename... Args>
+	bool try_emplace(Args&&... args)
+	{
+		Backoff backoff;
 		unsigned reserved;
 		unsigned next;
-        do
+        for (;;)
         {	// Reserve an element to be created
             reserved = _init.load();
             next = (reserved + 1) % N;
             const bool isFull = next == _clean.load();
-            if (isFull)
+            if (isFull || 0 != (reserved & closed_bit))
             {
+				_retries.record(backoff);
                 return false;
             }
+			if (_init.compare_exchange_weak(reserved, next))
+			{
+				break;
+			}
 			// Try again if another thread has modified the _init value before me.
-		} while (!_init.compare_exchange_weak(reserved, next));
+			backoff();
+		}
 		
-		// Element reserved, assign the value
-		new (items() + reserved) T(forward<T>(value));
+		// Element reserved, construct the value
+		new (items() + reserved) T(forward<Args>(args)...);
 
 		// Synchronize the end position with the updated reserved position
 		const unsigned persist = reserved;
 		while (!_end.compare_exchange_weak(reserved, next))
 		{	// wait for the other element to be completed.
 			reserved = persist;
-			this_thread::yield(); 
+			backoff();
 		}
 
+		_retries.record(backoff);
 		return true;
 	}
 
-	void push(T value)
+	template<typename... Args>
+	void emplace(Args&&... args)
 	{
-		while (!try_push(forward<T>(value)))
+		Backoff backoff;
+		while (!try_emplace(forward<Args>(args)...))
 		{
-			this_thread::yield();
+			backoff();
 		}
+		_retries.record(backoff);
 	}
 
-	bool try_pop(T& out)
+	bool try_push(const T& value)
 	{
+		return try_emplace(value);
+	}
+
+	bool try_push(T&& value)
+	{
+		return try_emplace(move(value));
+	}
+
+	void push(const T& value)
+	{
+		emplace(value);
+	}
+
+	void push(T&& value)
+	{
+		emplace(move(value));
+	}
+
+	// Pass the front element to fn as an rvalue then destroy it
+	template<typename F>
+	bool try_consume(F&& fn)
+	{
+		Backoff backoff;
 		unsigned start;
 		unsigned next;
-		do 
+		for (;;)
 		{
 			start = _start.load();
 			const bool is_empty = start == _end.load();
 			if (is_empty)
             {
+				_retries.record(backoff);
 				return false;
             }
 			next = (start + 1) % N;
-		} while(!_start.compare_exchange_weak(start, next));
+			if (_start.compare_exchange_weak(start, next))
+			{
+				break;
+			}
+			backoff();
+		}
 		
-		out = move(*(items() + start));
+		fn(move(*(items() + start)));
 		(items() + start)->~T();
 
 		// Syncronize the clean position with the updated start position
@@ -144,20 +210,35 @@ public:
 		while (!_clean.compare_exchange_weak(start, next))
 		{	// wait for the other element to be cleaned first
 			start = persist;
-			this_thread::yield();
+			backoff();
 		}
 		
+		_retries.record(backoff);
 		return true;
 	}
 
+	bool try_pop(T& out)
+	{
+		return try_consume([&out](T&& value) { out = move(value); });
+	}
+
+	optional<T> try_pop()
+	{
+		optional<T> out;
+		try_consume([&out](T&& value) { out.emplace(move(value)); });
+		return out;
+	}
+
 	T pop()
 	{
-		T tmp; // Review: Causes all template types to require a default constructor, this API may not be appropriate
-		while (!try_pop(tmp))
+		Backoff backoff;
+		optional<T> out;
+		while (!try_consume([&out](T&& value) { out.emplace(move(value)); }))
 		{
-			this_thread::yield();
+			backoff();
 		}
-		return move(tmp);
+		_retries.record(backoff);
+		return move(*out);
 	}
 
     const T& operator[](int index) const
@@ -168,6 +249,8 @@ public:
     }
 
 private:
+	static const unsigned closed_bit = 1u << 31; // Set on _init once the buffer is closed
+
 	T*                  items()       { return reinterpret_cast<T*>(&_reserve[0]); }
 	const T*            items() const { return reinterpret_cast<const T*>(&_reserve[0]); }
 
@@ -176,6 +259,7 @@ private:
 	atomic<unsigned>	_end;
 	atomic<unsigned>	_init;
 	atomic<unsigned>	_clean;
+	retry_counter		_retries;
 };
 
 // --------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,234 @@
+// This source file is part of marbles library.
+//
+// Copyright (c) 2023 Dan Cobban
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// --------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <Common/Common.h>
+
+// --------------------------------------------------------------------------------------------------------------------
+namespace marbles
+{
+
+// Epoch based reclamation for lock-free containers. Readers pin the current epoch with a guard while they hold
+// pointers into a container, unlinked items are retired and only reclaimed once every pinned thread has moved two 
+// epochs past the retirement.
+// {
+//   atomic_epoch::guard pin;
+//   node* victim = unlink(...);
+//   atomic_epoch::retire(&victim->_retired, &destroy_node);
+// }
+// --------------------------------------------------------------------------------------------------------------------
+class atomic_epoch
+{
+public:
+	static const int32_t max_threads = 128;
+
+	// Intrusive hook embedded in retired items
+	struct retired
+	{
+		retired*	_next;
+		void		(*_reclaim)(retired*);
+	};
+
+	// Pins the calling thread to the current epoch, guards may be nested
+	class guard
+	{
+	public:
+		guard()		{ atomic_epoch::pin(); }
+		~guard()	{ atomic_epoch::unpin(); }
+
+		guard(const guard&) = delete;
+		guard& operator=(const guard&) = delete;
+	};
+
+	// Defer reclaim(item) until no pinned thread can reference item, the caller must hold a guard
+	static void retire(retired* item, void (*reclaim)(retired*))
+	{
+		ASSERT(0 < participant::local()._nesting);
+		state& shared = state::get();
+		const uint64_t epoch = shared._epoch.load();
+		item->_reclaim = reclaim;
+
+		atomic<retired*>& limbo = shared._limbo[epoch % num_limbo];
+		retired* head = limbo.load();
+		do {
+			item->_next = head;
+		} while (!limbo.compare_exchange_weak(head, item));
+
+		if (0 == (shared._retired.fetch_add(1) + 1) % collect_frequency)
+		{
+			try_advance();
+		}
+	}
+
+	// Attempt to advance the global epoch reclaiming items that are no longer referenced
+	static bool collect()
+	{
+		guard pin;
+		return try_advance();
+	}
+
+	static uint64_t current()
+	{
+		return state::get()._epoch.load();
+	}
+
+private:
+	static const uint64_t num_limbo = 3;
+	static const uint32_t collect_frequency = 64;
+	static const int32_t overflow_slot = -1;
+
+	// Each pin slot has its own cache line, pinning only writes the calling thread's line
+	struct alignas(64) pin_slot
+	{
+		atomic<uint64_t>	_pinned;	// (epoch << 1) | 1 while pinned, 0 otherwise
+	};
+
+	struct state
+	{
+		state() : _epoch(0), _retired(0), _overflow(0)
+		{
+			for (auto& slot : _slots)		{ slot._pinned.store(0); }
+			for (auto& claim : _claimed)	{ claim.store(false); }
+			for (auto& limbo : _limbo)		{ limbo.store(nullptr); }
+		}
+
+		static state& get() { static state s_instance; return s_instance; }
+
+		atomic<uint64_t>	_epoch;
+		atomic<uint32_t>	_retired;
+		atomic<uint32_t>	_overflow;	// Threads pinned without a slot, the epoch cannot advance while any are pinned
+		pin_slot			_slots[max_threads];
+		atomic<bool>		_claimed[max_threads];
+		atomic<retired*>	_limbo[num_limbo];
+	};
+
+	// Per thread ownership of a pin slot, released when the thread exits. When every slot is in use the thread
+	// shares the overflow pin, which conservatively holds the epoch still while it is pinned.
+	struct participant
+	{
+		participant() : _slot(overflow_slot), _nesting(0)
+		{
+			state& shared = state::get();
+			for (int32_t i = 0; overflow_slot == _slot && i < max_threads; ++i)
+			{
+				bool expected = false;
+				if (shared._claimed[i].compare_exchange_strong(expected, true))
+				{
+					_slot = i;
+				}
+			}
+		}
+
+		~participant()
+		{
+			if (overflow_slot != _slot)
+			{
+				state& shared = state::get();
+				shared._slots[_slot]._pinned.store(0);
+				shared._claimed[_slot].store(false);
+			}
+		}
+
+		static participant& local() { static thread_local participant s_local; return s_local; }
+
+		int32_t _slot;
+		int32_t _nesting;
+	};
+
+	static void pin()
+	{
+		participant& self = participant::local();
+		if (0 == self._nesting++)
+		{
+			state& shared = state::get();
+			if (overflow_slot == self._slot)
+			{
+				shared._overflow.fetch_add(1);
+				return;
+			}
+
+			uint64_t epoch = 0;
+			do {	// Publish the epoch then confirm it did not advance before the publication was visible
+				epoch = shared._epoch.load();
+				shared._slots[self._slot]._pinned.store((epoch << 1) | 1);
+			} while (epoch != shared._epoch.load());
+		}
+	}
+
+	static void unpin()
+	{
+		participant& self = participant::local();
+		ASSERT(0 < self._nesting);
+		if (0 == --self._nesting)
+		{
+			state& shared = state::get();
+			if (overflow_slot == self._slot)
+			{
+				shared._overflow.fetch_sub(1);
+			}
+			else
+			{	// Only reads made while pinned must be ordered before the slot is cleared
+				shared._slots[self._slot]._pinned.store(0, std::memory_order_release);
+			}
+		}
+	}
+
+	static bool try_advance()
+	{
+		state& shared = state::get();
+		uint64_t epoch = shared._epoch.load();
+		if (0 != shared._overflow.load())
+		{	// A thread without a slot is pinned, its epoch is unknown
+			return false;
+		}
+		for (int32_t i = 0; i < max_threads; ++i)
+		{
+			const uint64_t pinned = shared._slots[i]._pinned.load();
+			if (0 != (pinned & 1) && epoch != (pinned >> 1))
+			{	// A thread has not yet observed the current epoch
+				return false;
+			}
+		}
+
+		if (!shared._epoch.compare_exchange_strong(epoch, epoch + 1))
+		{
+			return false;
+		}
+
+		// Items retired two epochs ago can no longer be referenced by any pinned thread
+		retired* item = shared._limbo[(epoch + 2) % num_limbo].exchange(nullptr);
+		while (nullptr != item)
+		{
+			retired* next = item->_next;
+			item->_reclaim(item);
+			item = next;
+		}
+		return true;
+	}
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+} // namespace marbles
+
+// End of file --------------------------------------------------------------------------------------------------------
@@ -0,0 +1,138 @@
+// This source file is part of marbles library.
+//
+// Copyright (c) 2023 Dan Cobban
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// --------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <Common/Common.h>
+#include <Common/AtomicMap.h>
+
+// --------------------------------------------------------------------------------------------------------------------
+namespace marbles
+{
+
+// Lock-free hash map with a fixed number of buckets, each bucket is a short atomic_map. Keys must be hashable and
+// less than comparable. Values are immutable once inserted, replace a value by erasing and inserting the key.
+// --------------------------------------------------------------------------------------------------------------------
+template<typename K, typename V, typename Hash = std::hash<K>, typename Compare = std::less<K>>
+class atomic_hash_map
+{
+public:
+	typedef K key_type;
+	typedef V mapped_type;
+	typedef std::pair<const K, V> value_type;
+
+	static const size_t default_buckets = 64;
+
+	// @param num_buckets	rounded up to a power of two
+	explicit atomic_hash_map(size_t num_buckets = default_buckets)
+	: _mask(bit_ceil(Max<size_t>(num_buckets, 1)) - 1)
+	, _buckets(make_unique<bucket[]>(_mask + 1))
+	{
+	}
+
+	atomic_hash_map(const atomic_hash_map&) = delete;
+	atomic_hash_map& operator=(const atomic_hash_map&) = delete;
+
+	size_t bucket_count() const
+	{
+		return _mask + 1;
+	}
+
+	// Approximate number of elements while other threads are modifying the map, O(bucket_count)
+	size_t size() const
+	{
+		size_t count = 0;
+		for (size_t i = 0; i <= _mask; ++i)
+		{
+			count += _buckets[i].size();
+		}
+		return count;
+	}
+
+	bool empty() const
+	{
+		return 0 == size();
+	}
+
+	bool contains(const K& key) const
+	{
+		return bucket_for(key).contains(key);
+	}
+
+	bool find(const K& key, V& out) const
+	{
+		return bucket_for(key).find(key, out);
+	}
+
+	bool insert(const K& key, const V& value)
+	{
+		return bucket_for(key).insert(key, value);
+	}
+
+	template<typename... Args>
+	bool emplace(const K& key, Args&&... args)
+	{
+		return bucket_for(key).emplace(key, forward<Args>(args)...);
+	}
+
+	bool erase(const K& key)
+	{
+		return bucket_for(key).erase(key);
+	}
+
+	// Remove every element, not safe to call while other threads access the map
+	void clear()
+	{
+		for (size_t i = 0; i <= _mask; ++i)
+		{
+			_buckets[i].clear();
+		}
+	}
+
+	// Visit each element in bucket order
+	template<typename F>
+	void for_each(F&& fn) const
+	{
+		for (size_t i = 0; i <= _mask; ++i)
+		{
+			_buckets[i].for_each(fn);
+		}
+	}
+
+private:
+	typedef atomic_map<K, V, Compare, 4> bucket; // Buckets are expected to be short, keep the towers low
+
+	bucket& bucket_for(const K& key) const
+	{
+		return _buckets[_hasher(key) & _mask];
+	}
+
+	const size_t		_mask;
+	unique_ptr<bucket[]> _buckets;
+	Hash				_hasher;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+} // namespace marbles
+
+// End of file --------------------------------------------------------------------------------------------------------
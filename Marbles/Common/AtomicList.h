@@ -24,12 +24,15 @@
 #pragma once
 
 #include <Common/Common.h>
+#include <Common/AtomicTagged.h>
+#include <Common/Backoff.h>
 
 // --------------------------------------------------------------------------------------------------------------------
 namespace marbles
 {
 
-template<typename T>
+// Backoff is applied when a compare and swap on a link fails
+template<typename T, typename Backoff = pause_backoff>
 class atomic_list
 {
 public:
@@ -42,9 +45,9 @@ public:
     {
     }
 
-    atomic_list(const atomic_list<T>& base) : _next(nullptr)
+    atomic_list(const atomic_list<T, Backoff>& base) : _next(nullptr)
     {
-        set_next(const_cast<atomic_list<T>&>(base).next());
+        set_next(const_cast<atomic_list<T, Backoff>&>(base).next());
     }
 
     bool empty() const
@@ -63,76 +66,91 @@ public:
 
     node* next()
     {
-        return _next.load();
+        return _next.load().ptr;
     }
 
     const node* next() const
     {
-        return _next.load();
+        return _next.load().ptr;
     }
 
     bool try_insert_next(node* next_value)
     {
-        auto prev = next();
+        auto prev = _next.load();
         if (next_value)
         {
-            next_value->set_next(prev);
+            next_value->set_next(prev.ptr);
         }
         return _next.compare_exchange_weak(prev, next_value);
     }
 
-    atomic_list<T>& insert_next(node* next_value)
+    atomic_list<T, Backoff>& insert_next(node* next_value)
     {
-        while (!try_insert_next(next_value)) {}
+        Backoff backoff;
+        while (!try_insert_next(next_value))
+        {
+            backoff();
+        }
+        _retries.record(backoff);
         return *this;
     }
 
     bool try_set_next(node* next_value)
     {
-        auto prev = next();
+        auto prev = _next.load();
         return _next.compare_exchange_weak(prev, next_value);
     }
 
-    atomic_list<T>& set_next(node* next_value)
+    atomic_list<T, Backoff>& set_next(node* next_value)
     {
         _next.exchange(next_value);
         return *this;
     }
 
     bool remove_next(node** out = nullptr)
-    {
-        node* skipper;
+    {	// The tag on _next guards against skipper being removed and reinserted before the exchange
+        Backoff backoff;
+        tagged_ptr<node> skipper;
         node* keeper;
-        do
+        for (;;)
         {
-            skipper = next();
+            skipper = _next.load();
             keeper = nullptr;
-            if (skipper)
+            if (skipper.ptr)
+            {
+                keeper = skipper.ptr->next();
+            }
+            if (_next.compare_exchange_weak(skipper, keeper))
             {
-                keeper = skipper->next();
+                break;
             }
-        } while (!_next.compare_exchange_weak(skipper, keeper));
+            backoff();
+        }
+        _retries.record(backoff);
 
         if (out)
         {
-            *out = skipper;
+            *out = skipper.ptr;
         }
-        return nullptr != skipper;
+        return nullptr != skipper.ptr;
     }
 
-    atomic_list<T>& append(node* next_value)
+    atomic_list<T, Backoff>& append(node* next_value)
     { 
+        Backoff backoff;
         auto last = this;
         do {
             const auto* next = last->next();
             if (nullptr == next && !last->try_insert_next(next_value))
             { 
+                backoff();
                 continue;
             }
 			last = last->next();
             assert(nullptr != last);
         } while (next_value != last);
 
+        _retries.record(backoff);
         return *this;
     }
 
@@ -155,6 +173,12 @@ public:
     {
         return const_iterator();
     }
+
+    // Number of times an operation on this list has backed off due to contention
+    uint64_t retries() const
+    {
+        return _retries.load();
+    }
      
 protected:
     node* last()
@@ -171,25 +195,26 @@ protected:
 
     const node* last() const
     {
-        return const_cast<atomic_list<T>*>(this)->last();
+        return const_cast<atomic_list<T, Backoff>*>(this)->last();
     }
 
-    atomic<node*> _next;
+    atomic_tagged_ptr<node> _next;
+    retry_counter _retries;
 };
 
 
 // --------------------------------------------------------------------------------------------------------------------
-template<typename T>
-class atomic_list<T>::node : public atomic_list<T>
+template<typename T, typename Backoff>
+class atomic_list<T, Backoff>::node : public atomic_list<T, Backoff>
 {
 public:
-    node() : atomic_list<T>()
+    node() : atomic_list<T, Backoff>()
     {}
 
-    node(T data) : atomic_list<T>(), _data(data)
+    node(T data) : atomic_list<T, Backoff>(), _data(data)
     {}
 
-    node(const node& data) : atomic_list<T>(data), _data(data._data)
+    node(const node& data) : atomic_list<T, Backoff>(data), _data(data._data)
     {}
 
     T* get()
@@ -206,13 +231,13 @@ protected:
 };
 
 // --------------------------------------------------------------------------------------------------------------------
-template<typename T>
-class atomic_list<T>::iterator : public atomic_list<T>
+template<typename T, typename Backoff>
+class atomic_list<T, Backoff>::iterator : public atomic_list<T, Backoff>
 {
 public:
     iterator() {}
-    iterator(atomic_list<T>& focus) : atomic_list<T>(focus) {}
-    iterator(const iterator& rhs) : atomic_list<T>(rhs) {}
+    iterator(atomic_list<T, Backoff>& focus) : atomic_list<T, Backoff>(focus) {}
+    iterator(const iterator& rhs) : atomic_list<T, Backoff>(rhs) {}
 
     T& operator*()
     {
@@ -276,17 +301,17 @@ public:
 };
 
 // --------------------------------------------------------------------------------------------------------------------
-template<typename T>
-class atomic_list<T>::const_iterator : public atomic_list<T>
+template<typename T, typename Backoff>
+class atomic_list<T, Backoff>::const_iterator : public atomic_list<T, Backoff>
 {
 public:
     const_iterator() 
     {}
 
-    const_iterator(const atomic_list<T>& focus) : atomic_list<T>(focus)
+    const_iterator(const atomic_list<T, Backoff>& focus) : atomic_list<T, Backoff>(focus)
     {}
 
-    const_iterator(const const_iterator& rhs) : atomic_list<T>(rhs)
+    const_iterator(const const_iterator& rhs) : atomic_list<T, Backoff>(rhs)
     {}
 
     const T& operator*() const
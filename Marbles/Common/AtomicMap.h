@@ -0,0 +1,402 @@
+// This source file is part of marbles library.
+//
+// Copyright (c) 2023 Dan Cobban
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// --------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <Common/Common.h>
+#include <Common/AtomicEpoch.h>
+
+// --------------------------------------------------------------------------------------------------------------------
+namespace marbles
+{
+
+// Lock-free ordered map implemented as a skip list. Keys are unique and values are immutable once inserted, 
+// replace a value by erasing and inserting the key. Erased nodes are reclaimed through atomic_epoch.
+// --------------------------------------------------------------------------------------------------------------------
+template<typename K, typename V, typename Compare = std::less<K>, int32_t max_level = 16>
+class atomic_map
+{
+public:
+	typedef K key_type;
+	typedef V mapped_type;
+	typedef std::pair<const K, V> value_type;
+
+	atomic_map()
+	: _head(create_node(max_level))
+	, _size(0)
+	, _level(1)
+	{
+	}
+
+	~atomic_map()
+	{
+		clear();
+		destroy_node(_head);
+	}
+
+	atomic_map(const atomic_map&) = delete;
+	atomic_map& operator=(const atomic_map&) = delete;
+
+	// Approximate number of elements while other threads are modifying the map
+	size_t size() const
+	{
+		return _size.load();
+	}
+
+	bool empty() const
+	{
+		return 0 == size();
+	}
+
+	bool contains(const K& key) const
+	{
+		atomic_epoch::guard pin;
+		return nullptr != lookup(key);
+	}
+
+	bool find(const K& key, V& out) const
+	{
+		atomic_epoch::guard pin;
+		const node* found = lookup(key);
+		if (nullptr != found)
+		{
+			out = found->value().second;
+		}
+		return nullptr != found;
+	}
+
+	bool insert(const K& key, const V& value)
+	{
+		return emplace(key, value);
+	}
+
+	// Construct a value for key in place, returns false if the key already exists
+	template<typename... Args>
+	bool emplace(const K& key, Args&&... args)
+	{
+		atomic_epoch::guard pin;
+		node* preds[max_level];
+		node* succs[max_level];
+		node* created = nullptr;
+		do {
+			if (search(key, preds, succs))
+			{	// Never published, no other thread can reference the node
+				if (nullptr != created)
+				{
+					destroy_node(created);
+				}
+				return false;
+			}
+
+			if (nullptr == created)
+			{
+				created = create_node(random_level(), key, forward<Args>(args)...);
+				int32_t level = _level.load();
+				while (level < created->_height && !_level.compare_exchange_weak(level, created->_height)) {}
+			}
+			for (int32_t level = 0; level < created->_height; ++level)
+			{
+				created->_next[level].store(succs[level]);
+			}
+		} while (!preds[0]->_next[0].compare_exchange_strong(succs[0], created));
+
+		++_size;
+		link_levels(created, preds, succs);
+		return true;
+	}
+
+	bool erase(const K& key)
+	{
+		atomic_epoch::guard pin;
+		node* preds[max_level];
+		node* succs[max_level];
+		if (!search(key, preds, succs))
+		{
+			return false;
+		}
+
+		// Mark the upper levels first so that an insertion in progress stops linking the victim
+		node* victim = succs[0];
+		for (int32_t level = victim->_height; 1 < level--;)
+		{
+			node* next = victim->_next[level].load();
+			while (!is_marked(next) && !victim->_next[level].compare_exchange_weak(next, marked(next))) {}
+		}
+
+		node* next = victim->_next[0].load();
+		do {
+			if (is_marked(next))
+			{	// Another thread erased the key first
+				return false;
+			}
+		} while (!victim->_next[0].compare_exchange_weak(next, marked(next)));
+
+		--_size;
+		search(key, preds, succs); // Physically unlink the victim
+		release(victim);
+		return true;
+	}
+
+	// Remove every element, not safe to call while other threads access the map
+	void clear()
+	{
+		node* item = unmarked(_head->_next[0].load());
+		while (nullptr != item)
+		{
+			node* next = unmarked(item->_next[0].load());
+			destroy_node(item);
+			item = next;
+		}
+		for (int32_t level = 0; level < max_level; ++level)
+		{
+			_head->_next[level].store(nullptr);
+		}
+		_size.store(0);
+		_level.store(1);
+	}
+
+	// Visit each element in key order, elements inserted or erased during the walk may or may not be visited
+	template<typename F>
+	void for_each(F&& fn) const
+	{
+		atomic_epoch::guard pin;
+		const node* item = unmarked(_head->_next[0].load());
+		while (nullptr != item)
+		{
+			node* next = item->_next[0].load();
+			if (!is_marked(next))
+			{
+				fn(item->value());
+			}
+			item = unmarked(next);
+		}
+	}
+
+private:
+	struct node
+	{
+		value_type&			value()			{ return *reinterpret_cast<value_type*>(&_storage[0]); }
+		const value_type&	value() const	{ return *reinterpret_cast<const value_type*>(&_storage[0]); }
+		const K&			key() const		{ return value().first; }
+
+		atomic_epoch::retired		_retired;
+		atomic<int32_t>				_owners;	// Inserter and eraser, the last to finish retires the node
+		int32_t						_height;
+		alignas(value_type) ubyte_t	_storage[sizeof(value_type)];
+		atomic<node*>				_next[1];	// Extended to _height links by create_node
+	};
+
+	static size_t node_size(int32_t height)
+	{
+		return sizeof(node) + (height - 1) * sizeof(atomic<node*>);
+	}
+
+	// Head nodes are created without a value
+	static node* create_node(int32_t height)
+	{
+		allocator<int8_t> nodeAllocator;
+		node* item = reinterpret_cast<node*>(nodeAllocator.allocate(node_size(height)));
+		item->_retired._next = nullptr;
+		item->_retired._reclaim = nullptr;
+		new (&item->_owners) atomic<int32_t>(2);
+		item->_height = height;
+		for (int32_t level = 0; level < height; ++level)
+		{
+			new (&item->_next[level]) atomic<node*>(nullptr);
+		}
+		return item;
+	}
+
+	template<typename... Args>
+	node* create_node(int32_t height, const K& key, Args&&... args)
+	{
+		node* item = create_node(height);
+		new (&item->_storage[0]) value_type(std::piecewise_construct, 
+											std::forward_as_tuple(key), 
+											std::forward_as_tuple(forward<Args>(args)...));
+		return item;
+	}
+
+	void destroy_node(node* item) const
+	{
+		if (item != _head)
+		{
+			Destruct(&item->value());
+		}
+		allocator<int8_t> nodeAllocator;
+		nodeAllocator.deallocate(reinterpret_cast<int8_t*>(item), node_size(item->_height));
+	}
+
+	static void reclaim_node(atomic_epoch::retired* hook)
+	{
+		node* item = reinterpret_cast<node*>(hook); // _retired is the first member of node
+		Destruct(&item->value());
+		allocator<int8_t> nodeAllocator;
+		nodeAllocator.deallocate(reinterpret_cast<int8_t*>(item), node_size(item->_height));
+	}
+
+	// Called once by the inserter and once by the eraser, the node is retired when both have unlinked it
+	void release(node* item)
+	{
+		if (1 == item->_owners.fetch_sub(1))
+		{
+			atomic_epoch::retire(&item->_retired, &reclaim_node);
+		}
+	}
+
+	static bool		is_marked(const node* item)	{ return 0 != (reinterpret_cast<uintptr_t>(item) & 1); }
+	static node*	marked(node* item)			{ return reinterpret_cast<node*>(reinterpret_cast<uintptr_t>(item) | 1); }
+	static node*	unmarked(node* item)		{ return reinterpret_cast<node*>(reinterpret_cast<uintptr_t>(item) & ~uintptr_t(1)); }
+
+	bool less(const K& lhs, const K& rhs) const { return _compare(lhs, rhs); }
+
+	static int32_t random_level()
+	{	// Geometric distribution with p = 1/2
+		static thread_local uint32_t s_seed = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&s_seed)) | 1;
+		s_seed ^= s_seed << 13;
+		s_seed ^= s_seed >> 17;
+		s_seed ^= s_seed << 5;
+		int32_t level = 1;
+		for (uint32_t bits = s_seed; level < max_level && 0 != (bits & 1); bits >>= 1)
+		{
+			++level;
+		}
+		return level;
+	}
+
+	// Link the upper levels of a node already linked at level 0
+	void link_levels(node* created, node** preds, node** succs)
+	{
+		bool erased = false;
+		for (int32_t level = 1; !erased && level < created->_height; ++level)
+		{
+			bool linked = false;
+			while (!linked && !erased)
+			{
+				node* next = created->_next[level].load();
+				erased = is_marked(next); // Erased while linking, a marked link may not be replaced
+				if (!erased && (next == succs[level] || created->_next[level].compare_exchange_strong(next, succs[level])))
+				{
+					node* expected = succs[level];
+					linked = preds[level]->_next[level].compare_exchange_strong(expected, created);
+					if (!linked)
+					{
+						search(created->key(), preds, succs);
+						erased = succs[0] != created;
+					}
+				}
+			}
+		}
+
+		if (is_marked(created->_next[0].load()))
+		{	// The eraser may have unlinked the node before the upper levels were linked
+			search(created->key(), preds, succs);
+		}
+		release(created);
+	}
+
+	// Locate the predecessors and successors of key at every level unlinking marked nodes along the way
+	bool search(const K& key, node** preds, node** succs) const
+	{
+	retry:
+		node* pred = _head;
+		node* curr = nullptr;
+		for (int32_t level = max_level; level--;)
+		{
+			if (level >= _level.load())
+			{	// No node reaches this level
+				preds[level] = _head;
+				succs[level] = nullptr;
+				continue;
+			}
+
+			curr = unmarked(pred->_next[level].load());
+			while (nullptr != curr)
+			{
+				node* next = curr->_next[level].load();
+				while (is_marked(next))
+				{	// Snip the logically erased node
+					node* expected = curr;
+					if (!pred->_next[level].compare_exchange_strong(expected, unmarked(next)))
+					{
+						goto retry;
+					}
+					curr = unmarked(next);
+					if (nullptr == curr)
+					{
+						break;
+					}
+					next = curr->_next[level].load();
+				}
+
+				if (nullptr == curr || !less(curr->key(), key))
+				{
+					break;
+				}
+				pred = curr;
+				curr = unmarked(next);
+			}
+			preds[level] = pred;
+			succs[level] = curr;
+		}
+		return nullptr != curr && !less(key, curr->key());
+	}
+
+	// Read only search that skips marked nodes without unlinking them
+	const node* lookup(const K& key) const
+	{
+		const node* pred = _head;
+		const node* curr = nullptr;
+		for (int32_t level = _level.load(); level--;)
+		{
+			curr = unmarked(pred->_next[level].load());
+			while (nullptr != curr)
+			{
+				node* next = curr->_next[level].load();
+				if (is_marked(next))
+				{
+					curr = unmarked(next);
+					continue;
+				}
+				if (!less(curr->key(), key))
+				{
+					break;
+				}
+				pred = curr;
+				curr = unmarked(next);
+			}
+		}
+		const bool found = nullptr != curr && !less(key, curr->key()) && !is_marked(curr->_next[0].load());
+		return found ? curr : nullptr;
+	}
+
+	node*				_head;
+	atomic<size_t>		_size;
+	atomic<int32_t>		_level;		// Highest level any node has been linked at
+	Compare				_compare;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+} // namespace marbles
+
+// End of file --------------------------------------------------------------------------------------------------------
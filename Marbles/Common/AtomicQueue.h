@@ -26,20 +26,31 @@
 #include <Common/Common.h>
 #include <Common/Allocator.h>
 #include <Common/AtomicBuffer.h>
+#include <Common/AtomicEpoch.h>
 #include <Common/AtomicList.h>
 
 // --------------------------------------------------------------------------------------------------------------------
 namespace marbles
 {
-	template<typename T, int block_size = 64>
+	// Unbounded lock-free queue built from a list of atomic_buffer segments. Each queue owns its own segment 
+	// pool, drained segments are retired through atomic_epoch so that threads still reading them finish first. Idle
+	// segments beyond max_idle are returned to the Slabs source by set_max_idle or under memory pressure, or all 
+	// released when critical. A queue must not be destroyed by a thread holding an atomic_epoch::guard.
+	template<typename T, int block_size = 64, typename Slabs = heap_slabs>
 	class atomic_queue
 	{
 	public:
-		atomic_queue()
+		static const int32_t default_max_idle = 2;
+
+		atomic_queue(int32_t max_idle = default_max_idle)
+		: _max_idle(max_idle)
 		{
 			clear();
 		}
 
+		atomic_queue(const atomic_queue&) = delete;
+		atomic_queue& operator=(const atomic_queue&) = delete;
+
 		~atomic_queue()
 		{
 			// Disable queue
@@ -52,24 +63,34 @@ namespace marbles
 			{
 				release_node = head;
 				head = head->next();
-				_pool.free(release_node);
+				_pool.free(static_cast<segment*>(release_node));
 			} while (nullptr != head);
 
+			// Retired segments are returned to _pool, wait until every one of them has been reclaimed
+			while (0 < _retiring.load())
+			{
+				atomic_epoch::collect();
+				this_thread::yield();
+			}
+
 			// Release all reserved blocks not actively in use
 			_pool.release();
 		}
 
-		void enqueue(const T& item)
+		// Construct an element in place at the back of the queue
+		template<typename... Args>
+		void emplace(Args&&... args)
 		{
+			atomic_epoch::guard pin;
 			buffer_node* tail = _tail.load();
-			while (!tail->get()->try_push(item))
+			while (!tail->get()->try_emplace(forward<Args>(args)...))
 			{
 				if (!_pool.can_allocate())
 				{
 					_pool.reserve(1);
 				}
 
-				buffer_node* queue = _pool.allocate<buffer_list::node>();
+				segment* queue = _pool.template allocate<segment>(this);
 				if (nullptr != queue && _tail.compare_exchange_strong(tail, queue))
 				{
 					tail->set_next(queue); // point previous tail to queue, the new tail
@@ -82,11 +103,24 @@ namespace marbles
 			}
 		}
 
-		bool dequeue(T& item)
+		void enqueue(const T& item)
+		{
+			emplace(item);
+		}
+
+		void enqueue(T&& item)
+		{
+			emplace(move(item));
+		}
+
+		// Pass the front element to fn as an rvalue and remove it from the queue
+		template<typename F>
+		bool consume(F&& fn)
 		{
+			atomic_epoch::guard pin;
 			buffer_node* head = _head.load();
 
-			while (!head->get()->try_pop(item))
+			while (!head->get()->try_consume(fn))
 			{
 				buffer_node* next = head->next();
 				if (nullptr == next)
@@ -94,13 +128,18 @@ namespace marbles
 					return false;
 				}
 
+				// Producers holding a stale tail may still be filling the segment, close it to them and wait for the
+				// elements already reserved before deciding it is drained
+				head->get()->close();
+				if (head->get()->try_consume(fn))
+				{
+					return true;
+				}
+
 				assert(next != nullptr); // _head cannot be nullptr must be valid at all times.
 				if (_head.compare_exchange_strong(head, next))
-				{
-					// ********************************
-					// Freeing 'head' could have multiple pop requests fail
-					// ********************************
-					_pool.free(head); 
+				{	// Other threads may still be reading 'head', it is returned to _pool once they are unpinned
+					retire(head);
 				}
 				head = _head.load();
 			}
@@ -108,23 +147,38 @@ namespace marbles
 			return true;
 		}
 
+		bool dequeue(T& item)
+		{
+			return consume([&item](T&& value) { item = move(value); });
+		}
+
+		optional<T> dequeue()
+		{
+			optional<T> out;
+			consume([&out](T&& value) { out.emplace(move(value)); });
+			return out;
+		}
+
 		bool empty() const
 		{
+			atomic_epoch::guard pin;
 			const buffer_node* tail = _tail.load();
 			return nullptr == tail || tail->get()->empty();
 		}
 
 		void clear()
 		{
-			buffer_node* queue = nullptr;
+			atomic_epoch::guard pin;
+			segment* queue = nullptr;
+			buffer_node* head = nullptr;
 			buffer_node* tail = nullptr;
 			// Replace head/tail with new empty buffer to clear the queue
 			do {
 				tail = _tail.load();
-				queue = _pool.allocate<buffer_list::node>();
+				queue = _pool.template allocate<segment>(this);
 				if (nullptr != queue && _tail.compare_exchange_strong(tail, queue))
 				{	// Success! _tail points to an allocated buffer, queue is not considered empty
-					_head.exchange(queue); // Set _head, queue can now dequeue correctly
+					head = _head.exchange(queue); // Set _head, queue can now dequeue correctly
 				}
 				else if (nullptr != queue)
 				{	// Failed to set head, free the candidate
@@ -136,30 +190,92 @@ namespace marbles
 				}
 			} while (nullptr == queue);
 
-			// Tail points previous buffer_node list free them all!
-			while (nullptr != tail)
+			// Head points to the previous buffer_node list, retire them all!
+			while (nullptr != head)
 			{
-				queue = tail;
-				tail = tail->next();
-
-				_pool.free(queue);
+				buffer_node* previous = head;
+				head = head->next();
+				previous->get()->close();
+				retire(previous);
 			}
 		}
 
+		// Number of segments reserved by this queue, both in use and idle
+		int32_t num_reserved() const
+		{
+			return _pool.num_reserved();
+		}
+
+		// Number of segments added each time the pool grows, segments are reserved and released a slab at a time
+		static int32_t segments_per_slab()
+		{
+			return pool_allocator::blocks_per_slab;
+		}
+
+		// Number of idle segments this queue keeps in reserve before returning them to the heap
+		int32_t max_idle() const
+		{
+			return _max_idle.load();
+		}
+
+		void set_max_idle(int32_t max_idle)
+		{
+			_max_idle.store(max_idle);
+			trim();
+		}
+
+		// Release idle slabs whose segments are all held beyond max_idle
+		// @return			number of segments released
+		int32_t trim()
+		{
+			const int32_t excess = _pool.num_available() - _max_idle.load();
+			return 0 < excess ? _pool.release(excess) : 0;
+		}
+
 	private:
 		typedef atomic_buffer<T, block_size> queue_buffer;
 		typedef atomic_list<queue_buffer> buffer_list;
 		typedef buffer_list::node buffer_node;
-		typedef block_allocator<bit_ceil(sizeof(buffer_list::node))> pool_allocator;
 
-		static pool_allocator _pool;
+		// Segments carry the hook used to retire them and the queue whose pool they are returned to
+		struct segment : public buffer_node, public atomic_epoch::retired
+		{
+			segment(atomic_queue* owner) : buffer_node(), _owner(owner) {}
+
+			atomic_queue* _owner;
+		};
+
+		typedef block_allocator<bit_ceil(sizeof(segment)), pause_backoff, Slabs> pool_allocator;
+
+		// Unlinked segments are returned to _pool only once no pinned thread can reference them
+		void retire(buffer_node* node)
+		{
+			_retiring.fetch_add(1);
+			atomic_epoch::retire(static_cast<segment*>(node), &reclaim);
+		}
+
+		static void reclaim(atomic_epoch::retired* item)
+		{
+			segment* node = static_cast<segment*>(item);
+			atomic_queue* owner = node->_owner;
+			owner->_pool.free(node);
+			owner->_retiring.fetch_sub(1);
+		}
+
+		size_t on_pressure(memory_pressure level)
+		{
+			const int32_t released = memory_pressure::critical == level ? _pool.release() : trim();
+			return released * bit_ceil(sizeof(segment));
+		}
+
+		pool_allocator _pool;
+		atomic<int32_t> _max_idle;
+		atomic<int32_t> _retiring = 0;
 		atomic<typename buffer_node*> _tail = nullptr;
 		atomic<typename buffer_node*> _head = nullptr;
+		memory::trimmer _trimmer{ [this](memory_pressure level) { return on_pressure(level); } };
 	};
 
-	// ----------------------------------------------------------------------------------------------------------------
-	template<typename T, int block_size> atomic_queue<T, block_size>::pool_allocator atomic_queue<T, block_size>::_pool;
-
 } // namespace marbles
 
 // End of file --------------------------------------------------------------------------------------------------------
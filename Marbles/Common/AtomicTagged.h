@@ -0,0 +1,171 @@
+// This source file is part of marbles library.
+//
+// Copyright (c) 2023 Dan Cobban
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// --------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <Common/Common.h>
+#if defined _MSC_VER && defined _M_X64
+#include <intrin.h>
+#endif
+
+// --------------------------------------------------------------------------------------------------------------------
+// MARBLES_DWCAS is 1 when the pointer and tag are swapped together with a double width compare and swap, otherwise
+// the tag is packed into the unused upper bits of the pointer.
+#if !defined MARBLES_DWCAS
+#if (defined _MSC_VER && defined _M_X64) || (defined __x86_64__ && defined __GCC_HAVE_SYNC_COMPARE_AND_SWAP_16)
+#define MARBLES_DWCAS 1
+#else
+#define MARBLES_DWCAS 0
+#endif
+#endif
+
+// --------------------------------------------------------------------------------------------------------------------
+namespace marbles
+{
+
+// Pointer paired with a version tag, every successful exchange increments the tag so a pointer that is removed and
+// reinserted between a load and a compare and swap no longer compares equal (ABA).
+// --------------------------------------------------------------------------------------------------------------------
+template<typename T>
+struct tagged_ptr
+{
+	T*			ptr;
+	uintptr_t	tag;
+
+	bool operator==(const tagged_ptr& rhs) const { return ptr == rhs.ptr && tag == rhs.tag; }
+	bool operator!=(const tagged_ptr& rhs) const { return !operator==(rhs); }
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+template<typename T>
+class atomic_tagged_ptr
+{
+public:
+	static const bool is_double_width = 0 != MARBLES_DWCAS;
+
+	atomic_tagged_ptr(T* value = nullptr)
+	{
+#if MARBLES_DWCAS
+		_value[0] = reinterpret_cast<uintptr_t>(value);
+		_value[1] = 0;
+#else
+		_value[0] = pack({ value, 0 });
+#endif
+	}
+
+	atomic_tagged_ptr(const atomic_tagged_ptr&) = delete;
+	atomic_tagged_ptr& operator=(const atomic_tagged_ptr&) = delete;
+
+	// The halves of a double width value are read separately, a torn read only causes the next exchange to fail
+	tagged_ptr<T> load() const
+	{
+#if MARBLES_DWCAS
+		uintptr_t* value = const_cast<uintptr_t*>(&_value[0]);
+		const uintptr_t tag = std::atomic_ref<uintptr_t>(value[1]).load();
+		const uintptr_t ptr = std::atomic_ref<uintptr_t>(value[0]).load();
+		return { reinterpret_cast<T*>(ptr), tag };
+#else
+		return unpack(std::atomic_ref<packed_t>(const_cast<packed_t&>(_value[0])).load());
+#endif
+	}
+
+	void store(T* desired)
+	{
+		tagged_ptr<T> expected = load();
+		while (!compare_exchange_weak(expected, desired)) {}
+	}
+
+	T* exchange(T* desired)
+	{
+		tagged_ptr<T> expected = load();
+		while (!compare_exchange_weak(expected, desired)) {}
+		return expected.ptr;
+	}
+
+	// Replace expected with desired and increment the tag, on failure expected is updated with the current value
+	bool compare_exchange_strong(tagged_ptr<T>& expected, T* desired)
+	{
+#if MARBLES_DWCAS
+		const uintptr_t next_tag = expected.tag + 1;
+#if defined _MSC_VER
+		__int64 comparand[2] = { static_cast<__int64>(reinterpret_cast<uintptr_t>(expected.ptr)), 
+								 static_cast<__int64>(expected.tag) };
+		const bool exchanged = 0 != _InterlockedCompareExchange128(reinterpret_cast<volatile __int64*>(&_value[0]), 
+																   static_cast<__int64>(next_tag), 
+																   static_cast<__int64>(reinterpret_cast<uintptr_t>(desired)), 
+																   comparand);
+		expected.ptr = reinterpret_cast<T*>(static_cast<uintptr_t>(comparand[0]));
+		expected.tag = static_cast<uintptr_t>(comparand[1]);
+#else
+		typedef unsigned __int128 wide_t;
+		const wide_t comparand = (static_cast<wide_t>(expected.tag) << 64) | reinterpret_cast<uintptr_t>(expected.ptr);
+		const wide_t value = (static_cast<wide_t>(next_tag) << 64) | reinterpret_cast<uintptr_t>(desired);
+		const wide_t previous = __sync_val_compare_and_swap(reinterpret_cast<wide_t*>(&_value[0]), comparand, value);
+		const bool exchanged = previous == comparand;
+		expected.ptr = reinterpret_cast<T*>(static_cast<uintptr_t>(previous));
+		expected.tag = static_cast<uintptr_t>(previous >> 64);
+#endif
+		return exchanged;
+#else
+		packed_t comparand = pack(expected);
+		const bool exchanged = std::atomic_ref<packed_t>(_value[0]).compare_exchange_strong(comparand, 
+															pack({ desired, expected.tag + 1 }));
+		expected = unpack(comparand);
+		return exchanged;
+#endif
+	}
+
+	bool compare_exchange_weak(tagged_ptr<T>& expected, T* desired)
+	{
+		return compare_exchange_strong(expected, desired);
+	}
+
+private:
+#if MARBLES_DWCAS
+	alignas(2 * sizeof(uintptr_t)) uintptr_t _value[2]; // [0] pointer, [1] tag
+#else
+	// 64 bit: 48 bit user space addresses with a 16 bit tag, 32 bit: pointer and tag share a 64 bit word
+	typedef uint64_t packed_t;
+	static const int pointer_bits = 8 == sizeof(void*) ? 48 : 32;
+	static const packed_t pointer_mask = (static_cast<packed_t>(1) << pointer_bits) - 1;
+
+	static packed_t pack(const tagged_ptr<T>& value)
+	{
+		return (static_cast<packed_t>(reinterpret_cast<uintptr_t>(value.ptr)) & pointer_mask) | 
+			   (static_cast<packed_t>(value.tag) << pointer_bits);
+	}
+
+	static tagged_ptr<T> unpack(packed_t value)
+	{
+		return { reinterpret_cast<T*>(static_cast<uintptr_t>(value & pointer_mask)), 
+				 static_cast<uintptr_t>(value >> pointer_bits) };
+	}
+
+	alignas(sizeof(packed_t)) packed_t _value[1];
+#endif
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+} // namespace marbles
+
+// End of file --------------------------------------------------------------------------------------------------------
@@ -0,0 +1,168 @@
+// This source file is part of marbles library.
+//
+// Copyright (c) 2023 Dan Cobban
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// --------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <Common/Common.h>
+#include <thread>
+#if defined _MSC_VER
+#include <intrin.h>
+#endif
+
+// --------------------------------------------------------------------------------------------------------------------
+namespace marbles
+{
+
+// --------------------------------------------------------------------------------------------------------------------
+// Hint to the processor that the thread is spinning
+inline void cpu_pause()
+{
+#if defined _MSC_VER && (defined _M_X64 || defined _M_IX86)
+	_mm_pause();
+#elif defined _MSC_VER && defined _M_ARM64
+	__yield();
+#elif defined __x86_64__ || defined __i386__
+	__builtin_ia32_pause();
+#elif defined __aarch64__ || defined __arm__
+	__asm__ __volatile__("yield");
+#endif
+}
+
+// Backoff policies for compare and swap retry loops. A policy is created for each loop, operator() is called after 
+// every failed attempt and retries() reports how many times the loop backed off.
+// {
+//   exponential_backoff<> backoff;
+//   while (!value.compare_exchange_weak(expected, desired))
+//   {
+//       backoff();
+//   }
+// }
+// --------------------------------------------------------------------------------------------------------------------
+class backoff_base
+{
+public:
+	uint32_t	retries() const	{ return _retries; }
+
+protected:
+	uint32_t	_retries = 0;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// Retry immediately, for loops that rarely fail and complete within a few instructions
+class spin_backoff : public backoff_base
+{
+public:
+	void operator()()	{ ++_retries; }
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// Single processor pause, for short lightly contended critical windows
+class pause_backoff : public backoff_base
+{
+public:
+	void operator()()	{ ++_retries; cpu_pause(); }
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// Give up the time slice after every failure
+class yield_backoff : public backoff_base
+{
+public:
+	void operator()()	{ ++_retries; this_thread::yield(); }
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// Doubles the number of pauses after each failure, yields once max_spins is exceeded
+template<uint32_t min_spins = 1, uint32_t max_spins = 64>
+class exponential_backoff : public backoff_base
+{
+public:
+	void operator()()
+	{
+		++_retries;
+		if (_spins <= max_spins)
+		{
+			for (uint32_t i = _spins; i--;)
+			{
+				cpu_pause();
+			}
+			_spins <<= 1;
+		}
+		else
+		{
+			this_thread::yield();
+		}
+	}
+
+private:
+	uint32_t	_spins = min_spins;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// Spins briefly then sleeps for doubling durations, for loops waiting on work that may take a while to arrive
+template<uint32_t max_spins = 64, uint32_t max_sleep_us = 1000>
+class park_backoff : public backoff_base
+{
+public:
+	void operator()()
+	{
+		++_retries;
+		if (_spins <= max_spins)
+		{
+			for (uint32_t i = _spins; i--;)
+			{
+				cpu_pause();
+			}
+			_spins <<= 1;
+		}
+		else
+		{
+			this_thread::sleep_for(chrono::microseconds(_sleep_us));
+			_sleep_us = Min<uint32_t>(_sleep_us << 1, max_sleep_us);
+		}
+	}
+
+private:
+	uint32_t	_spins = 1;
+	uint32_t	_sleep_us = 1;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// Accumulates the retries of backoff policies, relaxed since the count is only used for instrumentation
+class retry_counter
+{
+public:
+	retry_counter() : _count(0) {}
+
+	void		record(const backoff_base& backoff)	{ if (0 != backoff.retries()) { _count.fetch_add(backoff.retries(), std::memory_order_relaxed); } }
+	uint64_t	load() const						{ return _count.load(std::memory_order_relaxed); }
+	void		reset()								{ _count.store(0, std::memory_order_relaxed); }
+
+private:
+	atomic<uint64_t>	_count;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+} // namespace marbles
+
+// End of file --------------------------------------------------------------------------------------------------------
@@ -24,6 +24,7 @@
 #pragma once
 
 #include <cstdint>
+#include <cstring>
 #include <memory>
 #include <functional>
 #include <algorithm>
@@ -39,6 +40,7 @@
 #include <iostream>
 #include <sstream>
 #include <map>
+#include <optional>
 #include <bit>
 
 // --------------------------------------------------------------------------------------------------------------------
@@ -112,6 +114,8 @@ using std::make_shared;
 using std::make_unique;
 using std::move;
 using std::numeric_limits;
+using std::nullopt;
+using std::optional;
 using std::ostream;
 using std::remove_cv;
 using std::remove_reference;
@@ -131,6 +135,7 @@ using std::map;
 using std::bit_cast;
 using std::bit_ceil;
 using std::bit_floor;
+using std::bit_width;
 
 } // namespace marbles
 
@@ -33,7 +33,7 @@ class hash
 {
 public:
 	// http://www.cse.yorku.ca/~oz/hash.html
-	static inline hash_t sdbm(const char* str)
+	static constexpr hash_t sdbm(const char* str)
 	{
         hash_t hash = 0;
         int c;
@@ -62,7 +62,7 @@ public:
 	}
 
 	// http://www.cse.yorku.ca/~oz/hash.html
-    static inline hash_t djb2(const char *str)
+    static constexpr hash_t djb2(const char *str)
     {
         hash_t hash = 5381;
         int c;
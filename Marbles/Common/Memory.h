@@ -21,16 +21,218 @@
 // THE SOFTWARE.
 // --------------------------------------------------------------------------------------------------------------------
 
-#if defined CONFIG_DEBUG
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <vector>
+
+// --------------------------------------------------------------------------------------------------------------------
 namespace marbles
 {
-	extern int allocs; // = 0;
-} // namespace marbles
-#endif // defined CONFIG_DEBUG
 
-void* operator new(size_t size/*, const char* filename = __FILE__, size_t line = __LINE__*/);
-void* operator new[](size_t size, size_t N/*, const char* filename = __FILE__, size_t line = __LINE__*/);
-void operator delete(void*p);
-void operator delete[](void*p);
+class size_class_allocator;
+
+// Source of the memory handed out by the global operator new. Every allocation records the backend that made it so 
+// memory is always returned to its own backend, a backend must outlive the memory allocated through it. allocate 
+// returns nullptr when memory is exhausted and must not throw, the nothrow forms of operator new call it directly.
+// --------------------------------------------------------------------------------------------------------------------
+class memory_backend
+{
+public:
+	virtual ~memory_backend() {}
+
+	virtual void*	allocate(size_t size, size_t alignment) = 0;
+	virtual void	deallocate(void* ptr, size_t size, size_t alignment) = 0;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// Allocation counts, per thread or summed across all threads
+struct memory_stats
+{
+	uint64_t	allocations = 0;
+	uint64_t	deallocations = 0;
+	uint64_t	bytes_allocated = 0;
+	uint64_t	bytes_deallocated = 0;
+
+	int64_t		live_allocations() const	{ return static_cast<int64_t>(allocations - deallocations); }
+	int64_t		live_bytes() const			{ return static_cast<int64_t>(bytes_allocated - bytes_deallocated); }
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// Counters for a block pool, each is read independently so a snapshot taken under contention is approximate
+struct allocator_stats
+{
+	int32_t		reserved = 0;			// Blocks in slabs owned by the pool
+	int32_t		available = 0;			// Blocks ready to be allocated
+	int32_t		outstanding = 0;		// Blocks allocated and not yet freed
+	int32_t		peak_outstanding = 0;	// High water mark of outstanding
+	uint64_t	reserve_calls = 0;
+	uint64_t	failed_allocations = 0;	// Allocations that found no free block
+	uint64_t	retries = 0;			// Times the free list backed off due to contention
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// Sampled allocations attributed to one call site, multiply by the sample rate to estimate the totals
+struct allocation_site
+{
+	const void*	address = nullptr;	// Return address of the call to operator new
+	const char*	label = nullptr;	// Set instead of address for allocations made within a memory::site_scope
+	int64_t		live_count = 0;
+	int64_t		live_bytes = 0;
+	int64_t		total_count = 0;
+	int64_t		total_bytes = 0;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// Live bytes against the memory budget, moderate from three quarters of the budget and critical beyond it
+enum class memory_pressure : uint8_t
+{
+	none,
+	moderate,	// Return idle memory beyond what is kept for reuse
+	critical,	// Return every free block
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// Global allocation layer behind operator new and delete
+class memory
+{
+public:
+	// Attributes allocations made by the calling thread to label while in scope
+	class site_scope
+	{
+	public:
+		explicit site_scope(const char* label);
+		~site_scope();
+
+		site_scope(const site_scope&) = delete;
+		site_scope& operator=(const site_scope&) = delete;
+
+	private:
+		const char* _outer;
+	};
+
+	// Registers a callback that returns idle memory under pressure for as long as it is in scope. Callbacks return 
+	// the number of bytes released and must not create or destroy trimmers.
+	class trimmer
+	{
+	public:
+		typedef std::function<size_t(memory_pressure)> callback;
+
+		explicit trimmer(callback trim);
+		~trimmer();
+
+		trimmer(const trimmer&) = delete;
+		trimmer& operator=(const trimmer&) = delete;
+
+	private:
+		friend class memory;
+
+		callback	_trim;
+		trimmer*	_next;
+		trimmer*	_prev;
+	};
+
+	// Route new allocations to backend, nullptr restores the system backend
+	// @return			the previously installed backend
+	static memory_backend*	install(memory_backend* backend);
+	static memory_backend&	backend();
+	static memory_backend&	system();
+
+	static memory_stats		stats();		// All threads, including threads that have exited
+	static memory_stats		thread_stats();	// Calling thread only
+
+	// Track one in every sample_rate allocations of each thread by call site, 0 disables tracking
+	static void				track(uint32_t sample_rate, bool report_at_exit = false);
+	static uint32_t			sample_rate();
+	static std::vector<allocation_site> sites();	// Sorted by live bytes, largest first
+	static void				report(size_t top_count = 20);	// Print the sites with the most live bytes
+
+	// Budget for the live bytes in stats(), 0 disables memory pressure which is the default
+	static void				set_budget(size_t bytes);
+	static size_t			budget();
+	static memory_pressure	pressure();
+
+	// Trim when pressure has risen since the last collect, intended to be polled by a background service
+	static memory_pressure	collect();
+
+	// Call every registered trimmer
+	// @return			number of bytes released
+	static size_t			trim(memory_pressure level = memory_pressure::critical);
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// malloc and the platform aligned allocation functions
+class system_memory : public memory_backend
+{
+public:
+	void*	allocate(size_t size, size_t alignment) override;
+	void	deallocate(void* ptr, size_t size, size_t alignment) override;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// Small allocations from a size_class_allocator, larger ones from the system
+class pooled_memory : public memory_backend
+{
+public:
+	pooled_memory();
+	~pooled_memory() override;
+
+	void*	allocate(size_t size, size_t alignment) override;
+	void	deallocate(void* ptr, size_t size, size_t alignment) override;
+
+	size_t	release(); // Return free slabs to the system
+
+private:
+	size_class_allocator* _pools;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// Lock-free bump allocation from chunks, deallocate does nothing and reset returns every chunk at once. Intended to 
+// be installed around scoped work whose allocations are all released before reset.
+class arena_memory : public memory_backend
+{
+public:
+	static const size_t default_chunk_size = 64 * 1024;
+
+	arena_memory(size_t chunk_size = default_chunk_size);
+	~arena_memory() override;
+
+	void*	allocate(size_t size, size_t alignment) override;
+	void	deallocate(void* ptr, size_t size, size_t alignment) override;
+
+	void	reset();
+
+private:
+	struct chunk;
+
+	std::atomic<chunk*>	_current;
+	size_t				_chunk_size;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// Counts the calls made to another backend, install one to assert that a code path does not allocate
+class counting_memory : public memory_backend
+{
+public:
+	counting_memory(memory_backend& target = memory::backend());
+
+	void*	allocate(size_t size, size_t alignment) override;
+	void	deallocate(void* ptr, size_t size, size_t alignment) override;
+
+	uint64_t allocations() const;
+	uint64_t deallocations() const;
+	void	reset();
+
+private:
+	memory_backend&			_target;
+	std::atomic<uint64_t>	_allocations;
+	std::atomic<uint64_t>	_deallocations;
+};
+
+} // namespace marbles
 
 // End of file --------------------------------------------------------------------------------------------------------
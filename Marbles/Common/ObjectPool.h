@@ -0,0 +1,271 @@
+// This source file is part of marbles library.
+//
+// Copyright (c) 2023 Dan Cobban
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// --------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <Common/Common.h>
+
+// --------------------------------------------------------------------------------------------------------------------
+namespace marbles
+{
+
+// --------------------------------------------------------------------------------------------------------------------
+// Pool of T referenced by generational handles. Objects are constructed in chunks of contiguous storage that are 
+// never moved or freed before the pool, pointers and handles remain valid until their own object is destroyed. There 
+// is no limit on the size of T. A packed index of live objects keeps iteration touching only live objects, objects 
+// created together sit side by side in a chunk. Not thread-safe.
+// {
+//   object_pool<foo> pool;
+//   object_pool<foo>::handle id = pool.create(args...);
+//   if (foo* object = pool.get(id)) { ... }
+//   pool.destroy(id); // pool.get(id) now returns nullptr
+// }
+template<typename T>
+class object_pool
+{
+public:
+	class handle
+	{
+	public:
+		handle() : _index(0), _generation(0) {}
+
+		bool valid() const								{ return 0 != _generation; }
+		bool operator==(const handle& rhs) const		{ return _index == rhs._index && _generation == rhs._generation; }
+		bool operator!=(const handle& rhs) const		{ return !(*this == rhs); }
+
+	private:
+		friend class object_pool<T>;
+		uint32_t	_index;
+		uint32_t	_generation;	// 0 is never live
+#if !defined NDEBUG
+		uint32_t	_pool = 0;		// Identifies the owning pool to validate ownership
+#endif
+	};
+
+	// Iterates the packed index of live objects, dereferencing yields the object
+	template<typename V, typename I>
+	class iterator_t
+	{
+	public:
+		iterator_t(I at) : _at(at) {}
+
+		V& operator*() const								{ return **_at; }
+		V* operator->() const								{ return *_at; }
+		iterator_t& operator++()							{ ++_at; return *this; }
+		iterator_t operator++(int)							{ iterator_t now(*this); ++_at; return now; }
+		iterator_t operator+(ptrdiff_t offset) const		{ return iterator_t(_at + offset); }
+		bool operator==(const iterator_t& rhs) const		{ return _at == rhs._at; }
+		bool operator!=(const iterator_t& rhs) const		{ return _at != rhs._at; }
+
+	private:
+		I _at;
+	};
+	typedef iterator_t<T, typename vector<T*>::const_iterator> iterator;
+	typedef iterator_t<const T, typename vector<T*>::const_iterator> const_iterator;
+
+	object_pool()
+	: _free(invalid)
+#if !defined NDEBUG
+	, _id(next_id())
+#endif
+	{
+	}
+
+	~object_pool()
+	{
+		clear();
+	}
+
+	object_pool(const object_pool&) = delete;
+	object_pool& operator=(const object_pool&) = delete;
+
+	void reserve(size_t count)
+	{
+		while (_chunks.size() * chunk_size < count)
+		{
+			_chunks.emplace_back(new cell[chunk_size]);
+		}
+		_objects.reserve(count);
+		_owners.reserve(count);
+		_slots.reserve(count);
+	}
+
+	template<typename... Args>
+	handle create(Args&&... args)
+	{
+		// Each slot owns the cell at its index, a reused slot constructs in place of the object it last held
+		const bool reuse = invalid != _free;
+		const uint32_t index = reuse ? _free : static_cast<uint32_t>(_slots.size());
+		if (index >= _chunks.size() * chunk_size)
+		{
+			_chunks.emplace_back(new cell[chunk_size]);
+		}
+		T* object = new (storage(index)) T(forward<Args>(args)...);
+
+		if (reuse)
+		{
+			_free = _slots[index]._dense;
+		}
+		else
+		{
+			_slots.push_back(slot{ invalid, 1 });
+		}
+		_objects.push_back(object);
+		_owners.push_back(index);
+		slot& entry = _slots[index];
+		entry._dense = static_cast<uint32_t>(_objects.size() - 1);
+
+		handle out;
+		out._index = index;
+		out._generation = entry._generation;
+#if !defined NDEBUG
+		out._pool = _id;
+#endif
+		return out;
+	}
+
+	// Destroy the object and return its cell to the pool, the last entry of the packed index takes its place
+	bool destroy(const handle& id)
+	{
+		if (!contains(id))
+		{
+			return false;
+		}
+
+		slot& entry = _slots[id._index];
+		const uint32_t dense = entry._dense;
+		const uint32_t last = static_cast<uint32_t>(_objects.size() - 1);
+		_objects[dense]->~T();
+		if (dense != last)
+		{
+			_objects[dense] = _objects[last];
+			_owners[dense] = _owners[last];
+			_slots[_owners[dense]]._dense = dense;
+		}
+		_objects.pop_back();
+		_owners.pop_back();
+
+		// Retire the generation so stale handles no longer resolve, 0 is skipped as it marks a null handle
+		entry._generation = Max<uint32_t>(entry._generation + 1, 1);
+		entry._dense = _free;
+		_free = id._index;
+		return true;
+	}
+
+	bool contains(const handle& id) const
+	{
+		validate(id);
+		return id.valid() && id._index < _slots.size() && _slots[id._index]._generation == id._generation;
+	}
+
+	T* get(const handle& id)
+	{
+		return contains(id) ? _objects[_slots[id._index]._dense] : nullptr;
+	}
+
+	const T* get(const handle& id) const
+	{
+		return const_cast<object_pool*>(this)->get(id);
+	}
+
+	// Handle of the object at the given position in iteration order
+	handle handle_at(size_t position) const
+	{
+		ASSERT(position < _objects.size());
+		handle out;
+		out._index = _owners[position];
+		out._generation = _slots[out._index]._generation;
+#if !defined NDEBUG
+		out._pool = _id;
+#endif
+		return out;
+	}
+
+	void clear()
+	{
+		for (size_t i = _objects.size(); i--;)
+		{
+			destroy(handle_at(i));
+		}
+	}
+
+	size_t size() const		{ return _objects.size(); }
+	bool empty() const		{ return _objects.empty(); }
+
+	// Iterate over live objects in packed order
+	iterator			begin()			{ return iterator(_objects.cbegin()); }
+	iterator			end()			{ return iterator(_objects.cend()); }
+	const_iterator		begin() const	{ return const_iterator(_objects.cbegin()); }
+	const_iterator		end() const		{ return const_iterator(_objects.cend()); }
+
+private:
+	static const uint32_t invalid = ~0u;
+	static constexpr uint32_t chunk_size = 64;	// Objects per chunk
+
+	struct cell
+	{
+		alignas(T) ubyte_t	_storage[sizeof(T)];
+	};
+
+	struct slot
+	{
+		uint32_t	_dense;			// Position in the packed index while live, next free slot otherwise
+		uint32_t	_generation;
+	};
+
+	void* storage(uint32_t index)
+	{
+		return _chunks[index / chunk_size][index % chunk_size]._storage;
+	}
+
+	void validate(const handle& id) const
+	{
+#if !defined NDEBUG
+		ASSERT(!id.valid() || id._pool == _id); // Handle belongs to another pool
+#else
+		(void)id;
+#endif
+	}
+
+#if !defined NDEBUG
+	static uint32_t next_id()
+	{
+		static atomic<uint32_t> s_next(1);
+		return s_next.fetch_add(1);
+	}
+#endif
+
+	vector<unique_ptr<cell[]>>	_chunks;	// Stable storage, cell i of the pool holds the object of slot i
+	vector<T*>					_objects;	// Packed index of live objects
+	vector<uint32_t>			_owners;	// Slot of each object in _objects
+	vector<slot>				_slots;
+	uint32_t					_free;
+#if !defined NDEBUG
+	uint32_t					_id;
+#endif
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+} // namespace marbles
+
+// End of file --------------------------------------------------------------------------------------------------------
@@ -0,0 +1,229 @@
+// This source file is part of marbles library.
+//
+// Copyright (c) 2023 Dan Cobban
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// --------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <Common/Common.h>
+#include <Common/Allocator.h>
+#include <memory_resource>
+#include <tuple>
+#include <utility>
+
+// --------------------------------------------------------------------------------------------------------------------
+namespace marbles
+{
+
+// --------------------------------------------------------------------------------------------------------------------
+// General purpose allocator serving requests from min_size to max_size out of power of two size classes, each backed
+// by its own block_allocator. Larger or over aligned requests are passed on to the heap. Free slabs are released 
+// when memory::trim is called under pressure.
+class size_class_allocator
+{
+public:
+	static constexpr size_t min_size = 16;
+	static constexpr size_t max_size = 2 * kb;
+	static constexpr int32_t num_classes = 8;
+	static_assert((min_size << (num_classes - 1)) == max_size, "Size classes must cover min_size to max_size");
+
+	size_class_allocator() = default;
+	size_class_allocator(const size_class_allocator&) = delete;
+	size_class_allocator& operator=(const size_class_allocator&) = delete;
+
+	// Process wide instance used by default constructed adapters
+	static size_class_allocator& shared()
+	{
+		static size_class_allocator s_instance;
+		return s_instance;
+	}
+
+	// Index of the smallest class that holds size bytes at the given alignment, -1 when served by the heap
+	static int32_t size_class(size_t size, size_t alignment = alignof(std::max_align_t))
+	{
+		const size_t required = Max(Max(size, alignment), min_size);
+		return required <= max_size ? static_cast<int32_t>(bit_width(required - 1) - bit_width(min_size - 1)) : -1;
+	}
+
+	// Size of the blocks in the given class
+	static size_t class_size(int32_t index)
+	{
+		return min_size << index;
+	}
+
+	// Throws std::bad_alloc when memory is exhausted
+	void* allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+	{
+		void* out = try_allocate(size, alignment);
+		if (nullptr == out)
+		{
+			throw std::bad_alloc();
+		}
+		return out;
+	}
+
+	// Returns nullptr when memory is exhausted
+	void* try_allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+	{
+		const int32_t index = size_class(size, alignment);
+		if (0 > index)
+		{
+			return ::operator new(size, std::align_val_t(alignment), std::nothrow);
+		}
+
+		return visit<void*>(index, [](auto& pool)
+		{
+			void* out = pool.allocate_block();
+			while (nullptr == out && pool.reserve(1))
+			{
+				out = pool.allocate_block();
+			}
+			return out;
+		});
+	}
+
+	// size and alignment must match the values given to allocate
+	void deallocate(void* ptr, size_t size, size_t alignment = alignof(std::max_align_t))
+	{
+		const int32_t index = size_class(size, alignment);
+		if (0 > index)
+		{
+			::operator delete(ptr, std::align_val_t(alignment));
+		}
+		else
+		{
+			visit<bool>(index, [ptr](auto& pool) { return pool.free_block(ptr); });
+		}
+	}
+
+	// Number of blocks reserved by the given class
+	int32_t num_reserved(int32_t index) const
+	{
+		return const_cast<size_class_allocator*>(this)->visit<int32_t>(index, [](auto& pool) { return pool.num_reserved(); });
+	}
+
+	// Return every free slab of every class to the heap
+	// @return			number of bytes released
+	size_t release()
+	{
+		size_t released = 0;
+		for (int32_t i = 0; i < num_classes; ++i)
+		{
+			released += class_size(i) * visit<int32_t>(i, [](auto& pool) { return pool.release(); });
+		}
+		return released;
+	}
+
+private:
+	template<size_t... I> 
+	static std::tuple<block_allocator<(min_size << I)>...> make_pools(std::index_sequence<I...>);
+	typedef decltype(make_pools(std::make_index_sequence<num_classes>())) pool_tuple;
+
+	// Call fn with the pool of the given class
+	template<typename R, typename F>
+	R visit(int32_t index, F&& fn)
+	{
+		ASSERT(0 <= index && index < num_classes);
+		return visit<R>(index, fn, std::make_index_sequence<num_classes>());
+	}
+
+	template<typename R, typename F, size_t... I>
+	R visit(int32_t index, F& fn, std::index_sequence<I...>)
+	{
+		R out{};
+		(void)((static_cast<int32_t>(I) == index && (out = fn(std::get<I>(_pools)), true)) || ...);
+		return out;
+	}
+
+	pool_tuple _pools;
+	memory::trimmer _trimmer{ [this](memory_pressure) { return release(); } };
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// std allocator adapter for size_class_allocator
+template<typename T>
+class pooled_allocator
+{
+public:
+	typedef T value_type;
+
+	pooled_allocator() noexcept : _pools(&size_class_allocator::shared()) {}
+	explicit pooled_allocator(size_class_allocator& pools) noexcept : _pools(&pools) {}
+	template<typename U> pooled_allocator(const pooled_allocator<U>& other) noexcept : _pools(other.pools()) {}
+
+	T* allocate(size_t count)
+	{
+		if (count > numeric_limits<size_t>::max() / sizeof(T))
+		{
+			throw std::bad_array_new_length();
+		}
+		return static_cast<T*>(_pools->allocate(count * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T* ptr, size_t count)
+	{
+		_pools->deallocate(ptr, count * sizeof(T), alignof(T));
+	}
+
+	size_class_allocator* pools() const { return _pools; }
+
+	template<typename U> bool operator==(const pooled_allocator<U>& rhs) const { return _pools == rhs.pools(); }
+	template<typename U> bool operator!=(const pooled_allocator<U>& rhs) const { return _pools != rhs.pools(); }
+
+private:
+	size_class_allocator* _pools;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// Polymorphic memory resource adapter for size_class_allocator
+class pooled_resource : public std::pmr::memory_resource
+{
+public:
+	pooled_resource() : _pools(&size_class_allocator::shared()) {}
+	explicit pooled_resource(size_class_allocator& pools) : _pools(&pools) {}
+
+	size_class_allocator* pools() const { return _pools; }
+
+protected:
+	void* do_allocate(size_t bytes, size_t alignment) override
+	{
+		return _pools->allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void* ptr, size_t bytes, size_t alignment) override
+	{
+		_pools->deallocate(ptr, bytes, alignment);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+	{
+		const pooled_resource* rhs = dynamic_cast<const pooled_resource*>(&other);
+		return nullptr != rhs && _pools == rhs->_pools;
+	}
+
+private:
+	size_class_allocator* _pools;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+} // namespace marbles
+
+// End of file --------------------------------------------------------------------------------------------------------
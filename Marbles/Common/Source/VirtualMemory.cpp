@@ -0,0 +1,112 @@
+// This source file is part of marbles library.
+//
+// Copyright (c) 2023 Dan Cobban
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// --------------------------------------------------------------------------------------------------------------------
+
+#include <Common/VirtualMemory.h>
+#if defined _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace marbles;
+
+// --------------------------------------------------------------------------------------------------------------------
+size_t virtual_memory::page_size()
+{
+#if defined _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwPageSize;
+#else
+	return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+size_t virtual_memory::huge_page_size()
+{	// Windows large pages need SeLockMemoryPrivilege and cannot be decommitted so they are not used
+#if defined MADV_HUGEPAGE
+	return 2 * mb;
+#else
+	return 0;
+#endif
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void* virtual_memory::reserve(size_t size)
+{
+#if defined _WIN32
+	return VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+	void* address = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	return MAP_FAILED != address ? address : nullptr;
+#endif
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void virtual_memory::release(void* address, size_t size)
+{
+#if defined _WIN32
+	(void)size;
+	VirtualFree(address, 0, MEM_RELEASE);
+#else
+	munmap(address, size);
+#endif
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+bool virtual_memory::commit(void* address, size_t size, bool huge)
+{
+#if defined _WIN32
+	(void)huge;
+	return nullptr != VirtualAlloc(address, size, MEM_COMMIT, PAGE_READWRITE);
+#else
+	if (0 != mprotect(address, size, PROT_READ | PROT_WRITE))
+	{
+		return false;
+	}
+#if defined MADV_HUGEPAGE
+	if (huge)
+	{	// Only a hint, fails harmlessly when transparent huge pages are disabled
+		madvise(address, size, MADV_HUGEPAGE);
+	}
+#else
+	(void)huge;
+#endif
+	return true;
+#endif
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void virtual_memory::decommit(void* address, size_t size)
+{
+#if defined _WIN32
+	VirtualFree(address, size, MEM_DECOMMIT);
+#else
+	madvise(address, size, MADV_DONTNEED);
+#endif
+}
+
+// End of file --------------------------------------------------------------------------------------------------------
@@ -21,53 +21,751 @@
 // THE SOFTWARE.
 // --------------------------------------------------------------------------------------------------------------------
 
-#include <Memory.h>
+#include <Common/Common.h>
+#include <Common/SizeClassAllocator.h>
+#include <cstdlib>
+#include <cstdio>
+#include <mutex>
+#if defined _MSC_VER
+#include <malloc.h>
+#include <intrin.h>
+#define MARBLES_RETURN_ADDRESS() _ReturnAddress()
+#else
+#define MARBLES_RETURN_ADDRESS() __builtin_return_address(0)
+#endif
+
+using namespace marbles;
 
 // --------------------------------------------------------------------------------------------------------------------
-//_CRTRESTRICT void* __cdecl malloc(size_t size)
-//{
-//    (void)(size);
-//    return nullptr;
-//}
-//
-//// --------------------------------------------------------------------------------------------------------------------
-//void __cdecl free(void* p)
-//{
-//    (void)p;
-//}
+namespace
+{
+	// Written in front of every allocation so delete can find the backend and size without help from the caller
+	struct header
+	{
+		memory_backend*	_backend;
+		uint64_t		_size : 48;
+		uint64_t		_site : 16; // Index into s_sites when sampled, 0 otherwise
+	};
+
+	const size_t default_alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+	const size_t header_size = (sizeof(header) + default_alignment - 1) & ~(default_alignment - 1);
+
+	// Per thread counters, nodes are never freed so the totals include threads that have exited
+	struct stats_node
+	{
+		stats_node*			_next;
+		atomic<uint64_t>	_allocations;
+		atomic<uint64_t>	_deallocations;
+		atomic<uint64_t>	_bytes_allocated;
+		atomic<uint64_t>	_bytes_deallocated;
+	};
+
+	// Open addressed table of sampled call sites, entry 0 is reserved for allocations that were not sampled
+	struct site_entry
+	{
+		atomic<uintptr_t>	_key;
+		atomic<bool>		_label;
+		atomic<int64_t>		_live_count;
+		atomic<int64_t>		_live_bytes;
+		atomic<int64_t>		_total_count;
+		atomic<int64_t>		_total_bytes;
+	};
+
+	const uint32_t num_sites = 4096;
+	site_entry					s_sites[num_sites];
+	atomic<uint32_t>			s_sample_rate(0);
+	thread_local uint32_t		t_sample_count = 0;
+	thread_local const char*	t_site_label = nullptr;
+
+	// Registered trimmers, callbacks are made with the lock held so a trimmer can not be destroyed mid call
+	struct trimmer_list
+	{
+		std::mutex			_lock;
+		memory::trimmer*	_head = nullptr;
+	};
+
+	trimmer_list& trimmers()
+	{
+		static trimmer_list s_trimmers;
+		return s_trimmers;
+	}
+
+	atomic<size_t>				s_budget(0);
+	atomic<memory_pressure>		s_pressure(memory_pressure::none);
+
+	atomic<memory_backend*>		s_backend(nullptr);
+	atomic<stats_node*>			s_stats(nullptr);
+	thread_local stats_node*	t_stats = nullptr;
+	thread_local bool			t_in_backend = false;
+
+	stats_node& local_stats()
+	{
+		if (nullptr == t_stats)
+		{	// Allocated from the C heap as operator new is the caller
+			stats_node* node = new (std::calloc(1, sizeof(stats_node))) stats_node();
+			node->_next = s_stats.load();
+			while (!s_stats.compare_exchange_weak(node->_next, node)) {}
+			t_stats = node;
+		}
+		return *t_stats;
+	}
+
+	// Only the owning thread writes to its counters
+	void increment(atomic<uint64_t>& counter, uint64_t value)
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	}
+
+	memory_stats snapshot(const stats_node& node)
+	{
+		memory_stats out;
+		out.allocations = node._allocations.load(std::memory_order_relaxed);
+		out.deallocations = node._deallocations.load(std::memory_order_relaxed);
+		out.bytes_allocated = node._bytes_allocated.load(std::memory_order_relaxed);
+		out.bytes_deallocated = node._bytes_deallocated.load(std::memory_order_relaxed);
+		return out;
+	}
+
+	// Sample the allocation and record it against its site
+	// @return			index of the site or 0 when not sampled
+	uint16_t record_site(const void* address, size_t size)
+	{
+		const uint32_t rate = s_sample_rate.load(std::memory_order_relaxed);
+		if (0 == rate || 0 != t_sample_count++ % rate)
+		{
+			return 0;
+		}
+
+		const bool is_label = nullptr != t_site_label;
+		const uintptr_t key = is_label ? reinterpret_cast<uintptr_t>(t_site_label) : reinterpret_cast<uintptr_t>(address);
+		uint32_t index = static_cast<uint32_t>(((key >> 2) * 0x9E3779B97F4A7C15ull) >> 40) % (num_sites - 1) + 1;
+		for (uint32_t probe = 1; probe < num_sites; ++probe)
+		{
+			site_entry& site = s_sites[index];
+			uintptr_t current = site._key.load();
+			if (0 == current && site._key.compare_exchange_strong(current, key))
+			{
+				site._label.store(is_label);
+				current = key;
+			}
+			if (key == current)
+			{
+				site._live_count.fetch_add(1, std::memory_order_relaxed);
+				site._live_bytes.fetch_add(size, std::memory_order_relaxed);
+				site._total_count.fetch_add(1, std::memory_order_relaxed);
+				site._total_bytes.fetch_add(size, std::memory_order_relaxed);
+				return static_cast<uint16_t>(index);
+			}
+			index = index % (num_sites - 1) + 1;
+		}
+		return 0; // Table is full
+	}
+
+	void release_site(uint16_t index, size_t size)
+	{
+		if (0 != index)
+		{
+			s_sites[index]._live_count.fetch_sub(1, std::memory_order_relaxed);
+			s_sites[index]._live_bytes.fetch_sub(size, std::memory_order_relaxed);
+		}
+	}
+
+	void report_at_exit()
+	{
+		memory::report();
+	}
+
+	// Allocations made by a backend while it is serving a request go to the system backend
+	class reentry_guard
+	{
+	public:
+		reentry_guard() : _outer(t_in_backend)	{ t_in_backend = true; }
+		~reentry_guard()						{ t_in_backend = _outer; }
+
+	private:
+		bool _outer;
+	};
+
+	void* allocate(size_t size, size_t alignment, const void* site)
+	{
+		alignment = Max(alignment, default_alignment);
+		const size_t offset = Max(alignment, header_size);
+		const size_t total = size + offset;
+		if (total < size || (uint64_t(total) >> 48))
+		{	// Overflowed or too large for the header
+			return nullptr;
+		}
+
+		memory_backend* backend = t_in_backend ? &memory::system() : &memory::backend();
+		uint8_t* base = nullptr;
+		{
+			reentry_guard guard;
+			base = static_cast<uint8_t*>(backend->allocate(total, alignment));
+		}
+		if (nullptr == base)
+		{
+			return nullptr;
+		}
+
+		uint8_t* out = base + offset;
+		header* info = reinterpret_cast<header*>(out) - 1;
+		info->_backend = backend;
+		info->_size = total;
+		info->_site = record_site(site, size);
+
+		stats_node& stats = local_stats();
+		increment(stats._allocations, 1);
+		increment(stats._bytes_allocated, size);
+		return out;
+	}
+
+	void deallocate(void* ptr, size_t alignment)
+	{
+		if (nullptr != ptr)
+		{
+			alignment = Max(alignment, default_alignment);
+			const size_t offset = Max(alignment, header_size);
+			uint8_t* out = static_cast<uint8_t*>(ptr);
+			header* info = reinterpret_cast<header*>(out) - 1;
+
+			stats_node& stats = local_stats();
+			increment(stats._deallocations, 1);
+			increment(stats._bytes_deallocated, info->_size - offset);
+			release_site(static_cast<uint16_t>(info->_site), info->_size - offset);
+
+			reentry_guard guard;
+			info->_backend->deallocate(out - offset, info->_size, alignment);
+		}
+	}
+
+	void* allocate_or_throw(size_t size, size_t alignment, const void* site)
+	{
+		void* out = allocate(size, alignment, site);
+		if (nullptr == out)
+		{
+			throw std::bad_alloc();
+		}
+		return out;
+	}
+
+	void deallocate_sized(void* ptr, size_t size, size_t alignment)
+	{
+		ASSERT(nullptr == ptr || size + Max(Max(alignment, default_alignment), header_size) == (static_cast<header*>(ptr) - 1)->_size);
+		(void)size;
+		deallocate(ptr, alignment);
+	}
+} // namespace
+
+// --------------------------------------------------------------------------------------------------------------------
+memory_backend* memory::install(memory_backend* backend)
+{
+	memory_backend* previous = s_backend.exchange(backend);
+	return nullptr != previous ? previous : &system();
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+memory_backend& memory::backend()
+{
+	memory_backend* backend = s_backend.load();
+	return nullptr != backend ? *backend : system();
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+memory_backend& memory::system()
+{	// Never destroyed, memory may be freed during static destruction
+	alignas(system_memory) static uint8_t s_storage[sizeof(system_memory)];
+	static system_memory* s_system = new (s_storage) system_memory();
+	return *s_system;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+memory_stats memory::stats()
+{
+	memory_stats out;
+	for (const stats_node* node = s_stats.load(); nullptr != node; node = node->_next)
+	{
+		const memory_stats thread = snapshot(*node);
+		out.allocations += thread.allocations;
+		out.deallocations += thread.deallocations;
+		out.bytes_allocated += thread.bytes_allocated;
+		out.bytes_deallocated += thread.bytes_deallocated;
+	}
+	return out;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+memory_stats memory::thread_stats()
+{
+	return snapshot(local_stats());
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void memory::track(uint32_t sample_rate, bool at_exit)
+{
+	s_sample_rate.store(sample_rate);
+	static atomic<bool> s_registered(false);
+	if (at_exit && !s_registered.exchange(true))
+	{
+		std::atexit(&report_at_exit);
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+uint32_t memory::sample_rate()
+{
+	return s_sample_rate.load();
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+std::vector<allocation_site> memory::sites()
+{
+	std::vector<allocation_site> out;
+	for (uint32_t i = 1; i < num_sites; ++i)
+	{
+		const site_entry& entry = s_sites[i];
+		const uintptr_t key = entry._key.load();
+		if (0 != key)
+		{
+			allocation_site site;
+			const bool is_label = entry._label.load();
+			site.address = is_label ? nullptr : reinterpret_cast<const void*>(key);
+			site.label = is_label ? reinterpret_cast<const char*>(key) : nullptr;
+			site.live_count = entry._live_count.load(std::memory_order_relaxed);
+			site.live_bytes = entry._live_bytes.load(std::memory_order_relaxed);
+			site.total_count = entry._total_count.load(std::memory_order_relaxed);
+			site.total_bytes = entry._total_bytes.load(std::memory_order_relaxed);
+			out.push_back(site);
+		}
+	}
+	std::sort(out.begin(), out.end(), [](const allocation_site& lhs, const allocation_site& rhs) 
+	{ 
+		return lhs.live_bytes > rhs.live_bytes || (lhs.live_bytes == rhs.live_bytes && lhs.total_bytes > rhs.total_bytes); 
+	});
+	return out;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void memory::report(size_t top_count)
+{
+	const std::vector<allocation_site> all = sites();
+	const uint32_t rate = Max(sample_rate(), 1u);
+	printf("Allocation sites, sampled 1 in %u, top %u of %u\n", rate, unsigned(Min(top_count, all.size())), unsigned(all.size()));
+	printf("%18s %12s %12s %12s %12s  %s\n", "site", "live bytes", "live count", "total bytes", "total count", "label");
+	for (size_t i = 0; i < all.size() && i < top_count; ++i)
+	{
+		const allocation_site& site = all[i];
+		printf("%18p %12lld %12lld %12lld %12lld  %s\n", site.address, 
+			(long long)site.live_bytes * rate, (long long)site.live_count * rate, 
+			(long long)site.total_bytes * rate, (long long)site.total_count * rate, 
+			nullptr != site.label ? site.label : "");
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void memory::set_budget(size_t bytes)
+{
+	s_budget.store(bytes);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+size_t memory::budget()
+{
+	return s_budget.load();
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+memory_pressure memory::pressure()
+{
+	const size_t limit = s_budget.load();
+	if (0 == limit)
+	{
+		return memory_pressure::none;
+	}
+
+	const int64_t live = stats().live_bytes();
+	const size_t used = 0 < live ? static_cast<size_t>(live) : 0;
+	if (used > limit)
+	{
+		return memory_pressure::critical;
+	}
+	return used >= limit - limit / 4 ? memory_pressure::moderate : memory_pressure::none;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+memory_pressure memory::collect()
+{	// Only a rise triggers a trim, pools are not trimmed repeatedly while usage stays at the same level
+	const memory_pressure level = pressure();
+	if (level > s_pressure.exchange(level))
+	{
+		trim(level);
+	}
+	return level;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+size_t memory::trim(memory_pressure level)
+{
+	trimmer_list& list = trimmers();
+	std::lock_guard<std::mutex> lock(list._lock);
+	size_t released = 0;
+	for (trimmer* item = list._head; nullptr != item; item = item->_next)
+	{
+		released += item->_trim(level);
+	}
+	return released;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+memory::trimmer::trimmer(callback trim)
+: _trim(std::move(trim))
+, _next(nullptr)
+, _prev(nullptr)
+{
+	trimmer_list& list = trimmers();
+	std::lock_guard<std::mutex> lock(list._lock);
+	_next = list._head;
+	if (nullptr != _next)
+	{
+		_next->_prev = this;
+	}
+	list._head = this;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+memory::trimmer::~trimmer()
+{
+	trimmer_list& list = trimmers();
+	std::lock_guard<std::mutex> lock(list._lock);
+	if (nullptr != _prev)
+	{
+		_prev->_next = _next;
+	}
+	else
+	{
+		list._head = _next;
+	}
+	if (nullptr != _next)
+	{
+		_next->_prev = _prev;
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+memory::site_scope::site_scope(const char* label)
+: _outer(t_site_label)
+{
+	t_site_label = label;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+memory::site_scope::~site_scope()
+{
+	t_site_label = _outer;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void* system_memory::allocate(size_t size, size_t alignment)
+{
+	if (alignment <= alignof(std::max_align_t))
+	{
+		return std::malloc(size);
+	}
+#if defined _MSC_VER
+	return _aligned_malloc(size, alignment);
+#else
+	return std::aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+#endif
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void system_memory::deallocate(void* ptr, size_t size, size_t alignment)
+{
+	(void)size;
+#if defined _MSC_VER
+	if (alignment > alignof(std::max_align_t))
+	{
+		_aligned_free(ptr);
+		return;
+	}
+#else
+	(void)alignment;
+#endif
+	std::free(ptr);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+pooled_memory::pooled_memory()
+: _pools(new size_class_allocator())
+{
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+pooled_memory::~pooled_memory()
+{
+	delete _pools;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void* pooled_memory::allocate(size_t size, size_t alignment)
+{
+	return _pools->try_allocate(size, alignment);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void pooled_memory::deallocate(void* ptr, size_t size, size_t alignment)
+{
+	_pools->deallocate(ptr, size, alignment);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+size_t pooled_memory::release()
+{
+	return _pools->release();
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+struct arena_memory::chunk
+{
+	chunk*			_next;
+	size_t			_size;
+	atomic<size_t>	_used;
+
+	uint8_t* data() { return reinterpret_cast<uint8_t*>(this + 1); }
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+arena_memory::arena_memory(size_t chunk_size)
+: _current(nullptr)
+, _chunk_size(chunk_size)
+{
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+arena_memory::~arena_memory()
+{
+	reset();
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void* arena_memory::allocate(size_t size, size_t alignment)
+{
+	for (;;)
+	{
+		chunk* current = _current.load();
+		if (nullptr != current)
+		{	// Bump the used count of the current chunk
+			const uintptr_t data = reinterpret_cast<uintptr_t>(current->data());
+			size_t used = current->_used.load();
+			for (;;)
+			{
+				const uintptr_t start = (data + used + alignment - 1) & ~(uintptr_t(alignment) - 1);
+				const size_t end = static_cast<size_t>(start - data) + size;
+				if (end > current->_size)
+				{
+					break;
+				}
+				if (current->_used.compare_exchange_weak(used, end))
+				{
+					return reinterpret_cast<void*>(start);
+				}
+			}
+		}
+
+		// Current chunk is full, start a new one
+		const size_t capacity = Max(_chunk_size, size + alignment);
+		void* block = memory::system().allocate(sizeof(chunk) + capacity, alignof(chunk));
+		if (nullptr == block)
+		{
+			return nullptr;
+		}
+		chunk* fresh = new (block) chunk();
+		fresh->_next = current;
+		fresh->_size = capacity;
+		fresh->_used.store(0);
+		if (!_current.compare_exchange_strong(current, fresh))
+		{	// Another thread added a chunk first, use that one
+			memory::system().deallocate(fresh, sizeof(chunk) + capacity, alignof(chunk));
+		}
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void arena_memory::deallocate(void* ptr, size_t size, size_t alignment)
+{
+	(void)ptr; (void)size; (void)alignment;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void arena_memory::reset()
+{
+	chunk* current = _current.exchange(nullptr);
+	while (nullptr != current)
+	{
+		chunk* next = current->_next;
+		memory::system().deallocate(current, sizeof(chunk) + current->_size, alignof(chunk));
+		current = next;
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+counting_memory::counting_memory(memory_backend& target)
+: _target(target)
+, _allocations(0)
+, _deallocations(0)
+{
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void* counting_memory::allocate(size_t size, size_t alignment)
+{
+	_allocations.fetch_add(1, std::memory_order_relaxed);
+	return _target.allocate(size, alignment);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void counting_memory::deallocate(void* ptr, size_t size, size_t alignment)
+{
+	_deallocations.fetch_add(1, std::memory_order_relaxed);
+	_target.deallocate(ptr, size, alignment);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+uint64_t counting_memory::allocations() const
+{
+	return _allocations.load(std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+uint64_t counting_memory::deallocations() const
+{
+	return _deallocations.load(std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void counting_memory::reset()
+{
+	_allocations.store(0, std::memory_order_relaxed);
+	_deallocations.store(0, std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void* operator new(size_t size)
+{
+	return allocate_or_throw(size, default_alignment, MARBLES_RETURN_ADDRESS());
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void* operator new[](size_t size)
+{
+	return allocate_or_throw(size, default_alignment, MARBLES_RETURN_ADDRESS());
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	return allocate_or_throw(size, static_cast<size_t>(alignment), MARBLES_RETURN_ADDRESS());
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+	return allocate_or_throw(size, static_cast<size_t>(alignment), MARBLES_RETURN_ADDRESS());
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return allocate(size, default_alignment, MARBLES_RETURN_ADDRESS());
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return allocate(size, default_alignment, MARBLES_RETURN_ADDRESS());
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return allocate(size, static_cast<size_t>(alignment), MARBLES_RETURN_ADDRESS());
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return allocate(size, static_cast<size_t>(alignment), MARBLES_RETURN_ADDRESS());
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void operator delete(void* p) noexcept
+{
+	deallocate(p, default_alignment);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void operator delete[](void* p) noexcept
+{
+	deallocate(p, default_alignment);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void operator delete(void* p, size_t size) noexcept
+{
+	deallocate_sized(p, size, default_alignment);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void operator delete[](void* p, size_t size) noexcept
+{
+	deallocate_sized(p, size, default_alignment);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void operator delete(void* p, std::align_val_t alignment) noexcept
+{
+	deallocate(p, static_cast<size_t>(alignment));
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void operator delete[](void* p, std::align_val_t alignment) noexcept
+{
+	deallocate(p, static_cast<size_t>(alignment));
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void operator delete(void* p, size_t size, std::align_val_t alignment) noexcept
+{
+	deallocate_sized(p, size, static_cast<size_t>(alignment));
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void operator delete[](void* p, size_t size, std::align_val_t alignment) noexcept
+{
+	deallocate_sized(p, size, static_cast<size_t>(alignment));
+}
 
 // --------------------------------------------------------------------------------------------------------------------
-void* operator new(size_t size/*, const char* filename = __FILE__, size_t line = __LINE__*/)
+void operator delete(void* p, const std::nothrow_t&) noexcept
 {
-	void* p = malloc(size);
-#if defined CONFIG_DEBUG
-	printf("%s(%d): Alloc(%d) 0x%X\n", "", 0, ++marbles::allocs, (unsigned)(p));
-#endif // defined CONFIG_DEBUG
-	return p;
+	deallocate(p, default_alignment);
 }
 
 // --------------------------------------------------------------------------------------------------------------------
-void* operator new[](size_t size, size_t N/*, const char* filename = __FILE__, size_t line = __LINE__*/)
+void operator delete[](void* p, const std::nothrow_t&) noexcept
 {
-	void* p = malloc(size*N);
-#if defined CONFIG_DEBUG
-	printf("%s(%d): Alloc(%d) 0x%X\n", "", 0, ++marbles::allocs, (unsigned)(p));
-#endif // defined CONFIG_DEBUG
-	return p;
+	deallocate(p, default_alignment);
 }
 
 // --------------------------------------------------------------------------------------------------------------------
-void operator delete(void*p)
+void operator delete(void* p, std::align_val_t alignment, const std::nothrow_t&) noexcept
 {
-	//	printf("%s(%d): free 0x%X\n", "", 0, (unsigned)(p));
-	free(p);
+	deallocate(p, static_cast<size_t>(alignment));
 }
 
 // --------------------------------------------------------------------------------------------------------------------
-void operator delete[](void*p)
+void operator delete[](void* p, std::align_val_t alignment, const std::nothrow_t&) noexcept
 {
-	//	printf("%s(%d): free 0x%X\n", "", 0, (unsigned)(p));
-	free(p);
+	deallocate(p, static_cast<size_t>(alignment));
 }
 
 // End of file --------------------------------------------------------------------------------------------------------
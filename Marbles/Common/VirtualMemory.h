@@ -0,0 +1,268 @@
+// This source file is part of marbles library.
+//
+// Copyright (c) 2023 Dan Cobban
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// --------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <Common/Common.h>
+#include <Common/Backoff.h>
+
+// --------------------------------------------------------------------------------------------------------------------
+namespace marbles
+{
+
+// --------------------------------------------------------------------------------------------------------------------
+// Platform address space reservation and commit
+class virtual_memory
+{
+public:
+	static size_t	page_size();
+	static size_t	huge_page_size();	// 0 when huge pages are unavailable
+
+	// Reserve inaccessible address space, nullptr on failure
+	static void*	reserve(size_t size);
+	static void		release(void* address, size_t size);
+
+	// Make reserved pages accessible, hint that huge pages should back them when huge is set
+	// @return			false if the pages could not be committed
+	static bool		commit(void* address, size_t size, bool huge = false);
+
+	// Return the physical pages to the system while keeping the address range reserved
+	static void		decommit(void* address, size_t size);
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// Slab source for block_allocator using the aligned global operator new
+class heap_slabs
+{
+public:
+	void* allocate(size_t size, size_t alignment)
+	{
+		return ::operator new(size, std::align_val_t(alignment), std::nothrow);
+	}
+
+	void deallocate(void* slab, size_t size, size_t alignment)
+	{
+		(void)size;
+		::operator delete(slab, std::align_val_t(alignment));
+	}
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+// Slab source carving slabs from one address space reservation. Memory is committed commit_size at a time with a 
+// huge page hint, slabs returned by the allocator are decommitted and reused before the reservation grows. Requests
+// beyond the reservation, all requests if it could not be made, and requests whose pages could not be committed fall 
+// back to heap_slabs. Pages provides the virtual_memory interface.
+template<size_t reserve_size = 1024 * mb, size_t commit_size = 2 * mb, bool huge_pages = true, typename Pages = virtual_memory>
+class virtual_slabs
+{
+public:
+	virtual_slabs()
+	: _base(static_cast<uint8_t*>(Pages::reserve(reserve_size + commit_size)))
+	, _used(0)
+	, _unit(0)
+	, _free(0)
+	, _links(nullptr)
+	{
+		if (nullptr != _base)
+		{	// Over reserved by commit_size so the slabs can be aligned to the commit chunks
+			_aligned = reinterpret_cast<uint8_t*>((reinterpret_cast<uintptr_t>(_base) + commit_size - 1) & ~(uintptr_t(commit_size) - 1));
+		}
+		for (auto& state : _chunks)
+		{
+			state.store(uncommitted);
+		}
+	}
+
+	~virtual_slabs()
+	{
+		if (nullptr != _base)
+		{
+			Pages::release(_base, reserve_size + commit_size);
+		}
+		if (nullptr != _links)
+		{
+			memory::system().deallocate(_links, num_units(_unit) * sizeof(atomic<uint32_t>), alignof(atomic<uint32_t>));
+		}
+	}
+
+	virtual_slabs(const virtual_slabs&) = delete;
+	virtual_slabs& operator=(const virtual_slabs&) = delete;
+
+	// Is the reservation in place, false when every slab comes from the heap
+	bool reserved() const
+	{
+		return nullptr != _base;
+	}
+
+	// Bytes of the reservation handed out so far
+	size_t bytes_used() const
+	{
+		return Min(_used.load(), reserve_size);
+	}
+
+	void* allocate(size_t size, size_t alignment)
+	{
+		if (!reserved() || size != alignment || size > commit_size || !bind_unit(size))
+		{
+			return _heap.allocate(size, alignment);
+		}
+
+		// Reuse a decommitted slab first
+		const uint32_t index = pop_free();
+		if (no_unit != index)
+		{
+			uint8_t* slab = _aligned + size_t(index) * size;
+			if (Pages::commit(slab, size))
+			{
+				return slab;
+			}
+			// Keep the slab for a later attempt, the heap serves this one
+			push_free(index);
+			return _heap.allocate(size, alignment);
+		}
+
+		const size_t offset = _used.fetch_add(size);
+		if (offset + size > reserve_size)
+		{	// Reservation exhausted
+			return _heap.allocate(size, alignment);
+		}
+		if (!commit_chunk(offset / commit_size))
+		{	// Keep the claimed slab for a later attempt, the heap serves this one
+			push_free(static_cast<uint32_t>(offset / size));
+			return _heap.allocate(size, alignment);
+		}
+		return _aligned + offset;
+	}
+
+	void deallocate(void* slab, size_t size, size_t alignment)
+	{
+		uint8_t* address = static_cast<uint8_t*>(slab);
+		if (!reserved() || address < _aligned || address >= _aligned + reserve_size)
+		{
+			_heap.deallocate(slab, size, alignment);
+			return;
+		}
+
+		Pages::decommit(address, size);
+		push_free(static_cast<uint32_t>((address - _aligned) / size));
+	}
+
+private:
+	static const uint32_t no_unit = ~0u;
+	static const size_t num_chunks = (reserve_size + commit_size - 1) / commit_size;
+	enum chunk_state : uint8_t { uncommitted, committing, committed, failed };
+
+	static size_t num_units(size_t unit) { return 0 != unit ? reserve_size / unit : 0; }
+
+	// Every slab from the reservation must be the same size, the first request decides it
+	bool bind_unit(size_t size)
+	{
+		size_t unit = _unit.load();
+		if (0 == unit)
+		{	// Links for the stack of free slabs come from the system so the slab source never recurses
+			const size_t bytes = num_units(size) * sizeof(atomic<uint32_t>);
+			void* links = memory::system().allocate(bytes, alignof(atomic<uint32_t>));
+			if (nullptr == links)
+			{
+				return false;
+			}
+			if (_unit.compare_exchange_strong(unit, size))
+			{
+				_links = static_cast<atomic<uint32_t>*>(links);
+				for (size_t i = 0; i < num_units(size); ++i)
+				{
+					new (_links + i) atomic<uint32_t>(0);
+				}
+				_ready.store(true);
+				return true;
+			}
+			memory::system().deallocate(links, bytes, alignof(atomic<uint32_t>));
+		}
+
+		exponential_backoff<> backoff;
+		while (unit == size && !_ready.load())
+		{	// Another thread is publishing the links
+			backoff();
+		}
+		return unit == size;
+	}
+
+	// Commit the chunk once, threads needing a chunk that is being committed wait for it
+	bool commit_chunk(size_t chunk)
+	{
+		atomic<uint8_t>& state = _chunks[chunk];
+		uint8_t current = state.load();
+		if (uncommitted == current && state.compare_exchange_strong(current, committing))
+		{
+			current = Pages::commit(_aligned + chunk * commit_size, commit_size, huge_pages) ? committed : failed;
+			state.store(current);
+		}
+
+		exponential_backoff<> backoff;
+		while (committing == current)
+		{
+			backoff();
+			current = state.load();
+		}
+		return committed == current;
+	}
+
+	// Lock-free stack of slab indices, the head packs a tag above the index to avoid ABA
+	uint32_t pop_free()
+	{
+		uint64_t head = _free.load();
+		while (0 != static_cast<uint32_t>(head))
+		{
+			const uint32_t index = static_cast<uint32_t>(head) - 1;
+			const uint64_t next = ((head >> 32) + 1) << 32 | _links[index].load();
+			if (_free.compare_exchange_weak(head, next))
+			{
+				return index;
+			}
+		}
+		return no_unit;
+	}
+
+	void push_free(uint32_t index)
+	{
+		uint64_t head = _free.load();
+		do {
+			_links[index].store(static_cast<uint32_t>(head));
+		} while (!_free.compare_exchange_weak(head, ((head >> 32) + 1) << 32 | (index + 1)));
+	}
+
+	uint8_t*			_base;
+	uint8_t*			_aligned = nullptr;
+	atomic<size_t>		_used;
+	atomic<size_t>		_unit;
+	atomic<bool>		_ready{ false };
+	atomic<uint64_t>	_free;		// (tag << 32) | (index + 1), 0 when empty
+	atomic<uint32_t>*	_links;		// Next free slab index + 1 for each slab
+	atomic<uint8_t>		_chunks[num_chunks];
+	heap_slabs			_heap;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+} // namespace marbles
+
+// End of file --------------------------------------------------------------------------------------------------------
@@ -11,13 +11,6 @@ extern "C" FILE * __cdecl __iob_func(void)
 }
 #endif // #if !defined NDEBUG
 
-#if defined CONFIG_DEBUG
-namespace marbles
-{
-	int allocs = 0;
-}
-#endif // defined CONFIG_DEBUG
-
 //#include "behaviour\Behaviour.h"
 
 //int UserTask(void* user)
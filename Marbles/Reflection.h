@@ -27,16 +27,20 @@
 #include <common/common.h>
 #include <reflection/traits.h>
 #include <reflection/typeOf.h>
+#include <reflection/statictype.h>
 #include <reflection/declaration.h>
 #include <reflection/type.h>
 #include <reflection/path.h>
 #include <reflection/member.h>
 #include <reflection/object.h>
+#include <reflection/objectview.h>
+#include <reflection/compiledpath.h>
 #include <reflection/value.h>
 #include <reflection/field.h>
 #include <reflection/property.h>
 #include <reflection/method.h>
 #include <reflection/primitives.h>
+#include <reflection/soavector.h>
 //#include <reflection/serialization.h>
 
 // End of file --------------------------------------------------------------------------------------------------------
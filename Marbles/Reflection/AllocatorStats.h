@@ -0,0 +1,41 @@
+// This source file is part of marbles library.
+//
+// Copyright (c) 2012 Dan Cobban
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// --------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <Common/Memory.h>
+#include <Reflection.h>
+
+// --------------------------------------------------------------------------------------------------------------------
+// Reflection of the allocator counters, kept out of Primitives.h so only tools that inspect pools pull it in
+REFLECT_TYPE(marbles::allocator_stats,
+	REFLECT_CREATOR()
+	REFLECT_MEMBER("reserved", &marbles::allocator_stats::reserved)
+	REFLECT_MEMBER("available", &marbles::allocator_stats::available)
+	REFLECT_MEMBER("outstanding", &marbles::allocator_stats::outstanding)
+	REFLECT_MEMBER("peak_outstanding", &marbles::allocator_stats::peak_outstanding)
+	REFLECT_MEMBER("reserve_calls", &marbles::allocator_stats::reserve_calls)
+	REFLECT_MEMBER("failed_allocations", &marbles::allocator_stats::failed_allocations)
+	REFLECT_MEMBER("retries", &marbles::allocator_stats::retries))
+
+// End of file --------------------------------------------------------------------------------------------------------
@@ -0,0 +1,156 @@
+// This source file is part of marbles library.
+//
+// Copyright (c) 2023 Dan Cobban
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// --------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+// --------------------------------------------------------------------------------------------------------------------
+namespace marbles
+{
+namespace reflection
+{
+
+// A path resolved once against a root type. Each step keeps the member it passes through and the offset of its field
+// so applying the path to any object of the root type walks it in O(depth) without name lookups. A step through a
+// reference dereferences it first, a step into a member without storage is resolved by the member.
+// {
+//   compiled_path route(type_of<Foo>(), "Bar.shared_foo.X");
+//   int& x = route.apply(foo).as<int>();
+// }
+// --------------------------------------------------------------------------------------------------------------------
+class compiled_path
+{
+public:
+	compiled_path();
+	compiled_path(const shared_type& root, const path& route);
+
+	bool					isValid() const			{ return !mSteps.empty(); }
+	const shared_type&		root() const			{ return mRoot; }
+	shared_member			leaf() const;
+	size_t					depth() const			{ return mSteps.size(); }
+
+	object_view				apply(const object_view& obj) const; // obj must be a value of root()
+
+private:
+	struct step
+	{
+		shared_member		mMember;
+		object_view			mField;			// View of the field at offset mOffset, address unset
+		size_t				mOffset;
+		bool				mStored;		// The member is a field, otherwise the member resolves the value
+		bool				mDereference;	// The previous value is a reference to the value holding the member
+	};
+	typedef vector<step>	step_list;
+
+	shared_type				mRoot;
+	step_list				mSteps;
+};
+
+// Least recently used cache of compiled paths keyed by root type and path string. Safe to use from multiple threads.
+// {
+//   path_cache cache;
+//   object_view x = cache.compile(type_of<Foo>(), "Bar.shared_foo.X")->apply(foo);
+// }
+// --------------------------------------------------------------------------------------------------------------------
+class path_cache
+{
+public:
+	typedef shared_ptr<const compiled_path> shared_path;
+	static const size_t default_capacity = 256;
+
+	explicit path_cache(size_t capacity = default_capacity);
+
+	shared_path				compile(const shared_type& root, const char* route); // Compiles and caches on a miss
+	shared_path				compile(const shared_type& root, const string& route) { return compile(root, route.c_str()); }
+
+	size_t					size() const;
+	size_t					capacity() const		{ return mCapacity; }
+	void					clear();
+
+private:
+	struct entry
+	{
+		hash_t				mKey;
+		const type_info*	mRoot;
+		string				mRoute;
+		shared_path			mPath;
+	};
+	typedef std::list<entry> entry_list;	// Most recently used first
+	typedef std::unordered_map<hash_t, entry_list::iterator> entry_index;
+
+	mutable std::mutex		mLock;
+	entry_list				mEntries;
+	entry_index				mIndex;
+	const size_t			mCapacity;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+inline compiled_path::compiled_path()
+{
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+inline shared_member compiled_path::leaf() const
+{
+	return mSteps.empty() ? shared_member() : mSteps.back().mMember;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+inline object_view compiled_path::apply(const object_view& obj) const
+{
+	ASSERT(!isValid() || !obj.isValid() || obj.typeInfo() == mRoot.get());
+	object_view view = isValid() ? obj : object_view();
+	for (const step& next : mSteps)
+	{
+		if (next.mDereference)
+		{
+			view = *view;
+		}
+		if (NULL == view.mAddress)
+		{
+			return object_view();
+		}
+		else if (next.mStored)
+		{	// The field keeps any lock taken on the value holding it
+			void* address = static_cast<char*>(view.mAddress) + next.mOffset;
+			shared_ptr<void> locked = move(view.mLocked);
+			view = next.mField;
+			view.mAddress = address;
+			view.mLocked = move(locked);
+		}
+		else
+		{
+			view = view.at(next.mMember);
+		}
+	}
+	return view;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+} // namespace reflection
+} // namespace marbles
+
+// End of file --------------------------------------------------------------------------------------------------------
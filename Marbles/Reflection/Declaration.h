@@ -81,7 +81,17 @@ public:
 	{
 	}
 
+	// Declares a call of a method member, objects of it refer to the value the method is called on
+	static declaration callable(shared_member member)
+	{
+		declaration info(member);
+		info.semantic = Function;
+		return info;
+	}
+
 protected:
+	friend class object_view;
+
 	enum reference_semantic
 	{
 		Value = 0,	
@@ -46,7 +46,9 @@ public:
 	virtual object dereference(const object& self) const
 	{
 		assert(self.typeInfo()->implements( type_of<member_type>() ));
-		member_type* member = self.as<member_type*>();
+		// as<member_type*>() would return the pointer held by a temporary when self is a reference
+		void* address = self.isReference() ? (*self).address() : self.address();
+		member_type* member = static_cast<member_type*>(address);
 		return object(memberT<T>::declare_info(), member ? &(member->*mField) : 0);
 	}
 
@@ -31,6 +31,7 @@ namespace marbles
 namespace reflection
 {
 class object;
+class object_view;
 template<typename T> class memberT;
 
 // --------------------------------------------------------------------------------------------------------------------
@@ -48,16 +49,28 @@ public:
 	virtual bool		callable() const	{ return false; }
 	virtual bool		readOnly() const	{ return false; }
 	virtual shared_type typeInfo() const	{ return mType.lock(); }
-	virtual object		assign(object& self, const object& rhs) const;
+	const type_info*	typePtr() const		{ return mTypePtr; } // Avoids locking mType, valid while the type is registered
+	object				assign(object& self, const object& rhs) const;
+	virtual void		assign(const object_view& self, const object_view& rhs) const;
+	virtual bool		equal(const object_view& self, const object_view& rhs) const; // self and rhs are values
 	virtual object		dereference(const object& self) const;
 	virtual object		append(object& self) const;
 	virtual object		call(object& self, object* pObjs, unsigned count) const;
+	virtual bool		invoke(const object_view& self, object* pObjs, unsigned count, const object_view& result) const;
 
 private:
+	friend class object_view;
+
+	// Visits the non-callable members of type. Runs of adjacent fields accepted by bulk are passed to run as one byte
+	// range, every other member is passed to single. Stops at the first visitor to return false.
+	template<typename Bulk, typename Run, typename Single>
+	static bool			visitMembers(const type_info& type, Bulk bulk, Run run, Single single);
+
 	string			    mName;
 	hash_t				mHashName;
 	declaration			mDeclaration;
 	weak_type			mType;
+	const type_info*	mTypePtr;
 	const char*			mUsage;
 };
 
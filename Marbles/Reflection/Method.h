@@ -28,64 +28,72 @@ namespace marbles
 {
 namespace reflection
 {
+
+// Binds one argument of a method call to the value an object refers to. Arguments taken by reference or pointer refer
+// to that value directly, only arguments taken by value are copied. A constant value is only bound where the argument
+// is taken by value or refers to a const type.
 // --------------------------------------------------------------------------------------------------------------------
-template<typename R, typename T> 
-class memberT<R (T::*)()> : public memberT<R>
+template<typename A>
+struct method_argument
 {
-public:
-	typedef R return_type;
-	typedef R (T::*member_type)();
-	typedef R (T::*signature_type)();
+	typedef typename by_value<A>::type value_type;
+	typedef typename std::remove_pointer<typename remove_reference<A>::type>::type referred_type;
+	static const bool isPointer = std::is_pointer<typename remove_reference<A>::type>::value;
+	static const bool isMutable = (isPointer || std::is_reference<A>::value) && !std::is_const<referred_type>::value;
 
-	memberT(const std::string& name, signature_type method, const char* usage)
-	: memberT<return_type>(name, declarationT<return_type>(), usage)
-	, mMethod(method)
+	static void* valueAddress(const object_view& arg)
 	{
+		return arg.isReference() ? (*arg).address() : arg.address();
 	}
 
-	virtual bool		callable() const { return true; }
-	virtual bool		readOnly() const { return true; }
-
-	virtual object		dereference(const object& self) const
+	static bool accepts(const object_view& arg, hash_t hashName)
 	{
-		declaration info(this->shared_from_this(), declarationT<member_type>());
-		object value(info, self.address());
-		return value;
-	}
-	virtual object		assign(object& self, const object& rhs) const
-	{
-		return member::assign(self, rhs);
+		return	arg.isValid() && NULL != arg.typeInfo() && hashName == arg.typeInfo()->hashName() &&
+				(!isMutable || !arg.isConstant()) &&
+				(isPointer || NULL != valueAddress(arg)); // Only a pointer may be null
 	}
-	virtual object		call(object& self, object* pObjs, unsigned count) const
+
+	static A bind(const object_view& arg)
 	{
-		object result;
-		// if (count == function_traits<
-		// validateParameters(pObjs, count);
-		// validate each parameter
-		// execute callback
+		value_type* value = static_cast<value_type*>(valueAddress(arg));
+		if constexpr (isPointer)
+		{
+			return value;
+		}
+		else if constexpr (std::is_rvalue_reference<A>::value)
+		{
+			return move(*value);
+		}
+		else
+		{
+			return *value;
+		}
 	}
-
-private:
-	member_type mMethod;
-};
-
-template<typename R, typename T> struct type_of_t<R (T::*)()>
-{ 
-	static shared_type typeInfo() { return type_of< std::function<R ()> >(); } 
 };
 
+// Reflected method of C, which is const qualified for const methods. Each signature instantiates its own call thunk
+// when the method is registered, the thunk checks the arguments against the parameter types recorded then and binds
+// them in place from the caller's array of objects.
+// {
+//   object args[] = { object(amount), object(note) };
+//   object balance = account.memberInfo("deposit")->call(account, args, 2);
+// }
 // --------------------------------------------------------------------------------------------------------------------
-template<typename R, typename T> 
-class memberT<R (T::*)() const> : public memberT<R>
+template<typename M, typename C, typename R, typename... Args>
+class methodT : public member
 {
 public:
 	typedef R return_type;
-	typedef R (T::*member_type)() const;
-	typedef R (T::*signature_type)() const;
+	typedef M member_type;
+	typedef M signature_type;
+	typedef typename remove_cv<typename remove_reference<R>::type>::type value_type;
+	static const unsigned arity = sizeof...(Args);
 
-	memberT(const std::string& name, signature_type method, const char* usage)
-	: memberT<return_type>(name, declarationT<return_type>(), usage)
+	methodT(const string& name, signature_type method, const char* usage)
+	: member(name, returnDeclaration(), usage)
 	, mMethod(method)
+	, mOwner(type_of<typename remove_cv<C>::type>())
+	, mParameters{ type_of<typename method_argument<Args>::value_type>()->hashName()... }
 	{
 	}
 
@@ -94,32 +102,154 @@ public:
 
 	virtual object		dereference(const object& self) const
 	{
-		declaration info(this->shared_from_this(), declarationT<member_type>());
-		object value(info, self.address());
+		object value(declaration::callable(this->shared_from_this()), self.address());
 		return value;
 	}
-	virtual object		assign(object& self, const object& rhs) const
-	{
-		return member::assign(self, rhs);
-	}
+
+	// Returns the result of the call, a returned value is held by the object and a returned reference is referred to
+	// by it. Returns an invalid object when the arguments do not match the parameters.
 	virtual object		call(object& self, object* pObjs, unsigned count) const
 	{
-		(void)count; (void)pObjs; (void)self;
 		object result;
-		// if (count == function_traits<
-		// validateParameters(pObjs, count);
-		// validate each parameter
-		// execute callback
+		C* target = targetOf(self, pObjs, count);
+		if (NULL == target)
+		{
+			return result;
+		}
+
+		if constexpr (std::is_void<R>::value)
+		{
+			apply(*target, pObjs, std::index_sequence_for<Args...>());
+		}
+		else if constexpr (std::is_reference<R>::value)
+		{
+			R value = apply(*target, pObjs, std::index_sequence_for<Args...>());
+			object reference(declarationT<typename remove_reference<R>::type>(), const_cast<value_type*>(&value));
+			result.swap(reference);
+		}
+		else
+		{
+			shared_ptr<value_type> value = make_shared<value_type>(apply(*target, pObjs, std::index_sequence_for<Args...>()));
+			object returned(declarationT<value_type>(), static_pointer_cast<void>(value));
+			result.swap(returned);
+		}
 		return result;
 	}
 
+	// Assigns the result of the call to result, nothing is allocated. An invalid result discards the returned value.
+	virtual bool		invoke(const object_view& self, object* pObjs, unsigned count, const object_view& result) const
+	{
+		C* target = targetOf(self, pObjs, count);
+		if constexpr (!std::is_void<R>::value)
+		{
+			if (NULL != target && result.isValid())
+			{
+				value_type* out = outputOf(result);
+				if (NULL != out)
+				{
+					*out = apply(*target, pObjs, std::index_sequence_for<Args...>());
+					return true;
+				}
+				return false;
+			}
+		}
+
+		if (NULL != target)
+		{
+			apply(*target, pObjs, std::index_sequence_for<Args...>());
+		}
+		return NULL != target;
+	}
+
 private:
-	member_type mMethod;
+	static declaration	returnDeclaration()
+	{
+		if constexpr (std::is_void<R>::value)
+		{
+			return declaration();
+		}
+		else
+		{
+			return declarationT<typename remove_reference<R>::type>();
+		}
+	}
+
+	// Any type implementing the owner may be the target, the owner type is held weakly since it holds this method
+	C*					targetOf(const object_view& self, object* pObjs, unsigned count) const
+	{
+		if (arity != count || !self.isValid() || NULL == self.typeInfo() || !self.typeInfo()->implements(mOwner.lock()) || 
+			(!std::is_const<C>::value && self.isConstant()) || !accepts(pObjs, std::index_sequence_for<Args...>()))
+		{
+			return NULL;
+		}
+		return static_cast<C*>(method_argument<C&>::valueAddress(self));
+	}
+
+	template<size_t... I>
+	bool				accepts(const object* pObjs, std::index_sequence<I...>) const
+	{
+		(void)pObjs;
+		return (method_argument<Args>::accepts(pObjs[I], mParameters[I]) && ...);
+	}
+
+	template<size_t... I>
+	R					apply(C& target, object* pObjs, std::index_sequence<I...>) const
+	{
+		(void)pObjs;
+		return (target.*mMethod)(method_argument<Args>::bind(pObjs[I])...);
+	}
+
+	value_type*			outputOf(const object_view& result) const
+	{	// A pointer is returned into the pointer a reference holds, any other value into the value referred to
+		if (result.isConstant() || NULL == result.typeInfo() || typePtr() != result.typeInfo())
+		{
+			return NULL;
+		}
+		if constexpr (std::is_pointer<value_type>::value)
+		{
+			return result.isReference() ? static_cast<value_type*>(result.address()) : NULL;
+		}
+		else
+		{
+			return static_cast<value_type*>(method_argument<value_type&>::valueAddress(result));
+		}
+	}
+
+	member_type			mMethod;
+	weak_type			mOwner;
+	hash_t				mParameters[0 < arity ? arity : 1];
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+template<typename R, typename T, typename... Args> 
+class memberT<R (T::*)(Args...)> : public methodT<R (T::*)(Args...), T, R, Args...>
+{
+public:
+	memberT(const string& name, R (T::*method)(Args...), const char* usage)
+	: methodT<R (T::*)(Args...), T, R, Args...>(name, method, usage)
+	{
+	}
+};
+
+template<typename R, typename T, typename... Args> struct type_of_t<R (T::*)(Args...)>
+{ 
+	static shared_type typeInfo() { return type_of< std::function<R (Args...)> >(); } 
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+template<typename R, typename T, typename... Args> 
+class memberT<R (T::*)(Args...) const> : public methodT<R (T::*)(Args...) const, const T, R, Args...>
+{
+public:
+	memberT(const string& name, R (T::*method)(Args...) const, const char* usage)
+	: methodT<R (T::*)(Args...) const, const T, R, Args...>(name, method, usage)
+	{
+	}
 };
 
-template<typename R, typename T> struct type_of_t<R (T::*)() const>
+template<typename R, typename T, typename... Args> struct type_of_t<R (T::*)(Args...) const>
 { 
-	static shared_type typeInfo() { return type_of< std::function<R ()> >(); } 
+	static shared_type typeInfo() { return type_of< std::function<R (Args...)> >(); } 
 };
 
 // --------------------------------------------------------------------------------------------------------------------
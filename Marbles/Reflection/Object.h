@@ -29,7 +29,9 @@ namespace marbles
 namespace reflection
 {
 class object;
+class object_view;
 typedef vector<object> ObjectList;
+typedef vector<object_view> ViewList;
 typedef map<hash_t, object> ObjectMap;
 
 #pragma warning(push)
@@ -38,6 +40,8 @@ typedef map<hash_t, object> ObjectMap;
 // --------------------------------------------------------------------------------------------------------------------
 class object
 {
+	template<typename T>	struct To;
+
 public:
 	object();
 	~object();
@@ -76,8 +80,8 @@ public:
 	shared_member			memberInfo(hash_t hashName) const;
 	const type_info::member_list& members() const	{ return typeInfo()->members(); }
 
-	template<typename T>	T& as();
-	template<typename T>	T& as() const;
+	template<typename T>	typename To<T>::result as();
+	template<typename T>	typename To<T>::result as() const;
 
 	object					at(const char* name) const;
 	object					at(const string& name) const;
@@ -100,7 +104,6 @@ public:
 	template<typename T>	static void create(object& obj);
 	template<typename T>	static void createShared(object& obj);
 private:
-	template<typename T>	struct To;
 	template<typename T>	struct Put;
 
 	bool	                _IsZero() const;
@@ -110,6 +113,7 @@ private:
 	void	                _SetAddress(void* p);
 
 	friend class declaration;
+	friend class object_view;
 	declaration				mInfo;		// Description of how to interpret mPointee
 	shared_ptr<void>	    mPointee;	// Generic reference to the object
 };
@@ -142,38 +146,64 @@ template<typename T> struct Put
 // --------------------------------------------------------------------------------------------------------------------
 template<typename T> struct object::To
 {
+	typedef T& result;
+
 	static T& from(const object& obj) 
 	{ 
 		return *To<T*>::from(obj); 
 	}
+
+	static T& fromReference(const object& obj) 
+	{ 
+		T* pointee = To<T*>::pointee(obj);
+		ASSERT(NULL != pointee); // A null or expired reference has no value, read it with as<T*>() to test it first
+		return *pointee; 
+	}
 };
 
 // --------------------------------------------------------------------------------------------------------------------
 template<typename T> struct object::To<T*>
 {
+	typedef T* result; // Read by value, a weak reference holds no raw pointer that could be referred to
+
 	static T*& from(const object& obj)
 	{	// TODO: check readonly flag here
 		typedef remove_cv<T>::type NoConstT;
 		const void* address = &obj.mPointee;
 		return const_cast<T*&>(*reinterpret_cast<NoConstT* const *>(address));
 	}
+
+	static T* fromReference(const object& obj)
+	{
+		return pointee(obj);
+	}
+
+	// Address the reference refers to, a weak reference is locked so an expired one yields NULL
+	static T* pointee(const object& obj)
+	{
+		typedef remove_cv<T>::type NoConstT;
+		if (obj.isWeak())
+		{
+			return static_cast<T*>(reinterpret_cast<const weak_ptr<void>*>(obj.address())->lock().get());
+		}
+		return *reinterpret_cast<NoConstT* const *>(obj.address());
+	}
 };
 
 // --------------------------------------------------------------------------------------------------------------------
 #pragma warning ( disable : 4172 ) // C4172 : multiple copy constructors specified
-template<typename T> inline T& object::as()
+template<typename T> inline typename object::To<T>::result object::as()
 {
 	if (isReference())
-	{
-		object deref(*(*this));
-		return To<T>::from(deref); 
+	{	// Read through the stored pointer, a dereferenced temporary would not outlive the call
+		return To<T>::fromReference(*this); 
 	}
 	return To<T>::from(*this); 
 }
 #pragma warning ( default : 4172 ) // C4172 : multiple copy constructors specified
 
 // --------------------------------------------------------------------------------------------------------------------
-template<typename T> inline	T& object::as() const
+template<typename T> inline	typename object::To<T>::result object::as() const
 { 
 	return const_cast<object*>(this)->as<T>();
 }
@@ -285,9 +315,28 @@ inline void object::_SetAddress(void* p)
 // --------------------------------------------------------------------------------------------------------------------
 template<typename T>
 shared_type type_info::builder::create(const char* name)
+{
+	return create<T>(name, NULL);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+template<typename T>
+shared_type type_info::builder::create(const static_type_info& info)
+{
+	return create<T>(info.name, &info);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+template<typename T>
+shared_type type_info::builder::create(const char* name, const static_type_info* info)
 {
 	shared_ptr<type_info> candidate = shared_ptr<type_info>(new type_info());
 	shared_type type = const_pointer_cast<const type_info>(candidate);
+	candidate->mStatic = info;
+	if (NULL != info)
+	{
+		candidate->reserveMembers(info->memberCount, info->fieldCount);
+	}
 
 	unsigned numberOfParameters = template_traits<typename by_value<T>::type>::parameter_count();
 	candidate->mParameters.reserve(numberOfParameters);
@@ -298,9 +347,11 @@ shared_type type_info::builder::create(const char* name)
 	string fullname = template_traits<typename by_value<T>::type>::type_name(name);
 	shared_ptr< memberT<T> > mem = make_shared< memberT<T> >(move(fullname), type, "Default value type_info member.");
 	candidate->mByValue = declaration(static_pointer_cast<member>(mem));
+	candidate->mHashName = mem->hashName();
+	ASSERT(NULL == info || 0 == info->hash || info->hash == candidate->mHashName);
 
-	if (type_info::_register(type))
-	{
+	if (!type_info::find(candidate->mHashName))
+	{	// Registered by finalize() once it is defined
 		mBuild.swap(candidate);
 	}
 	else
@@ -313,6 +364,9 @@ shared_type type_info::builder::create(const char* name)
 		setCreator(&object::create<void>);
 		setAlignment(alignment_of<T>::value);
 		setSize(sizeof(T));
+		mBuild->mKind = primitive_kind_of<T>();
+		mBuild->mTriviallyCopyable = std::is_trivially_copyable<T>::value;
+		mBuild->mTriviallyComparable = is_trivially_comparable<T>::value;
 	}
 
 	return type;
@@ -331,7 +385,12 @@ template<typename T> void type_info::builder::addMember(const char* name, T memb
 	shared_member memberInfo = make_shared< memberT<member_type> >(name, member, description);
 	if (memberInfo)
 	{
-		mBuild->mMembers.push_back(memberInfo);
+		mBuild->addMember(memberInfo);
+		if constexpr (std::is_member_object_pointer<member_type>::value)
+		{
+			const uint32_t index = static_cast<uint32_t>(mBuild->mMembers.size() - 1);
+			mBuild->mFields.push_back(describe_field(member, index));
+		}
 	}
 }
 
@@ -342,7 +401,7 @@ template<typename R, typename T> void type_info::builder::addMember(const char*
 	shared_member memberInfo = std::make_shared< memberT<member_type> >(name, member, description);
 	if (memberInfo)
 	{
-		mBuild->mMembers.push_back(memberInfo);
+		mBuild->addMember(memberInfo);
 	}
 }
 
@@ -352,7 +411,7 @@ template<typename R, typename T> void type_info::builder::addMember(const char*
 	shared_member memberInfo = std::make_shared< memberT<R(T::*)() const> >(name, member, description);
 	if (memberInfo)
 	{
-		mBuild->mMembers.push_back(memberInfo);
+		mBuild->addMember(memberInfo);
 	}
 }
 
@@ -0,0 +1,142 @@
+// This source file is part of marbles library.
+//
+// Copyright (c) 2023 Dan Cobban
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// --------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+// --------------------------------------------------------------------------------------------------------------------
+namespace marbles
+{
+namespace reflection
+{
+
+// Non-owning view of a reflected value for transient traversal. A view holds the address, type and member of a value 
+// as raw pointers so copying and walking it never touches a reference count. A view must not outlive the object it 
+// was taken from, convert it with toObject() when a value needs to be kept. The exception is a value reached through 
+// a weak reference, the view and the views taken from it hold the locked pointer so the value outlives them.
+// {
+//   object_view view(obj);
+//   int& x = view.at("X").as<int>();
+// }
+// --------------------------------------------------------------------------------------------------------------------
+class object_view
+{
+public:
+	object_view();
+	object_view(const object& obj);
+
+	bool					isValid() const			{ return nullptr != mAddress && nullptr != mMember; }
+	bool					IsEnumerable() const	{ return false; }
+	bool					isCallable() const		{ return declaration::Function == mSemantic; }
+	bool					isConstant() const		{ return mConstant; }
+	bool					isValue() const			{ return declaration::Value == mSemantic; }
+	bool					isReference() const		{ return !isValue() & !isCallable(); }
+	bool					isShared() const		{ return declaration::Shared == mSemantic; }
+	bool					isWeak() const			{ return declaration::Weak == mSemantic; }
+
+	void*					address() const			{ return mAddress; }
+	hash_t					hashName() const;
+	const type_info*		typeInfo() const		{ return mType; }
+	const member*			memberInfo() const		{ return mMember; }
+	const type_info::member_list& members() const	{ return mType->members(); }
+
+	template<typename T>	T& as() const;
+
+	object_view				at(const char* name) const		{ return at(type_info::hash(name)); }
+	object_view				at(const hash_t hashName) const;
+	object_view				at(const shared_member& member) const;
+	object_view				operator*() const;
+
+	bool					assign(const object_view& rhs) const;
+	bool					assignZero() const;
+	bool					identical(const object_view& view) const;
+	bool					equal(const object_view& view) const; // Values compare deeply, references by address
+	object					toObject() const; // The object does not share ownership of the value
+
+private:
+	object_view(const declaration& info, void* address, bool constant);
+	object_view				atIndex(type_info::member_list::size_type index) const;
+	static object_view		fieldOf(const member& member, void* address); // View of a data member stored at address
+
+	friend class compiled_path;
+	template<typename T> friend class soa_vector;
+
+	void*					mAddress;	// Address of the value, or of the pointer when a reference
+	const type_info*		mType;
+	const member*			mMember;
+	uint8_t					mSemantic;
+	bool					mConstant;
+	bool					mOwned;		// Reached through a shared reference, matches object::hashName()
+	shared_ptr<void>		mLocked;	// Value reached through a weak reference, kept alive while viewed
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+inline object_view::object_view()
+: mAddress(nullptr)
+, mType(nullptr)
+, mMember(nullptr)
+, mSemantic(declaration::Value)
+, mConstant(false)
+, mOwned(false)
+{
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+inline object_view::object_view(const object& obj) // Implicit so objects can be passed where a view is expected
+: mAddress(obj.address())
+, mType(obj.mInfo.member ? obj.mInfo.member->typePtr() : nullptr)
+, mMember(obj.mInfo.member.get())
+, mSemantic(obj.mInfo.semantic)
+, mConstant(obj.mInfo.is_constant)
+, mOwned(0 != obj.mPointee.use_count())
+{
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+inline object_view::object_view(const declaration& info, void* address, bool constant)
+: mAddress(address)
+, mType(info.member ? info.member->typePtr() : nullptr)
+, mMember(info.member.get())
+, mSemantic(info.semantic)
+, mConstant(constant)
+, mOwned(false)
+{
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+template<typename T> inline T& object_view::as() const
+{
+	return *reinterpret_cast<T*>(isReference() ? (*(*this)).address() : mAddress);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+inline bool object_view::identical(const object_view& view) const
+{
+	return	view.typeInfo() == typeInfo() &&
+			view.address() == address();
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+} // namespace reflection
+} // namespace marbles
+
+// End of file --------------------------------------------------------------------------------------------------------
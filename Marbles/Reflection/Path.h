@@ -164,24 +164,22 @@ template<typename _Hash, _Hash (*_HashFn)(const char*), typename _Ax>
 typename PathT<_Hash, _HashFn, _Ax>::base_type PathT<_Hash, _HashFn, _Ax>::Parse(const char* path)
 {
 	base_type out;
-	char* end;
-	char* begin = const_cast<char*>(path);
+	const char* end;
+	const char* begin = path;
+	string segment;
 
 	do 
 	{
 		for(end = begin; '\0' != *end && Seperator != *end; ++end);
 		if (Seperator == *end)
 		{
-			*end = '\0';						// modify end to hash the value
-			out.push_back((*_HashFn)(begin));	// hash and store the value
-			*end = Seperator;					// reset end back to original value
-			begin = end + 1;					// A new beginning
-			continue;
+			segment.assign(begin, end);					// copy the name, the callers buffer may be read only
+			out.push_back((*_HashFn)(segment.c_str()));	// hash and store the value
+			begin = end + 1;							// A new beginning
 		}
 		else
 		{	// leaf name
-			out.push_back(type_info::hash(begin));
-			break;
+			out.push_back((*_HashFn)(begin));
 		}
 	} while ('\0' != *end);
 	return out;
@@ -68,20 +68,20 @@ struct ::marbles::reflection::type_of_t<char[N]>
 	typedef ::marbles::reflection::instance_t< ::marbles::reflection::type_of_t<char[N]> > super;
 	static ::marbles::reflection::shared_type typeInfo()
 	{ 
-		::marbles::reflection::shared_type typeInfo = super::get().reflect_type.lock();
-		if (!typeInfo) { typeInfo = super::get().create(); }
-		return typeInfo; 
+		return super::get().slot.get(&create); 
+	} 
+	static constexpr const char* name() { return "char[" TO_STRING(N) "]"; }
+	template<typename Builder> static constexpr void define(Builder& /*build*/) 
+	{ 
+		// REFLECT_DEFINITION 
 	} 
 private: 
-	::marbles::reflection::weak_type reflect_type; 
-public: 
-	::marbles::reflection::shared_type create() 
+	::marbles::reflection::type_slot slot; 
+	static ::marbles::reflection::shared_type create(::marbles::reflection::weak_type& reflect_type) 
 	{ 
-		typedef char self_type[N];
 		::marbles::reflection::type_info::builder build; 
-		reflect_type = build.create<char[N]>("char[" TO_STRING(N) "]");
-		// REFLECT_DEFINITION 
-		return build.typeInfo(); 
+		reflect_type = build.create<char[N]>(::marbles::reflection::static_type<char[N]>::info);
+		return build.finalize(); 
 	} 
 }; 
 
@@ -0,0 +1,309 @@
+// This source file is part of marbles library.
+//
+// Copyright (c) 2023 Dan Cobban
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// --------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+// --------------------------------------------------------------------------------------------------------------------
+namespace marbles
+{
+namespace reflection
+{
+
+// Typed view of one column of a soa_vector, the values are contiguous so scans vectorize
+// --------------------------------------------------------------------------------------------------------------------
+template<typename F>
+class soa_column
+{
+public:
+	typedef F			value_type;
+	typedef F*			iterator;
+	typedef size_t		size_type;
+
+	soa_column() : mData(NULL), mSize(0) {}
+	soa_column(F* data, size_type size) : mData(data), mSize(size) {}
+
+	bool				isValid() const						{ return NULL != mData; }
+	F*					data() const						{ return mData; }
+	size_type			size() const						{ return mSize; }
+	iterator			begin() const						{ return mData; }
+	iterator			end() const							{ return mData + mSize; }
+	F&					operator[](size_type index) const	{ ASSERT(index < mSize); return mData[index]; }
+
+private:
+	F*					mData;
+	size_type			mSize;
+};
+
+// Structure of arrays container for a reflected type. Every reflected field of T is stored in a contiguous array of
+// its own, laid out from type_info::fields(), so a pass over one member touches only that member's memory. Elements
+// are scattered into the columns on insertion and gathered back into a value initialized T on read, fields that are 
+// not reflected are not stored.
+// {
+//   soa_vector<Particle> particles;
+//   particles.push_back(particle);
+//   for (float x : particles.column(&Particle::x)) { ... }
+// }
+// --------------------------------------------------------------------------------------------------------------------
+template<typename T>
+class soa_vector
+{
+	static_assert(std::is_trivially_copyable<T>::value, "soa_vector copies fields as bytes");
+public:
+	typedef T			value_type;
+	typedef size_t		size_type;
+
+	// Releases column storage allocated with the alignment of its field
+	struct column_deleter
+	{
+		size_t					alignment;
+		void					operator()(unsigned char* data) const	{ ::operator delete[](data, static_cast<std::align_val_t>(alignment)); }
+	};
+	typedef unique_ptr<unsigned char[], column_deleter> column_data;
+
+	// Storage of one field, data holds capacity() values of field.size bytes each aligned to field.alignment
+	struct column_info
+	{
+		shared_member			member;
+		field_descriptor		field;
+		column_data				data;
+	};
+	typedef vector<column_info> column_list;
+
+	soa_vector();
+
+	size_type			size() const						{ return mSize; }
+	bool				empty() const						{ return 0 == mSize; }
+	size_type			capacity() const					{ return mCapacity; }
+	const shared_type&	typeInfo() const					{ return mType; }
+	const column_list&	columns() const						{ return mColumns; }
+
+	void				reserve(size_type capacity);
+	void				resize(size_type size);
+	void				clear()								{ resize(0); }
+	void				push_back(const T& value);
+	void				pop_back()							{ ASSERT(0 < mSize); --mSize; }
+
+	T					get(size_type index) const;
+	void				set(size_type index, const T& value);
+
+	template<typename F> soa_column<F> column(F T::* field);
+	template<typename F> soa_column<F> column(const char* name);
+	template<typename F> soa_column<const F> column(F T::* field) const;
+	template<typename F> soa_column<const F> column(const char* name) const;
+
+	object_view			at(size_type index, const column_info& column) const;
+	object_view			at(size_type index, const char* name) const;
+
+private:
+	const column_info*	find(hash_t hashName) const;
+	const column_info*	find(uint32_t offset, uint32_t size) const;
+
+	shared_type			mType;
+	column_list			mColumns;
+	size_type			mSize;
+	size_type			mCapacity;
+};
+
+// --------------------------------------------------------------------------------------------------------------------
+template<typename T>
+soa_vector<T>::soa_vector()
+: mType(type_of<T>())
+, mSize(0)
+, mCapacity(0)
+{
+	ASSERT(mType);
+	if (mType)
+	{
+		mColumns.reserve(mType->fields().size());
+		for (const field_descriptor& field : mType->fields())
+		{
+			column_info column = { mType->members()[field.member], field, column_data(nullptr, column_deleter{ field.alignment }) };
+			mColumns.push_back(move(column));
+		}
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+template<typename T>
+void soa_vector<T>::reserve(size_type capacity)
+{
+	if (mCapacity < capacity)
+	{
+		for (column_info& column : mColumns)
+		{
+			const std::align_val_t alignment = static_cast<std::align_val_t>(column.field.alignment);
+			column_data data(static_cast<unsigned char*>(::operator new[](capacity * column.field.size, alignment)), column.data.get_deleter());
+			if (0 < mSize)
+			{
+				memcpy(data.get(), column.data.get(), mSize * column.field.size);
+			}
+			column.data = move(data);
+		}
+		mCapacity = capacity;
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+template<typename T>
+void soa_vector<T>::resize(size_type size)
+{
+	reserve(size);
+	for (column_info& column : mColumns)
+	{	// Grown elements are value initialized as a T would be
+		unsigned char* data = column.data.get();
+		for (size_type i = mSize; i < size; ++i)
+		{
+			memset(data + i * column.field.size, 0, column.field.size);
+		}
+	}
+	mSize = size;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+template<typename T>
+void soa_vector<T>::push_back(const T& value)
+{
+	if (mSize == mCapacity)
+	{
+		reserve(Max<size_type>(mCapacity * 2, 16));
+	}
+	++mSize;
+	set(mSize - 1, value);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+template<typename T>
+T soa_vector<T>::get(size_type index) const
+{
+	ASSERT(index < mSize);
+	T value = T();
+	unsigned char* bytes = reinterpret_cast<unsigned char*>(&value);
+	for (const column_info& column : mColumns)
+	{
+		memcpy(bytes + column.field.offset, column.data.get() + index * column.field.size, column.field.size);
+	}
+	return value;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+template<typename T>
+void soa_vector<T>::set(size_type index, const T& value)
+{
+	ASSERT(index < mSize);
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&value);
+	for (column_info& column : mColumns)
+	{
+		memcpy(column.data.get() + index * column.field.size, bytes + column.field.offset, column.field.size);
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+template<typename T> template<typename F>
+soa_column<const F> soa_vector<T>::column(F T::* field) const
+{
+	const field_descriptor descriptor = describe_field(field, 0);
+	const column_info* found = find(descriptor.offset, descriptor.size);
+	return NULL != found 
+		? soa_column<const F>(reinterpret_cast<const F*>(found->data.get()), mSize)
+		: soa_column<const F>();
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+template<typename T> template<typename F>
+soa_column<const F> soa_vector<T>::column(const char* name) const
+{
+	const column_info* found = find(type_info::hash(name));
+	const bool matches = NULL != found && sizeof(F) == found->field.size && primitive_kind_of<F>() == found->field.kind;
+	ASSERT(NULL == found || matches); // F must be the type the field was reflected with
+	return matches
+		? soa_column<const F>(reinterpret_cast<const F*>(found->data.get()), mSize)
+		: soa_column<const F>();
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+template<typename T> template<typename F>
+soa_column<F> soa_vector<T>::column(F T::* field)
+{
+	const soa_column<const F> found = static_cast<const soa_vector&>(*this).column(field);
+	return found.isValid() ? soa_column<F>(const_cast<F*>(found.data()), found.size()) : soa_column<F>();
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+template<typename T> template<typename F>
+soa_column<F> soa_vector<T>::column(const char* name)
+{
+	const soa_column<const F> found = static_cast<const soa_vector&>(*this).template column<F>(name);
+	return found.isValid() ? soa_column<F>(const_cast<F*>(found.data()), found.size()) : soa_column<F>();
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+template<typename T>
+object_view soa_vector<T>::at(size_type index, const column_info& column) const
+{
+	ASSERT(index < mSize);
+	void* address = column.data.get() + index * column.field.size;
+	return object_view::fieldOf(*column.member, address);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+template<typename T>
+object_view soa_vector<T>::at(size_type index, const char* name) const
+{
+	const column_info* found = find(type_info::hash(name));
+	return NULL != found ? at(index, *found) : object_view();
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+template<typename T>
+const typename soa_vector<T>::column_info* soa_vector<T>::find(hash_t hashName) const
+{
+	const type_info::member_list::size_type index = mType->memberIndex(hashName);
+	for (const column_info& column : mColumns)
+	{
+		if (column.field.member == index)
+		{
+			return &column;
+		}
+	}
+	return NULL;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+template<typename T>
+const typename soa_vector<T>::column_info* soa_vector<T>::find(uint32_t offset, uint32_t size) const
+{
+	for (const column_info& column : mColumns)
+	{
+		if (column.field.offset == offset && column.field.size == size)
+		{
+			return &column;
+		}
+	}
+	return NULL;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+} // namespace reflection
+} // namespace marbles
+
+// End of file --------------------------------------------------------------------------------------------------------
@@ -0,0 +1,138 @@
+// This source file is part of marbles library.
+//
+// Copyright (c) 2023 Dan Cobban
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// --------------------------------------------------------------------------------------------------------------------
+
+#include <reflection.h>
+#include <Common/Common.h>
+
+// --------------------------------------------------------------------------------------------------------------------
+namespace marbles
+{
+namespace reflection
+{
+namespace
+{
+// Type of the value a reference declaration refers to
+shared_type referencedType(const declaration& info)
+{
+	const shared_type type = info.typeInfo();
+	if (info.isShared() | info.isWeak())
+	{
+		return type->parameters()[0].typeInfo();
+	}
+	return type->valueDeclaration().typeInfo();
+}
+} // namespace
+
+// --------------------------------------------------------------------------------------------------------------------
+compiled_path::compiled_path(const shared_type& root, const path& route)
+: mRoot(root)
+{
+	mSteps.reserve(route.size());
+	shared_type type = root;
+	declaration info = root ? root->valueDeclaration() : declaration();
+	for (path::const_iterator i = route.begin(); type && i != route.end(); ++i)
+	{
+		step next;
+		next.mDereference = info.isReference();
+		if (next.mDereference)
+		{	// Members of the referenced value, as object::at() does at every call
+			type = referencedType(info);
+		}
+		const type_info::member_list::size_type index = type ? type->memberIndex(*i) : 0;
+		if (!type || index >= type->members().size())
+		{
+			mSteps.clear();
+			break;
+		}
+
+		next.mMember = type->members()[index];
+		const field_descriptor* field = type->field(index);
+		next.mStored = NULL != field;
+		next.mOffset = next.mStored ? field->offset : 0;
+		next.mField = object_view::fieldOf(*next.mMember, NULL);
+		mSteps.push_back(next);
+
+		info = next.mMember->declare_info();
+		type = next.mMember->typeInfo();
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+path_cache::path_cache(size_t capacity)
+: mCapacity(Max<size_t>(capacity, 1))
+{
+	mIndex.reserve(mCapacity);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+path_cache::shared_path path_cache::compile(const shared_type& root, const char* route)
+{
+	hash_t hash[] = { type_info::hash(route), reinterpret_cast<hash_t>(root.get()) };
+	const hash_t key = type_info::hash(&hash[0], sizeof(hash));
+
+	std::lock_guard<std::mutex> lock(mLock);
+	entry_index::iterator found = mIndex.find(key);
+	if (found != mIndex.end())
+	{
+		entry_list::iterator cached = found->second;
+		if (cached->mRoot == root.get() && cached->mRoute == route)
+		{
+			mEntries.splice(mEntries.begin(), mEntries, cached);
+			return cached->mPath;
+		}
+		mEntries.erase(cached); // Key collision, the newer path takes the slot
+		mIndex.erase(found);
+	}
+
+	if (mEntries.size() >= mCapacity)
+	{
+		mIndex.erase(mEntries.back().mKey);
+		mEntries.pop_back();
+	}
+
+	entry added = { key, root.get(), route, make_shared<compiled_path>(root, path(route)) };
+	mEntries.push_front(move(added));
+	mIndex[key] = mEntries.begin();
+	return mEntries.front().mPath;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+size_t path_cache::size() const
+{
+	std::lock_guard<std::mutex> lock(mLock);
+	return mEntries.size();
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void path_cache::clear()
+{
+	std::lock_guard<std::mutex> lock(mLock);
+	mIndex.clear();
+	mEntries.clear();
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+} // namespace reflection
+} // namespace marbles
+
+// End of file --------------------------------------------------------------------------------------------------------
@@ -32,13 +32,14 @@ namespace reflection
 // --------------------------------------------------------------------------------------------------------------------
 shared_type	declaration::typeInfo() const 
 { 
-	return member->typeInfo(); 
+	return member ? member->typeInfo() : shared_type(); // Methods returning void declare no type
 }
 
 // --------------------------------------------------------------------------------------------------------------------
 member::member(const string name, const declaration& declaration, const char* usage)
 : mName(move(name))
 , mType(declaration.typeInfo())
+, mTypePtr(declaration.typeInfo().get())
 , mUsage(usage)
 , mDeclaration(declaration)
 {
@@ -49,6 +50,7 @@ member::member(const string name, const declaration& declaration, const char* us
 member::member(const string name, const shared_type& type_info, const char* usage)
 : mName(move(name))
 , mType(type_info)
+, mTypePtr(type_info.get())
 , mUsage(usage)
 {
 	mHashName = type_info::hash(this->name());
@@ -56,15 +58,96 @@ member::member(const string name, const shared_type& type_info, const char* usag
 
 // --------------------------------------------------------------------------------------------------------------------
 object member::assign(object& self, const object& rhs) const
+{
+	assign(object_view(self), object_view(rhs));
+	return self;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+template<typename Bulk, typename Run, typename Single>
+bool member::visitMembers(const type_info& type, Bulk bulk, Run run, Single single)
+{	// Fields are in member order, walk both together
+	const type_info::member_list& members = type.members();
+	const type_info::field_list& fields = type.fields();
+	type_info::field_list::const_iterator field = fields.begin();
+	size_t begin = 0;
+	size_t end = 0;
+	for (type_info::member_list::size_type index = 0; index < members.size(); ++index)
+	{
+		const shared_member& member = members[index];
+		const bool stored = field != fields.end() && field->member == index;
+		if (stored && bulk(*member))
+		{
+			if (end != field->offset)
+			{	// Not adjacent to the current run, finish it and start another
+				if (begin != end && !run(begin, end))
+				{
+					return false;
+				}
+				begin = field->offset;
+			}
+			end = field->offset + field->size;
+		}
+		else if (!member->callable() && !single(member))
+		{
+			return false;
+		}
+		field += stored ? 1 : 0;
+	}
+	return begin == end || run(begin, end);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void member::assign(const object_view& self, const object_view& rhs) const
 {
 	ASSERT(self.isValid());
 	ASSERT(rhs.typeInfo()->implements(self.typeInfo()));
-	const type_info::member_list& members = self.typeInfo()->members();
-	for(type_info::member_list::const_iterator i = members.begin(); i < members.end(); ++i)
+	const type_info& type = *self.typeInfo();
+	if (rhs.typeInfo() != &type)
+	{	// Field offsets of a derived type may differ, assign through the members
+		const type_info::member_list& members = self.members();
+		for(type_info::member_list::const_iterator i = members.begin(); i < members.end(); ++i)
+		{
+			if (!(*i)->callable())
+			{
+				self.at(*i).assign(rhs.at(*i));
+			}
+		}
+	}
+	else if (type.isTriviallyCopyable())
 	{
-		self.at(*i) = rhs.at(*i);
+		memcpy(self.address(), rhs.address(), type.size());
 	}
-	return self;
+	else
+	{
+		char* to = static_cast<char*>(self.address());
+		const char* from = static_cast<const char*>(rhs.address());
+		visitMembers(type, 
+			[](const member& field) 
+			{ 
+				return field.mDeclaration.isValue() & !field.mDeclaration.isConstant() & field.typePtr()->isTriviallyCopyable(); 
+			},
+			[to, from](size_t begin, size_t end) { memcpy(to + begin, from + begin, end - begin); return true; },
+			[&self, &rhs](const shared_member& member) { self.at(member).assign(rhs.at(member)); return true; });
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+bool member::equal(const object_view& self, const object_view& rhs) const
+{
+	ASSERT(self.isValue() & rhs.isValue());
+	ASSERT(self.typeInfo() == rhs.typeInfo());
+	const type_info& type = *self.typeInfo();
+	const char* lhsBytes = static_cast<const char*>(self.address());
+	const char* rhsBytes = static_cast<const char*>(rhs.address());
+	if (type.isTriviallyComparable())
+	{
+		return 0 == memcmp(lhsBytes, rhsBytes, type.size());
+	}
+	return visitMembers(type,
+		[](const member& field) { return field.mDeclaration.isValue() & field.typePtr()->isTriviallyComparable(); },
+		[lhsBytes, rhsBytes](size_t begin, size_t end) { return 0 == memcmp(lhsBytes + begin, rhsBytes + begin, end - begin); },
+		[&self, &rhs](const shared_member& member) { return self.at(member).equal(rhs.at(member)); });
 }
 
 // --------------------------------------------------------------------------------------------------------------------
@@ -88,6 +171,13 @@ object member::call(object& /*self*/, object* /*pObjs*/, unsigned /*count*/) con
 	return object();
 }
 
+// --------------------------------------------------------------------------------------------------------------------
+bool member::invoke(const object_view& /*self*/, object* /*pObjs*/, unsigned /*count*/, const object_view& /*result*/) const
+{
+	ASSERT(!"Object cannot perform call operation.");
+	return false;
+}
+
 // --------------------------------------------------------------------------------------------------------------------
 } // namespace reflection
 } // namespace marbles
@@ -183,6 +183,18 @@ object object::at(const char* name) const
 	return at(type_info::hash(name));
 }
 
+// --------------------------------------------------------------------------------------------------------------------
+object object::at(const path& route) const
+{	// Resolves every segment by name, use a compiled_path to walk the same route repeatedly
+	object out(*this);
+	for (path::const_iterator i = route.begin(); out.isValid() && i != route.end(); ++i)
+	{
+		object member(out.at(*i));
+		out.swap(member);
+	}
+	return out;
+}
+
 // --------------------------------------------------------------------------------------------------------------------
 object object::at(const hash_t hashName) const
 {
@@ -233,8 +245,7 @@ object object::append(const object& obj)
 // --------------------------------------------------------------------------------------------------------------------
 bool object::equal(const object& obj) const
 {
-	// TODO: member by member comparison is required to determine if two objects are equivalant
-	return identical(obj);
+	return object_view(*this).equal(obj);
 }
 
 // --------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,260 @@
+// This source file is part of marbles library.
+//
+// Copyright (c) 2023 Dan Cobban
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// --------------------------------------------------------------------------------------------------------------------
+
+#include <reflection.h>
+
+// --------------------------------------------------------------------------------------------------------------------
+namespace marbles
+{
+namespace reflection
+{
+
+// --------------------------------------------------------------------------------------------------------------------
+hash_t object_view::hashName() const
+{	// Must match object::hashName() so paths recorded from views and objects agree
+	hash_t hash[] = {	reinterpret_cast<hash_t>(mAddress), 
+						reinterpret_cast<hash_t>(mType),
+						static_cast<hash_t>(mOwned)
+					};
+	return type_info::hash(&hash[0], sizeof(hash));
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+object_view object_view::at(const hash_t hashName) const
+{
+	object_view out;
+	if (isValid())
+	{
+		const type_info::member_list::size_type index = mType->memberIndex(hashName);
+		if (index < members().size())
+		{
+			out = atIndex(index);
+		}
+		else if (isReference())
+		{
+			const object_view deref = *(*this);
+			if (deref.isValid())
+			{
+				out = deref.at(hashName);
+			}
+		}
+	}
+	return out;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+object_view object_view::at(const shared_member& member) const
+{
+	ASSERT(member);
+	return at(member->hashName());
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+object_view object_view::atIndex(type_info::member_list::size_type index) const
+{
+	const shared_member& member = members()[index];
+	const field_descriptor* field = mType->field(index);
+	if (NULL == field)
+	{	// Members without storage in the object are resolved by the member itself
+		const object resolved = toObject().at(member);
+		ASSERT(0 == resolved.mPointee.use_count()); // An owned result would not outlive this call
+		object_view out(resolved);
+		out.mLocked = mLocked;
+		return out;
+	}
+
+	const object_view self = isReference() ? *(*this) : *this;
+	object_view out = fieldOf(*member, NULL != self.mAddress ? static_cast<char*>(self.mAddress) + field->offset : NULL);
+	out.mLocked = self.mLocked;
+	return out;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+object_view object_view::fieldOf(const member& member, void* address)
+{
+	object_view field_view(member.mDeclaration, address, member.mDeclaration.isConstant());
+	field_view.mMember = &member; // Label the value with the member it was reached through, as declare_info() does
+	return field_view;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+object_view object_view::operator*() const 
+{
+	object_view result;
+	if (NULL == mAddress)
+	{
+	}
+	else if (isShared())
+	{
+		const shared_ptr<void>* pointee = static_cast<const shared_ptr<void>*>(mAddress);
+		result = object_view(mType->parameters()[0], pointee->get(), isConstant());
+		result.mOwned = 0 != pointee->use_count();
+		result.mLocked = mLocked;
+	}
+	else if (isWeak())
+	{	// Nothing else may own the value, the view holds the lock for as long as it is used
+		shared_ptr<void> pointee = static_cast<const weak_ptr<void>*>(mAddress)->lock();
+		result = object_view(mType->parameters()[0], pointee.get(), isConstant());
+		result.mOwned = 0 != pointee.use_count();
+		result.mLocked = move(pointee);
+	}
+	else if (isReference())
+	{
+		result = object_view(mType->valueDeclaration(), *static_cast<void**>(mAddress), isConstant());
+		result.mLocked = mLocked;
+	}
+	return result; 
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+bool object_view::assign(const object_view& rhs) const
+{	// Follows object::operator=() without the cloning of invalid objects a view cannot hold
+	if (!isValid() || !rhs.isValid())
+	{
+		return false;
+	}
+
+	const object_view value = rhs.isReference() ? *rhs : rhs;
+	const type_info* type = isShared() | isWeak() ? (*(*this)).typeInfo() : typeInfo();
+	if (NULL != value.typeInfo() && value.typeInfo()->implements(type))
+	{
+		if (isShared())
+		{
+			shared_ptr<void>* self = static_cast<shared_ptr<void>*>(mAddress);
+			if (rhs.isShared())
+			{
+				*self = *static_cast<const shared_ptr<void>*>(rhs.mAddress);
+			}
+			else if (rhs.isWeak())
+			{
+				*self = static_cast<const weak_ptr<void>*>(rhs.mAddress)->lock();
+			}
+			else 
+			{
+				self->reset(value.mAddress);
+			}
+		}
+		else if (isWeak())
+		{
+			weak_ptr<void>* self = static_cast<weak_ptr<void>*>(mAddress);
+			if (rhs.isShared())
+			{
+				*self = *static_cast<const shared_ptr<void>*>(rhs.mAddress);
+			}
+			else if (rhs.isWeak())
+			{
+				*self = *static_cast<const weak_ptr<void>*>(rhs.mAddress);
+			}
+			else 
+			{
+				ASSERT(!"Illogical conversion, the raw pointer will be deleted immediately.");
+				return false;
+			}
+		}
+		else if (isReference())
+		{	// assign the values reference address
+			*static_cast<void**>(mAddress) = value.mAddress;
+		}
+		else
+		{
+			mMember->assign(*this, value);
+		}
+	}
+	else if (NULL == value.mAddress)
+	{
+		return assignZero();
+	}
+	else
+	{
+		ASSERT(!"Unable to do assignment.");
+		return false;
+	}
+	return true;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+bool object_view::assignZero() const
+{
+	if (NULL == mAddress)
+	{
+		return false;
+	}
+	else if (isShared())
+	{
+		static_cast<shared_ptr<void>*>(mAddress)->reset();
+	}
+	else if (isWeak())
+	{
+		static_cast<weak_ptr<void>*>(mAddress)->reset();
+	}
+	else if (isReference())
+	{
+		*static_cast<void**>(mAddress) = NULL;
+	}
+	return !isValue();
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+bool object_view::equal(const object_view& view) const
+{	// Comparing references by the address they refer to keeps cyclic graphs from recursing forever
+	if (identical(view) & (mSemantic == view.mSemantic)) // A value and a reference to it can share an address
+	{
+		return true;
+	}
+	else if (!isValid() | !view.isValid() | isCallable() | view.isCallable())
+	{
+		return false;
+	}
+	else if (isReference() & view.isReference())
+	{
+		return (*(*this)).address() == (*view).address();
+	}
+
+	const object_view lhs = isReference() ? *(*this) : *this;
+	const object_view rhs = view.isReference() ? *view : view;
+	if (NULL == lhs.mAddress || NULL == rhs.mAddress || lhs.mType != rhs.mType)
+	{
+		return NULL == lhs.mAddress && NULL == rhs.mAddress;
+	}
+	return lhs.mMember->equal(lhs, rhs);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+object object_view::toObject() const
+{
+	object obj;
+	if (NULL != mMember)
+	{
+		declaration info(mMember->shared_from_this(), mConstant);
+		info.semantic = mSemantic;
+		object view(info, mAddress);
+		obj.swap(view);
+	}
+	return obj;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+} // namespace reflection
+} // namespace marbles
+
+// End of file --------------------------------------------------------------------------------------------------------
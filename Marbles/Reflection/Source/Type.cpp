@@ -24,6 +24,7 @@
 #include <reflection.h>
 #include <Common/Common.h>
 #include <Common/hash.h>
+#include <mutex>
 
 // --------------------------------------------------------------------------------------------------------------------
 namespace marbles
@@ -32,15 +33,174 @@ namespace reflection
 {
 namespace 
 {
+const uint32_t kEmptySlot = static_cast<uint32_t>(-1);
+const size_t kMinSlots = 8;
+
+// Fibonacci hashing spreads the djb2 name hashes, which differ mostly in their low bits, across the table
+inline size_t slotOf(hash_t hashName, size_t mask)
+{
+	return static_cast<size_t>((static_cast<uint64_t>(hashName) * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+}
+
+// Insert-only open addressed table of registered types. Readers probe the published table without locking, writers
+// serialize on a mutex and publish a copy twice the size once the table would pass half full. Replaced tables are 
+// kept until the registry is cleared so readers still probing them stay valid.
 // --------------------------------------------------------------------------------------------------------------------
-} // namespace <>
+class type_registry
+{
+public:
+	static const size_t initial_slots = 256;
+
+	type_registry()
+	: mTable(nullptr)
+	, mCount(0)
+	{
+		clear();
+	}
+
+	shared_type find(hash_t hashName) const
+	{
+		const table* slots = mTable.load();
+		for (size_t i = slotOf(hashName, slots->mMask); ; i = (i + 1) & slots->mMask)
+		{
+			const entry* candidate = slots->mSlots[i].load();
+			if (nullptr == candidate)
+			{
+				return shared_type();
+			}
+			else if (hashName == candidate->mHashName)
+			{
+				return candidate->mType;
+			}
+		}
+	}
+
+	// @return true when type was added, false if a type with the same name is already registered
+	bool insert(const shared_type& type)
+	{
+		std::lock_guard<std::mutex> lock(mWriter);
+		const hash_t hashName = type->hashName();
+		if (find(hashName))
+		{
+			return false;
+		}
+
+		if (mOwned->mMask + 1 < 2 * (mCount + 1))
+		{
+			grow();
+		}
+		mEntries.push_back(unique_ptr<entry>(new entry{ hashName, type }));
+		place(*mOwned, mEntries.back().get());
+		++mCount;
+		return true;
+	}
+
+	// Every type registered before the call, types registered concurrently may or may not be included
+	type_info::type_list snapshot() const
+	{
+		type_info::type_list types;
+		const table* slots = mTable.load();
+		for (size_t i = 0; i <= slots->mMask; ++i)
+		{
+			const entry* registered = slots->mSlots[i].load();
+			if (nullptr != registered)
+			{
+				types.push_back(registered->mType);
+			}
+		}
+		return types;
+	}
+
+	// Not safe to call while other threads access the registry
+	void clear()
+	{
+		std::lock_guard<std::mutex> lock(mWriter);
+		mOwned = make_table(initial_slots);
+		mTable.store(mOwned.get());
+		mEntries.clear();
+		mCount = 0;
+	}
+
+private:
+	struct entry
+	{
+		hash_t				mHashName;
+		shared_type			mType;
+	};
+
+	struct table
+	{
+		size_t						mMask;
+		unique_ptr<atomic<const entry*>[]> mSlots;
+		unique_ptr<table>			mPrevious;
+	};
+
+	static unique_ptr<table> make_table(size_t num_slots)
+	{
+		unique_ptr<table> slots(new table{ num_slots - 1, make_unique<atomic<const entry*>[]>(num_slots), nullptr });
+		for (size_t i = 0; i < num_slots; ++i)
+		{
+			slots->mSlots[i].store(nullptr);
+		}
+		return slots;
+	}
+
+	static void place(table& slots, const entry* item)
+	{
+		size_t i = slotOf(item->mHashName, slots.mMask);
+		while (nullptr != slots.mSlots[i].load())
+		{
+			i = (i + 1) & slots.mMask;
+		}
+		slots.mSlots[i].store(item);
+	}
+
+	void grow()
+	{
+		unique_ptr<table> larger = make_table(2 * (mOwned->mMask + 1));
+		for (const unique_ptr<entry>& item : mEntries)
+		{
+			place(*larger, item.get());
+		}
+		larger->mPrevious.swap(mOwned);
+		mOwned.swap(larger);
+		mTable.store(mOwned.get());
+	}
+
+	atomic<const table*>	mTable;
+	unique_ptr<table>		mOwned; // Published table, owns the tables it replaced
+	vector<unique_ptr<entry>> mEntries;
+	size_t					mCount;
+	std::mutex				mWriter;
+};
+
+// Constructed on first use so types reflected during static initialization of other units can register
+type_registry& registry()
+{
+	static type_registry s_registry;
+	return s_registry;
+}
+
+// Serializes building types, recursive as building a type builds the types of its members
+std::recursive_mutex& buildLock()
+{
+	static std::recursive_mutex s_lock;
+	return s_lock;
+}
+
+atomic<uint64_t> sGeneration(0);
 
 // --------------------------------------------------------------------------------------------------------------------
-std::map<hash_t, shared_type> type_info::sRegistrar;
+} // namespace <>
 
 // --------------------------------------------------------------------------------------------------------------------
 type_info::type_info()
 : mByValue()
+, mHashName(0)
+, mStatic(NULL)
+, mKind(primitive_kind::composite)
+, mTriviallyCopyable(false)
+, mTriviallyComparable(false)
 , mCreateFn(NULL)
 {
 }
@@ -57,13 +217,7 @@ const char* type_info::name() const
 }
 
 // --------------------------------------------------------------------------------------------------------------------
-hash_t type_info::hashName() const
-{ 
-	return mByValue.memberInfo()->hashName(); 
-}
-
-// --------------------------------------------------------------------------------------------------------------------
-const bool type_info::implements(const shared_type& type_info) const
+const bool type_info::implements(const type_info* type_info) const
 {
 	bool implements = type_info && *this == *type_info;
 	for(type_list::const_iterator base = mImplements.begin(); 
@@ -77,13 +231,80 @@ const bool type_info::implements(const shared_type& type_info) const
 
 // --------------------------------------------------------------------------------------------------------------------
 type_info::member_list::size_type type_info::memberIndex(hash_t hashName) const
-{	// A binary search would be good!
-	member_list::size_type i = 0; 
-	while (i < mMembers.size() && hashName != mMembers[i]->hashName())
+{
+	if (!mMemberSlots.empty())
 	{
-		++i;
+		const size_t mask = mMemberSlots.size() - 1;
+		for (size_t i = slotOf(hashName, mask); kEmptySlot != mMemberSlots[i].mIndex; i = (i + 1) & mask)
+		{
+			if (hashName == mMemberSlots[i].mHash)
+			{
+				return mMemberSlots[i].mIndex;
+			}
+		}
 	}
-	return i;
+	return mMembers.size();
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+const field_descriptor* type_info::field(member_list::size_type index) const
+{	// Fields are recorded in member order
+	field_list::const_iterator found = std::lower_bound(mFields.begin(), mFields.end(), index, 
+		[](const field_descriptor& field, member_list::size_type index) { return field.member < index; });
+	return found != mFields.end() && index == found->member ? &*found : NULL;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void type_info::reserveMembers(size_t members, size_t fields)
+{	// Sized up front adding the members never grows or re-indexes the slots
+	mMembers.reserve(members);
+	mFields.reserve(fields);
+	if (mMemberSlots.size() < 2 * members)
+	{
+		const member_slot empty = { 0, kEmptySlot };
+		mMemberSlots.assign(Max(kMinSlots, bit_ceil(4 * members)), empty);
+		for (member_list::size_type i = 0; i < mMembers.size(); ++i)
+		{
+			indexMember(i);
+		}
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void type_info::addMember(const shared_member& member)
+{
+	mMembers.push_back(member);
+	if (mMemberSlots.size() < 2 * mMembers.size())
+	{	// Grow and re-index every member in order so the first of any duplicate names still wins
+		const member_slot empty = { 0, kEmptySlot };
+		mMemberSlots.assign(Max(kMinSlots, bit_ceil(4 * mMembers.size())), empty);
+		for (member_list::size_type i = 0; i < mMembers.size(); ++i)
+		{
+			indexMember(i);
+		}
+	}
+	else
+	{
+		indexMember(mMembers.size() - 1);
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+void type_info::indexMember(member_list::size_type index)
+{
+	const hash_t hashName = mMembers[index]->hashName();
+	const size_t mask = mMemberSlots.size() - 1;
+	size_t i = slotOf(hashName, mask);
+	while (kEmptySlot != mMemberSlots[i].mIndex)
+	{
+		if (hashName == mMemberSlots[i].mHash)
+		{	// Duplicate name, lookups keep resolving to the first member
+			return;
+		}
+		i = (i + 1) & mask;
+	}
+	mMemberSlots[i].mHash = hashName;
+	mMemberSlots[i].mIndex = static_cast<uint32_t>(index);
 }
 
 // --------------------------------------------------------------------------------------------------------------------
@@ -126,30 +347,74 @@ shared_type	type_info::find(const char* name)
 // --------------------------------------------------------------------------------------------------------------------
 shared_type	type_info::find(hash_t hashName)
 {
-	std::map<hash_t, shared_type>::iterator i = sRegistrar.find(hashName);
-	return i != sRegistrar.end() ? i->second : shared_type();
+	return registry().find(hashName);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+type_info::type_list type_info::registered()
+{
+	return registry().snapshot();
 }
 
 // --------------------------------------------------------------------------------------------------------------------
 void type_info::clear_registrar()
 {
-	// sRegistrar.clear();
-	while (!sRegistrar.empty())
+	registry().clear();
+	sGeneration.fetch_add(1, std::memory_order_release);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+uint64_t registry_generation()
+{
+	return sGeneration.load(std::memory_order_acquire);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+type_slot::~type_slot()
+{
+	const published* current = mPublished.load();
+	while (nullptr != current)
 	{
-		TypeMap::iterator i = sRegistrar.begin();
-		sRegistrar.erase(i);
+		const published* previous = current->mPrevious;
+		delete current;
+		current = previous;
 	}
 }
 
 // --------------------------------------------------------------------------------------------------------------------
-bool type_info::_register(shared_type type_info)
+shared_type type_slot::build(CreateFn create)
 {
-	const bool registered = sRegistrar.end() != sRegistrar.find(type_info->hashName());
-	if (!registered)
+	std::lock_guard<std::recursive_mutex> lock(buildLock());
+	const uint64_t generation = registry_generation();
+	const published* current = mPublished.load(std::memory_order_acquire);
+	if (nullptr != current && generation == current->mGeneration)
+	{	// Published while waiting for the lock
+		return current->mType;
+	}
+
+	shared_type type = mBuilding.lock();
+	if (type)
+	{	// Requested by one of its own members while being built
+		return type;
+	}
+
+	type = create(mBuilding);
+	mBuilding.reset();
+	if (type)
 	{
-		sRegistrar[type_info->hashName()] = type_info;
+		mPublished.store(new published{ type, generation, current }, std::memory_order_release);
 	}
-	return !registered;
+	else if (nullptr != (current = mPublished.load(std::memory_order_acquire)) && generation == current->mGeneration)
+	{	// Its name refers to types that refer back to it, the nested request built and published it first
+		type = current->mType;
+	}
+	return type;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+bool type_info::_register(shared_type type_info)
+{
+	return registry().insert(type_info);
 }
 
 // --------------------------------------------------------------------------------------------------------------------
@@ -166,9 +431,10 @@ shared_type type_info::builder::create(const char* name)
 	// Creates a circular reference type_info->member->type_info
 	shared_ptr<member> mem = make_shared<member>(name, type, "Default by value type_info member");
 	candidate->mByValue = const_pointer_cast<const member>(mem); 
+	candidate->mHashName = mem->hashName();
 
-	if (type_info::_register(type))
-	{
+	if (!type_info::find(candidate->mHashName))
+	{	// Registered by finalize() once it is defined
 		mBuild.swap(candidate);
 	}
 	else
@@ -179,6 +445,18 @@ shared_type type_info::builder::create(const char* name)
 	return type;
 }
 
+// --------------------------------------------------------------------------------------------------------------------
+shared_type type_info::builder::finalize()
+{
+	shared_type type = mBuild;
+	if (type && !type_info::_register(type))
+	{	// Another type with the same name was registered while this one was defined
+		type.reset();
+		mBuild.reset();
+	}
+	return type;
+}
+
 // --------------------------------------------------------------------------------------------------------------------
 void type_info::builder::setCreator(type_info::CreateFn fn)
 {
@@ -0,0 +1,162 @@
+// This source file is part of marbles library.
+//
+// Copyright (c) 2023 Dan Cobban
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// --------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+// --------------------------------------------------------------------------------------------------------------------
+namespace marbles
+{
+namespace reflection
+{
+
+// Member of a reflected type as known at compile time, offsets are left to registration as a pointer to member has
+// no portable constant offset
+// --------------------------------------------------------------------------------------------------------------------
+struct static_member
+{
+	const char*				name = NULL;
+	hash_t					hash = 0;
+	size_t					size = 0;		// Size of a data member's value, zero for methods
+	primitive_kind			kind = primitive_kind::composite;
+	bool					callable = false;
+};
+
+// Everything about a reflected type that does not depend on registration, type_info::staticInfo() refers to it
+// --------------------------------------------------------------------------------------------------------------------
+struct static_type_info
+{
+	const char*				name;			// Spelling given to the REFLECT macro
+	hash_t					hash;			// Zero for class templates, their names spell out their parameters' names
+	size_t					size;
+	size_t					alignment;
+	primitive_kind			kind;
+	bool					triviallyCopyable;
+	bool					triviallyComparable;
+	const static_member*	members;		// In declaration order, matches type_info::members()
+	uint32_t				memberCount;
+	uint32_t				fieldCount;		// Members that are data members
+};
+
+// Records a REFLECT definition during constant evaluation, the compile time counterpart of type_info::builder
+// --------------------------------------------------------------------------------------------------------------------
+class static_builder
+{
+public:
+	constexpr static_builder(static_member* members = NULL) : mMembers(members), mCount(0), mFields(0) {}
+
+	constexpr uint32_t		count() const		{ return mCount; }
+	constexpr uint32_t		fields() const		{ return mFields; }
+
+	template<typename F> constexpr void setCreator(F /*fn*/) {}
+
+	template<typename V, typename C> constexpr void addMember(const char* name, V C::* /*member*/, const char* /*description*/ = NULL)
+	{
+		static_member member;
+		member.name = name;
+		member.hash = marbles::hash::djb2(name);
+		if constexpr (std::is_function<V>::value)
+		{
+			member.callable = true;
+		}
+		else
+		{
+			member.size = sizeof(V);
+			member.kind = primitive_kind_of<V>();
+			++mFields;
+		}
+
+		if (NULL != mMembers)
+		{
+			mMembers[mCount] = member;
+		}
+		++mCount;
+	}
+
+private:
+	static_member*			mMembers;
+	uint32_t				mCount;
+	uint32_t				mFields;
+};
+
+// Instances of class templates with type parameters, their type_info names spell out their parameters
+// --------------------------------------------------------------------------------------------------------------------
+template<typename T> struct is_template_instance : std::false_type {};
+template<template<typename...> class C, typename... A> struct is_template_instance< C<A...> > : std::true_type {};
+
+// Compile time description of a type reflected with REFLECT_TYPE or REFLECT_TEMPLATE_TYPE, built by evaluating its
+// definition with a static_builder
+// --------------------------------------------------------------------------------------------------------------------
+template<typename T>
+struct static_type
+{
+private:
+	static constexpr static_builder measure()
+	{
+		static_builder build;
+		type_of_t<T>::define(build);
+		return build;
+	}
+
+	static constexpr uint32_t count = measure().count();
+
+	struct member_table
+	{
+		static_member		mEntries[0 < count ? count : 1];
+	};
+
+	static constexpr member_table record()
+	{
+		member_table table{};
+		static_builder build(table.mEntries);
+		type_of_t<T>::define(build);
+		return table;
+	}
+
+	static constexpr member_table table = record();
+
+public:
+	static constexpr static_type_info info = 
+	{
+		type_of_t<T>::name(),
+		is_template_instance<T>::value ? 0 : marbles::hash::djb2(type_of_t<T>::name()),
+		sizeof(T),
+		alignof(T),
+		primitive_kind_of<T>(),
+		std::is_trivially_copyable<T>::value,
+		is_trivially_comparable<T>::value,
+		table.mEntries,
+		count,
+		measure().fields(),
+	};
+};
+
+template<typename T> constexpr const static_type_info& static_type_of()
+{
+	return static_type<typename by_value<T>::type>::info;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+} // namespace reflection
+} // namespace marbles
+
+// End of file --------------------------------------------------------------------------------------------------------
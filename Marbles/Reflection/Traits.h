@@ -133,6 +133,73 @@ struct SupportTraits
 	static const bool canIndex		= HasIndexer<T>::value;		// can be indexed by a key operator[]
 };
 
+// --------------------------------------------------------------------------------------------------------------------
+// Storage classification of a value, fields of any other kind are composite and must go through their member
+enum class primitive_kind : uint8_t
+{
+	composite,
+	boolean,
+	int8, int16, int32, int64,
+	uint8, uint16, uint32, uint64,
+	float32, float64,
+	pointer,
+};
+
+template<typename T> constexpr primitive_kind primitive_kind_of()
+{
+	typedef typename remove_cv<T>::type value_type;
+	if constexpr (std::is_same<value_type, bool>::value)
+	{
+		return primitive_kind::boolean;
+	}
+	else if constexpr (std::is_floating_point<value_type>::value)
+	{
+		return 4 == sizeof(value_type) ? primitive_kind::float32 
+			: 8 == sizeof(value_type) ? primitive_kind::float64 : primitive_kind::composite;
+	}
+	else if constexpr (std::is_integral<value_type>::value && std::is_signed<value_type>::value)
+	{
+		return 1 == sizeof(value_type) ? primitive_kind::int8 : 2 == sizeof(value_type) ? primitive_kind::int16
+			: 4 == sizeof(value_type) ? primitive_kind::int32 : primitive_kind::int64;
+	}
+	else if constexpr (std::is_integral<value_type>::value)
+	{
+		return 1 == sizeof(value_type) ? primitive_kind::uint8 : 2 == sizeof(value_type) ? primitive_kind::uint16
+			: 4 == sizeof(value_type) ? primitive_kind::uint32 : primitive_kind::uint64;
+	}
+	else if constexpr (std::is_pointer<value_type>::value)
+	{
+		return primitive_kind::pointer;
+	}
+	else
+	{
+		return primitive_kind::composite;
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+template<typename T>
+struct is_equality_comparable
+{
+	template<typename U> static auto Compare(const U* value) -> decltype(bool(*value == *value), int());
+	template<typename U> static char Compare(...);
+	static const bool value = sizeof(Compare<T>(0)) != sizeof(char);
+};
+
+// Containers declare operator== for any element, whether it compiles depends on the elements
+template<typename T, typename A>
+struct is_equality_comparable< vector<T, A> > : is_equality_comparable<T> {};
+
+// --------------------------------------------------------------------------------------------------------------------
+// Equal values have equal bytes, no padding or floating point, and the type does not define its own equality
+template<typename T>
+struct is_trivially_comparable
+{
+	typedef typename remove_cv<T>::type value_type;
+	static const bool value = std::has_unique_object_representations<value_type>::value &&
+		(std::is_scalar<value_type>::value || !is_equality_comparable<value_type>::value);
+};
+
 // --------------------------------------------------------------------------------------------------------------------
 } // namespace reflection
 } // namespace marbles
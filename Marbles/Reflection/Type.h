@@ -34,6 +34,26 @@ namespace reflection
 {
 class object;
 
+// Flat description of a data member recorded at registration, lets hot paths reach a field with pointer arithmetic
+// rather than dispatching through its member
+// --------------------------------------------------------------------------------------------------------------------
+struct field_descriptor
+{
+	uint32_t				offset;	// Bytes from the start of the owning object
+	uint32_t				size;
+	uint32_t				alignment;
+	uint32_t				member;	// Index into type_info::members()
+	primitive_kind			kind;
+};
+
+template<typename T, typename C> field_descriptor describe_field(T C::* field, uint32_t member)
+{	// Offsets of a pointer to member are not available at compile time, measure one against uninitialized storage
+	alignas(C) unsigned char storage[sizeof(C)];
+	const C* owner = reinterpret_cast<const C*>(storage);
+	const size_t offset = reinterpret_cast<const unsigned char*>(&(owner->*field)) - storage;
+	return field_descriptor{ static_cast<uint32_t>(offset), static_cast<uint32_t>(sizeof(T)), static_cast<uint32_t>(alignof(T)), member, primitive_kind_of<T>() };
+}
+
 // --------------------------------------------------------------------------------------------------------------------
 class type_info
 {
@@ -41,22 +61,30 @@ public:
 	typedef vector<shared_type>	    type_list;
 	typedef vector<shared_member>	member_list;
 	typedef vector<declaration>	    declaration_list;
+	typedef vector<field_descriptor> field_list;
 	class builder;
 
 	type_info();
 	~type_info();
 
 	const char* 		    name() const;
-	hash_t					hashName() const;
+	hash_t					hashName() const					{ return mHashName; }
+	const static_type_info*	staticInfo() const					{ return mStatic; } // NULL unless built by a REFLECT macro
 	size_t					size() const						{ return mSize; }
 	size_t					alignment() const					{ return static_cast<size_t>(1) << mAlignment; }
 	const declaration&		valueDeclaration() const			{ return mByValue; }
 	const declaration_list&	parameters() const					{ return mParameters; }
 	const member_list&		members() const						{ return mMembers; }
+	const field_list&		fields() const						{ return mFields; } // Data members in member order
+	const field_descriptor*	field(member_list::size_type index) const; // Descriptor of members()[index] or NULL
+	primitive_kind			kind() const						{ return mKind; }
+	bool					isTriviallyCopyable() const			{ return mTriviallyCopyable; } // Copies with memcpy
+	bool					isTriviallyComparable() const		{ return mTriviallyComparable; } // Compares with memcmp
 	member_list::size_type	memberIndex(const char* name) const	{ return memberIndex(hash(name)); }
 	member_list::size_type	memberIndex(hash_t hashName) const;
 
-	const bool				implements(const shared_type& type) const;
+	const bool				implements(const shared_type& type) const { return implements(type.get()); }
+	const bool				implements(const type_info* type) const;
 	object					create(const char* name = NULL) const;
 
 	const bool				operator==(const type_info& type) const;
@@ -65,17 +93,36 @@ public:
 	static hash_t			hash(const void* obj, size_t size);
 	static shared_type		find(const char* name);
 	static shared_type		find(hash_t hashName);
-	static void				clear_registrar();
+	static type_list		registered(); // Snapshot of the registered types, safe while types are registered
+	static void				clear_registrar(); // Not thread safe
 
 private:
+	// Open addressed slot mapping a member name hash to its position in mMembers
+	struct member_slot
+	{
+		hash_t				mHash;
+		uint32_t			mIndex;
+	};
+	typedef vector<member_slot>	member_slots;
+
 	static bool				_register(shared_type type);
+	void					reserveMembers(size_t members, size_t fields);
+	void					addMember(const shared_member& member);
+	void					indexMember(member_list::size_type index);
 
 	declaration				mByValue;
+	hash_t					mHashName;
+	const static_type_info*	mStatic;
 	member_list				mMembers;
+	member_slots			mMemberSlots; // Power of two table kept at most half full
+	field_list				mFields;
 	declaration_list		mParameters;
 	type_list				mImplements;
 	size_t					mSize;
 	unsigned char			mAlignment; // Stored as an exponent to a power of two
+	primitive_kind			mKind;
+	bool					mTriviallyCopyable;
+	bool					mTriviallyComparable;
 
 	typedef void (*CreateFn)(object& );
 
@@ -87,16 +134,16 @@ private:
 	// IndexFn
 	// EnumeratorFn
 	// AppendFn
-
-	typedef map<hash_t, shared_type> TypeMap; // remove map
-	static TypeMap sRegistrar;
 };
 
+// Types are built privately and only become visible to type_info::find() once finalized, readers never observe a 
+// type while its members are being added.
 // {
 //   type_info::builder builder;
+//   builder.create("MyType");
 //   builder.addMember<int>("Member1");
 //   builder.addMember<float>("Member2");
-//   shared_type type = builder.create("MyType");
+//   shared_type type = builder.finalize();
 // }
 // --------------------------------------------------------------------------------------------------------------------
 class type_info::builder
@@ -104,13 +151,15 @@ class type_info::builder
 public:
 	builder();
 	shared_type typeInfo() const { return mBuild; }
-	shared_type create(const char* name);
+	shared_type create(const char* name); // NULL if the name is already registered
+	shared_type finalize(); // Registers the built type, NULL if the name was registered in the meantime
 	
 	void setCreator(type_info::CreateFn fn);
 	// void setAppend(type_info::AppendFn fn);
 	// void setEnumerator();
 
 	template<typename T> shared_type create(const char* name);
+	template<typename T> shared_type create(const static_type_info& info);
 	template<typename T> void addMember(const char* name, const char* description = NULL);
 	template<typename T> void addMember(const char* name, T member, const char* description = NULL);
 	template<typename R, typename T> void addMember(const char* name, R (T::*member)(), const char* description = NULL);
@@ -123,6 +172,8 @@ private:
 	void setAlignment(size_t alignment);
 	void setSize(size_t size);
 
+	template<typename T> shared_type create(const char* name, const static_type_info* info);
+
 	template<typename T> struct template_traits;
 	template<typename T> friend struct type_of_t;
 
@@ -141,7 +192,7 @@ template<typename T> struct type_info::builder::template_traits
 #define BUILD_TEMPLATE_TRAITS_PREFIX		::marbles::reflection::type_of<A
 #define BUILD_TEMPLATE_TRAITS_POSTFIX		>()
 #define BUILD_TEMPLATE_TRAITS_TYPENAME		->name()
-#define BUILD_TEMPLATE_TRAITS_SEP			<< ',' <<
+#define BUILD_TEMPLATE_TRAITS_SEP			+ ',' +
 #define BUILD_TEMPLATE_TRAITS_LIST(N)		FN_LIST(N,BUILD_TEMPLATE_TRAITS_PREFIX,BUILD_TEMPLATE_TRAITS_POSTFIX BUILD_TEMPLATE_TRAITS_TYPENAME,BUILD_TEMPLATE_TRAITS_SEP)
 #define BUILD_TEMPLATE_PARAMETERS_PREFIX	::marbles::reflection::declarationT<A
 #define BUILD_TEMPLATE_PARAMETERS_POSTFIX	>()
@@ -158,14 +209,12 @@ template<typename T> struct type_info::builder::template_traits
 		} \
 		static string type_name(const char* name) \
 		{ \
-			stringstream ss; \
-			int max_chars = 256; \
-			while ('\0' != *name && '<' != *name && max_chars--) \
+			const char* end = name; \
+			while ('\0' != *end && '<' != *end && end - name < 256) \
 			{ \
-				ss << *(name++); \
+				++end; \
 			} \
-			ss << '<' << BUILD_TEMPLATE_TRAITS_LIST(N) << '>'; \
-			return ss.str(); \
+			return string(name, end) + '<' + BUILD_TEMPLATE_TRAITS_LIST(N) + '>'; \
 		} \
 	}
 
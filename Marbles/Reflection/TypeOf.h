@@ -44,11 +44,47 @@ typedef weak_ptr<const member> weak_member;
 template<typename T> struct instance_t 
 { 
 	static T& get() { static T s_instance; return s_instance; } 
-private:
-	static const T& s_reference; // Forces a 'get' call during static initialization
 };
 
-template<typename T> const T& instance_t<T>::s_reference = instance_t<T>::get();
+// --------------------------------------------------------------------------------------------------------------------
+uint64_t registry_generation(); // Advanced by type_info::clear_registrar(), types built before are stale
+
+// Holds the type_info of one reflected type, nothing is built until the type is first requested. Once published the
+// type is returned with a single acquire load. First requests are serialized on one lock for all types because a type 
+// refers to others while it is built and they may refer back to it, a request made by the building thread for a type
+// under construction is answered with the partially built type.
+// --------------------------------------------------------------------------------------------------------------------
+class type_slot
+{
+public:
+	typedef shared_type (*CreateFn)(weak_type& building);
+
+	type_slot() : mPublished(nullptr) {}
+	~type_slot();
+
+	shared_type get(CreateFn create)
+	{
+		const published* current = mPublished.load(std::memory_order_acquire);
+		if (nullptr != current && registry_generation() == current->mGeneration)
+		{
+			return current->mType;
+		}
+		return build(create);
+	}
+
+private:
+	struct published
+	{
+		shared_type			mType;
+		uint64_t			mGeneration;
+		const published*	mPrevious;	// Kept until the slot is destroyed, readers may still hold it
+	};
+
+	shared_type build(CreateFn create);
+
+	atomic<const published*>	mPublished;
+	weak_type					mBuilding;	// Guarded by the build lock
+};
 
 // --------------------------------------------------------------------------------------------------------------------
 template<typename T> struct type_of_t
@@ -105,6 +141,8 @@ template<typename T> shared_type type_of(T* obj)
 	REFLECT_COMMON_TYPE(_template,T,REFLECT_DEFINITION)
 
 // Todo: Ensure that builders are the only object that internally references a shared_ptr to a type_info!
+// The definition is expanded once into define(), which a static_builder evaluates at compile time for static_type<T>
+// and a type_info::builder runs on the first request for the type.
 #define REFLECT_COMMON_TYPE(_template,T,REFLECT_DEFINITION) \
 	_template struct ::marbles::reflection::type_of_t<T> \
 	: public ::marbles::reflection::instance_t< ::marbles::reflection::type_of_t<T> > \
@@ -112,21 +150,25 @@ template<typename T> shared_type type_of(T* obj)
 		typedef ::marbles::reflection::instance_t< ::marbles::reflection::type_of_t<T> > super; \
 		static ::marbles::reflection::shared_type typeInfo() \
 		{ \
-			::marbles::reflection::shared_type typeInfo = super::get().reflect_type.lock(); \
-			if (!typeInfo) \
-				typeInfo = super::get().create(); \
-			return typeInfo; \
+			return super::get().slot.get(&create); \
 		} \
-	private: \
-		::marbles::reflection::weak_type reflect_type; \
-	public: \
-		::marbles::reflection::shared_type create() \
+		static constexpr const char* name() { return #T; } \
+		template<typename Builder> static constexpr void define(Builder& build) \
 		{ \
 			typedef T self_type; \
-			::marbles::reflection::type_info::builder build; \
-			reflect_type = build.create<T>(#T); \
+			(void)build; \
 			REFLECT_DEFINITION \
-			return build.typeInfo(); \
+		} \
+	private: \
+		::marbles::reflection::type_slot slot; \
+		static ::marbles::reflection::shared_type create(::marbles::reflection::weak_type& reflect_type) \
+		{ \
+			::marbles::reflection::type_info::builder build; \
+			reflect_type = build.create<T>(::marbles::reflection::static_type<T>::info); \
+			if (reflect_type.expired()) \
+				return ::marbles::reflection::shared_type(); \
+			define(build); \
+			return build.finalize(); \
 		} \
 	}; \
 
@@ -51,7 +51,8 @@ public:
 		ASSERT(!"Not implemented");
 		return object();
 	}
-	virtual object		assign(object& self, const object& rhs) const;
+	virtual void		assign(const object_view& self, const object_view& rhs) const;
+	virtual bool		equal(const object_view& self, const object_view& rhs) const;
 private:
 };
 
@@ -77,13 +78,14 @@ public:
 		ASSERT(!"Not implemented");
 		return object();
 	}
-    virtual object		assign(object& self, const object& rhs) const;
+    virtual void		assign(const object_view& self, const object_view& rhs) const;
+	virtual bool		equal(const object_view& self, const object_view& rhs) const;
 private:
 };
 
 // --------------------------------------------------------------------------------------------------------------------
 template<typename T> 
-object memberT<T>::assign(object& self, const object& rhs) const
+void memberT<T>::assign(const object_view& self, const object_view& rhs) const
 {
 	ASSERT(self.isValid());
 	ASSERT(self.typeInfo()->implements(rhs.typeInfo()));
@@ -101,24 +103,30 @@ object memberT<T>::assign(object& self, const object& rhs) const
 	//}
 	else if (self.isReference())
 	{
-		self.as<T*>() = rhs.as<T*>();
+		self.assign(rhs);
 	}
-	return self;
 }
 
 // --------------------------------------------------------------------------------------------------------------------
 template<typename T, int N>
-object memberT<T[N]>::assign(object& self, const object& rhs) const
+void memberT<T[N]>::assign(const object_view& self, const object_view& rhs) const
 {
 	ASSERT(self.isValid());
 	ASSERT(self.typeInfo()->implements(rhs.typeInfo()));
 	if (self.isValue())
 	{
-		T* selfArray = self.as<T*>();
-		T* rhsArray = rhs.as<T*>();
-		for (int element = 0; element < N; ++element)
+		T* selfArray = static_cast<T*>(self.address());
+		T* rhsArray = static_cast<T*>(rhs.address());
+		if constexpr (std::is_trivially_copyable<T>::value)
 		{
-			selfArray[element] = rhsArray[element];
+			memcpy(selfArray, rhsArray, sizeof(T) * N);
+		}
+		else
+		{
+			for (int element = 0; element < N; ++element)
+			{
+				selfArray[element] = rhsArray[element];
+			}
 		}
 	}
 	//else if (self.isShared())
@@ -131,9 +139,46 @@ object memberT<T[N]>::assign(object& self, const object& rhs) const
 	//}
 	else if (self.isReference())
 	{
-		self.as<T**>() = rhs.as<T**>();
+		self.assign(rhs);
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+template<typename T> 
+bool memberT<T>::equal(const object_view& self, const object_view& rhs) const
+{
+	if constexpr (is_trivially_comparable<T>::value)
+	{
+		return 0 == memcmp(self.address(), rhs.address(), sizeof(T));
+	}
+	else if constexpr (is_equality_comparable<T>::value)
+	{
+		return self.as<T>() == rhs.as<T>();
+	}
+	else
+	{	// Compare the reflected members
+		return member::equal(self, rhs);
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+template<typename T, int N>
+bool memberT<T[N]>::equal(const object_view& self, const object_view& rhs) const
+{
+	const T* selfArray = static_cast<const T*>(self.address());
+	const T* rhsArray = static_cast<const T*>(rhs.address());
+	if constexpr (is_trivially_comparable<T>::value)
+	{
+		return 0 == memcmp(selfArray, rhsArray, sizeof(T) * N);
+	}
+	else if constexpr (is_equality_comparable<T>::value)
+	{
+		return std::equal(selfArray, selfArray + N, rhsArray);
+	}
+	else
+	{
+		return member::equal(self, rhs);
 	}
-	return self;
 }
 
 // --------------------------------------------------------------------------------------------------------------------
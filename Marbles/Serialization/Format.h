@@ -53,8 +53,8 @@ public:
 	virtual ostream&	Write(ostream& os, const double& value) const = 0;
 	virtual ostream&	Write(ostream& os, const float& value) const = 0;
 
-	virtual ostream&	typeInfo(ostream& os, const object& root) const = 0;
-	virtual ostream&	Label(ostream& os, const object& root) const = 0;
+	virtual ostream&	typeInfo(ostream& os, const object_view& root) const = 0;
+	virtual ostream&	Label(ostream& os, const object_view& root) const = 0;
 	virtual ostream&	OpenEnumeration(ostream& os) const = 0;
 	virtual ostream&	CloseEnumeration(ostream& os) const = 0;
 	virtual ostream&	OpenMap(ostream& os) const = 0;
@@ -65,9 +65,10 @@ public:
 	virtual ostream&	NewLine(ostream& os) const = 0;
 
 	// Read Interface
-	virtual bool			Read(istream& is, object& value) const = 0;
+	virtual bool			Read(istream& is, const object_view& value) const = 0;
 
 	virtual bool			typeInfo(istream& is, object& value) const = 0;
+	virtual bool			typeInfo(istream& is, const object_view& value) const = 0;
 	virtual string		Label(istream& is) const = 0;
 	virtual bool			OpenEnumeration(istream& is) const = 0;
 	virtual bool			CloseEnumeration(istream& is) const = 0;
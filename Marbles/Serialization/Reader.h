@@ -29,6 +29,8 @@ namespace marbles
 {
 namespace serialization
 {
+// Reads into an existing object, members are reached through object_view so only created values are reference 
+// counted.
 // --------------------------------------------------------------------------------------------------------------------
 template<typename F> class Reader
 {
@@ -39,14 +41,16 @@ public:
 	bool			Read(istream& is, object& obj);
 
 private:
-	template <typename T> bool Translate(istream& is, object& obj);
-	bool			ReadReference(istream& is, object& obj);
-	bool			ReadEnumerable(istream& is, object& obj);
-	bool			ReadMembers(istream& is, object& obj);
+	bool			Read(istream& is, const object_view& obj);
+	bool			ReadValue(istream& is, const object_view& obj);
+	template <typename T> bool Translate(istream& is, const object_view& obj);
+	bool			ReadReference(istream& is, const object_view& obj);
+	bool			ReadEnumerable(istream& is, const object_view& obj);
+	bool			ReadMembers(istream& is, const object_view& obj);
 	static hash_t	hash(const path& route);
 
 	F				mFormat;
-	ObjectList		mPath;
+	ViewList		mPath;
 };
 
 // --------------------------------------------------------------------------------------------------------------------
@@ -59,9 +63,23 @@ Reader<F>::Reader(bool endianSwap/* = false*/)
 // --------------------------------------------------------------------------------------------------------------------
 template<typename F>
 bool Reader<F>::Read(istream& is, object& value)
+{	// Values may be created to read into, the caller holds them
+	mFormat.typeInfo(is, value);
+	return ReadValue(is, value);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+template<typename F>
+bool Reader<F>::Read(istream& is, const object_view& value)
 {
 	mFormat.typeInfo(is, value);
-	
+	return ReadValue(is, value);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+template<typename F>
+bool Reader<F>::ReadValue(istream& is, const object_view& value)
+{
 	bool canRead = value.isValid();
 	if (canRead)
 	{
@@ -72,8 +90,9 @@ bool Reader<F>::Read(istream& is, object& value)
 		}
 		else if (mFormat.OpenEnumeration(is))
 		{
+			object owner = value.toObject();
 			do {
-				object element = value.append();
+				object element = owner.append();
 				Read(is, element);
 			} while(!mFormat.CloseEnumeration(is));
 		}
@@ -91,9 +110,9 @@ bool Reader<F>::Read(istream& is, object& value)
 
 // --------------------------------------------------------------------------------------------------------------------
 template<typename F> template <typename T> 
-bool Reader<F>::Translate(istream& is, object& obj)
+bool Reader<F>::Translate(istream& is, const object_view& obj)
 {
-	bool canRead = type_of<T>() == obj.typeInfo();
+	bool canRead = type_of<T>().get() == obj.typeInfo();
 	if (canRead)
 	{
 		mFormat.Read(is, obj.as<T>());
@@ -103,21 +122,21 @@ bool Reader<F>::Translate(istream& is, object& obj)
 
 // --------------------------------------------------------------------------------------------------------------------
 template<typename F>
-bool Reader<F>::ReadReference(istream& is, object& value)
+bool Reader<F>::ReadReference(istream& is, const object_view& value)
 {
 	return mFormat.ReadReference(is, mPath, value);
 }
 
 // --------------------------------------------------------------------------------------------------------------------
 template<typename F>
-bool Reader<F>::ReadMembers(istream& is, object& value)
+bool Reader<F>::ReadMembers(istream& is, const object_view& value)
 {
 	istream::pos_type start = is.tellg();
 	if (mFormat.OpenMap(is))
 	{
 		do {
 			const string& label = mFormat.Label(is);
-			object member = value.at(label.c_str());
+			const object_view member = value.at(label.c_str());
 			if (member.isValid()) 
 			{	// Read this element
 				Read(is, member);
@@ -80,12 +80,12 @@ struct TextFormat : public format
 	ostream& Write(ostream& os, const string& value) const
 	{ return os << "\"" << value << "\"" ; } 
 
-	ostream& typeInfo(ostream& os, const object& obj) const
+	ostream& typeInfo(ostream& os, const object_view& obj) const
 	{
 		ASSERT(obj.isValid());
 		return os << "type_info<" << obj.typeInfo()->name() << "> ";
 	}
-	ostream& Label(ostream& os, const object& obj) const
+	ostream& Label(ostream& os, const object_view& obj) const
 	{
 		ASSERT(obj.isValid());
 		return os << obj.memberInfo()->name() << " = ";
@@ -112,9 +112,8 @@ struct TextFormat : public format
 	{ return os << '0'; }
 
 	// Reader interface
-	bool Read(istream& is, object& value) const
+	bool Read(istream& is, const object_view& value) const
 	{
-		shared_type type_info = value.typeInfo();
 		string readValue;
 		istream::pos_type pos = is.tellg();
 		locale prev = is.getloc();
@@ -135,17 +134,20 @@ struct TextFormat : public format
 		}
 		else if ('-' == peek || isdigit(peek, mReadStop))
 		{	// Read a number
-			if (*type_info == *type_of<marbles::uint8_t>())			is >> value.as<marbles::uint8_t>();
-			else if (*type_info == *type_of<marbles::uint16_t>())	is >> value.as<marbles::uint16_t>();
-			else if (*type_info == *type_of<marbles::uint32_t>())	is >> value.as<marbles::uint32_t>();
-			else if (*type_info == *type_of<marbles::uint64_t>())	is >> value.as<marbles::uint64_t>();
-			else if (*type_info == *type_of<marbles::int8_t>())		is >> value.as<marbles::int8_t>();
-			else if (*type_info == *type_of<marbles::int16_t>())	is >> value.as<marbles::int16_t>();
-			else if (*type_info == *type_of<marbles::int32_t>())	is >> value.as<marbles::int32_t>();
-			else if (*type_info == *type_of<marbles::int64_t>())	is >> value.as<marbles::int64_t>();
-			else if (*type_info == *type_of<float>())				is >> value.as<float>();           
-			else if (*type_info == *type_of<double>())				is >> value.as<double>();
-			else { ASSERT(!"Unknown numeric type_info!"); }
+			switch (value.typeInfo()->kind())
+			{
+			case primitive_kind::uint8:		is >> value.as<marbles::uint8_t>();		break;
+			case primitive_kind::uint16:	is >> value.as<marbles::uint16_t>();	break;
+			case primitive_kind::uint32:	is >> value.as<marbles::uint32_t>();	break;
+			case primitive_kind::uint64:	is >> value.as<marbles::uint64_t>();	break;
+			case primitive_kind::int8:		is >> value.as<marbles::int8_t>();		break;
+			case primitive_kind::int16:		is >> value.as<marbles::int16_t>();		break;
+			case primitive_kind::int32:		is >> value.as<marbles::int32_t>();		break;
+			case primitive_kind::int64:		is >> value.as<marbles::int64_t>();		break;
+			case primitive_kind::float32:	is >> value.as<float>();				break;
+			case primitive_kind::float64:	is >> value.as<double>();				break;
+			default: ASSERT(!"Unknown numeric type_info!");
+			}
 		}
 		else if ('t' == tolower(peek, prev) || 'f' == tolower(peek, prev))
 		{
@@ -172,27 +174,11 @@ struct TextFormat : public format
 
 	bool typeInfo(istream& is, object& value) const
 	{
-		char name[1024];
-		shared_type type_info;
-		istream::pos_type start = is.tellg();
-		locale prev = is.getloc();
-
-		// Read formatted type_info information
-		is.imbue(mReadStop);
-		//is >> ios::uppercase;
-		is >> name;
-		// TODO(danc): this should be case insensative
-		if (0 == char_traits<char>::compare("type_info", name, 4)) 
-		{
-			is >> name;
-			type_info = type_info::find(name);
-		}
-		else
+		shared_type type_info = ReadTypeInfo(is);
+		if (!type_info)
 		{
-			is.seekg(start, ios::beg);
 			type_info = value.typeInfo();
 		}
-		is.imbue(prev);
 
 		const bool createRequired = !value.isValid();
 		const bool canCreate = type_info && (!value.isValid() || type_info->implements(value.typeInfo()));
@@ -204,7 +190,13 @@ struct TextFormat : public format
 		return !createRequired;
 	}
 
-	bool ReadReference(istream& is, ObjectList& path, object& value)
+	bool typeInfo(istream& is, const object_view& value) const
+	{	// A view cannot be created into, only consume the type_info
+		ReadTypeInfo(is);
+		return value.isValid();
+	}
+
+	bool ReadReference(istream& is, const ViewList& path, const object_view& value)
 	{
 		istream::pos_type start = is.tellg();
 		if (value.isReference())
@@ -218,7 +210,7 @@ struct TextFormat : public format
 			if (isdigit(is.peek(), mReadStop))
 			{	// NULL value
 				is >> txtPath; // consumes 0
-				value.as<void*>() = 0;
+				value.assignZero();
 			}
 			else if ('.' == is.peek())
 			{	// Look up reference
@@ -226,7 +218,7 @@ struct TextFormat : public format
 
 				// TODO: A new stream? Use 'is' instead.
 				char name[256] = { '\0' };
-				object root(path.front());
+				object_view root(path.front());
 
 				stringstream ss(txtPath); 
 				ss.imbue(mPathStop);
@@ -235,22 +227,22 @@ struct TextFormat : public format
 					ss >> name;
 					if ('\0' != *name)
 					{
-						object deref(root.at(name));
-						root.swap(deref);
+						root = root.at(name);
 					}
 				} while(!ss.eof() && root.isValid());
 				if (root.isValid())
 				{
-					value = root;
+					value.assign(root);
 				}
 			}
 			else if (value.isReference())
 			{
-				const object deref(*value);
-				const bool createRequired = 0 == deref.as<void*>();
+				const object_view deref(*value);
+				const bool createRequired = NULL == deref.address();
 				if (createRequired)
-				{	
-					value = deref.typeInfo()->create();
+				{	// The reference takes the created value
+					const object created = deref.typeInfo()->create();
+					value.assign(created);
 				}
 			}
 			is.imbue(prev);
@@ -331,6 +323,32 @@ struct TextFormat : public format
 	{}
 
 private:
+	// @return		the type named by a leading type_info<name>, otherwise nothing is consumed
+	shared_type ReadTypeInfo(istream& is) const
+	{
+		char name[1024];
+		shared_type type_info;
+		istream::pos_type start = is.tellg();
+		locale prev = is.getloc();
+
+		// Read formatted type_info information
+		is.imbue(mReadStop);
+		//is >> ios::uppercase;
+		is >> name;
+		// TODO(danc): this should be case insensative
+		if (0 == char_traits<char>::compare("type_info", name, 4)) 
+		{
+			is >> name;
+			type_info = type_info::find(name);
+		}
+		else
+		{
+			is.seekg(start, ios::beg);
+		}
+		is.imbue(prev);
+		return type_info;
+	}
+
 	bool ReadIf(istream& is, char character) const
 	{
 		ConsumeWhitespace(is);
@@ -35,6 +35,7 @@ namespace serialization
 // writer.Exclude( root.b.c.g );
 // ostringstream oss;
 // writer.write( oss );
+// The object graph is walked with object_view, only the root and included objects are held by reference count.
 // --------------------------------------------------------------------------------------------------------------------
 template<typename F> 
 class Writer
@@ -47,20 +48,23 @@ public:
 	bool			Write(ostream& os);
 
 private:
-	const ObjectList& Context() const;
+	const ViewList& Context() const;
 	void			PathWritten();
 
-	bool			Write(ostream& os, const object& obj);
-	template <typename T> bool Translate(ostream& os, const object& obj);
-	bool			WriteReference(ostream& os, const object& obj);
-	bool			WriteEnumerable(ostream& os, const object& obj);
-	bool			WriteMembers(ostream& os, const object& obj);
+	bool			Write(ostream& os, const object_view& obj);
+	template <typename T> bool Translate(ostream& os, const object_view& obj);
+	bool			WritePrimitive(ostream& os, const object_view& obj);
+	bool			WriteReference(ostream& os, const object_view& obj);
+	bool			WriteEnumerable(ostream& os, const object_view& obj);
+	bool			WriteMembers(ostream& os, const object_view& obj);
 	void			WriteNewLine(ostream& os) const;
-	bool			ExtendPathTo(ObjectList& route, const object& obj);
+	bool			ExtendPathTo(ViewList& route, const object_view& obj);
 
 	typedef std::map<hash_t, string> PathMap;
 	F				mFormat;
-	ObjectList		mPath;
+	object			mRoot;		// Holds the root alive while mPath views into it
+	const type_info* mString;
+	ViewList		mPath;
 	PathMap			mWritten;
 	ObjectList		mIncludes;
 	ObjectMap		mExcludes; // Can this be done with mWritten?
@@ -70,8 +74,10 @@ private:
 template<typename F> 
 Writer<F>::Writer(const object& obj, bool endianSwap /*= false*/)
 : mFormat(obj, endianSwap)
+, mRoot(obj)
+, mString(type_of<string>().get())
 {
-	mPath.push_back(obj);
+	mPath.push_back(mRoot);
 	mWritten[NULL] = "0";
 }
 
@@ -91,7 +97,7 @@ void Writer<F>::Exclude(const object& obj)
 
 // --------------------------------------------------------------------------------------------------------------------
 template<typename F> 
-const ObjectList& Writer<F>::Context() const
+const ViewList& Writer<F>::Context() const
 {
 	return mPath;
 }
@@ -105,7 +111,7 @@ void Writer<F>::PathWritten()
 	if (written == mWritten.end())
 	{
 		stringstream ss;
-		for (ObjectList::const_iterator i = mPath.begin() + 1; i != mPath.end(); ++i)
+		for (ViewList::const_iterator i = mPath.begin() + 1; i != mPath.end(); ++i)
 		{
 			ss << "." << i->memberInfo()->name();
 		}
@@ -116,7 +122,7 @@ void Writer<F>::PathWritten()
 		mWritten[hashName] = ss.str();
 		if (mPath.back().isReference())
 		{
-			object deref = *mPath.back();
+			const object_view deref = *mPath.back();
 			hashName = deref.hashName();
 			written = mWritten.find(hashName);
 			if (written == mWritten.end())
@@ -129,13 +135,13 @@ void Writer<F>::PathWritten()
 
 // --------------------------------------------------------------------------------------------------------------------
 template<typename F> 
-bool Writer<F>::WriteReference(ostream& os, const object& obj)
+bool Writer<F>::WriteReference(ostream& os, const object_view& obj)
 {
 	ios::pos_type pos = os.tellp();
 	bool write = obj.isValid() && obj.isReference();
 	if (write)
 	{
-		object value = *obj;
+		const object_view value = *obj;
 		PathMap::const_iterator i = mWritten.find(value.hashName());
 		const bool hasPath = i != mWritten.end();
 
@@ -158,7 +164,7 @@ bool Writer<F>::WriteReference(ostream& os, const object& obj)
 
 // --------------------------------------------------------------------------------------------------------------------
 template<typename F> 
-bool Writer<F>::WriteEnumerable(ostream& os, const object& obj)
+bool Writer<F>::WriteEnumerable(ostream& os, const object_view& obj)
 {
 	bool write = obj.IsEnumerable();
 	if (write)
@@ -181,7 +187,7 @@ bool Writer<F>::WriteEnumerable(ostream& os, const object& obj)
 
 // --------------------------------------------------------------------------------------------------------------------
 template<typename F> 
-bool Writer<F>::WriteMembers(ostream& os, const object& obj)
+bool Writer<F>::WriteMembers(ostream& os, const object_view& obj)
 {
 	bool write = obj.isValid() && 0 != obj.members().size();
 	if (write)
@@ -198,7 +204,7 @@ bool Writer<F>::WriteMembers(ostream& os, const object& obj)
 		{
 			if (!(*i)->callable())
 			{
-				object member(obj.at(*i));
+				const object_view member(obj.at(*i));
 				mPath.push_back(member);
 				if (!first)
 				{
@@ -234,19 +240,19 @@ void Writer<F>::WriteNewLine(ostream& os) const
 
 // --------------------------------------------------------------------------------------------------------------------
 template<typename F> 
-bool Writer<F>::ExtendPathTo(ObjectList& path, const object& obj)
+bool Writer<F>::ExtendPathTo(ViewList& path, const object_view& obj)
 {
-	const object parent = path.back();
+	const object_view parent = path.back();
 	const type_info::member_list& members = parent.members();
-	const ObjectList::size_type depth = path.size();
+	const ViewList::size_type depth = path.size();
 	for (	type_info::member_list::const_iterator i = members.begin();
 			!parent.identical(obj) && i != members.end();
 			++i)
 	{
-		object member = parent.at(*i);
+		const object_view member = parent.at(*i);
 		if (member.isValid())
 		{
-			ObjectList::const_reverse_iterator j = path.rbegin(); 
+			ViewList::const_reverse_iterator j = path.rbegin(); 
 			while(j != path.rend() && !j->identical(member))
 			{
 				++j;
@@ -271,15 +277,33 @@ bool Writer<F>::ExtendPathTo(ObjectList& path, const object& obj)
 
 // --------------------------------------------------------------------------------------------------------------------
 template<typename F> template <typename T> 
-bool Writer<F>::Translate(ostream& os, const object& obj)
+bool Writer<F>::Translate(ostream& os, const object_view& obj)
 {
-	bool canWrite = type_of<T>() == obj.typeInfo();
-	if (canWrite)
+	PathWritten();
+	mFormat.Write(os, obj.as<T>());
+	return true;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+template<typename F> 
+bool Writer<F>::WritePrimitive(ostream& os, const object_view& obj)
+{
+	const type_info* type = obj.typeInfo();
+	switch (NULL != type ? type->kind() : primitive_kind::composite)
 	{
-		PathWritten();
-		mFormat.Write(os, obj.as<T>());
+	case primitive_kind::boolean:	return Translate<bool>(os, obj);
+	case primitive_kind::uint8:		return Translate<marbles::uint8_t>(os, obj);
+	case primitive_kind::uint16:	return Translate<marbles::uint16_t>(os, obj);
+	case primitive_kind::uint32:	return Translate<marbles::uint32_t>(os, obj);
+	case primitive_kind::uint64:	return Translate<marbles::uint64_t>(os, obj);
+	case primitive_kind::int8:		return Translate<marbles::int8_t>(os, obj);
+	case primitive_kind::int16:		return Translate<marbles::int16_t>(os, obj);
+	case primitive_kind::int32:		return Translate<marbles::int32_t>(os, obj);
+	case primitive_kind::int64:		return Translate<marbles::int64_t>(os, obj);
+	case primitive_kind::float32:	return Translate<float>(os, obj);
+	case primitive_kind::float64:	return Translate<double>(os, obj);
+	default:						return mString == type && Translate<string>(os, obj);
 	}
-	return canWrite;
 }
 
 // --------------------------------------------------------------------------------------------------------------------
@@ -292,7 +316,7 @@ bool Writer<F>::Write(ostream& os)
 		PathMap::iterator written = mWritten.find(i->hashName());
 		if (mWritten.end() == written)
 		{
-			Write(os, *i);
+			Write(os, object_view(*i));
 		}
 	}
 	return pos != os.tellp();
@@ -300,7 +324,7 @@ bool Writer<F>::Write(ostream& os)
 
 // --------------------------------------------------------------------------------------------------------------------
 template<typename F>
-bool Writer<F>::Write(ostream& os, const object& value)
+bool Writer<F>::Write(ostream& os, const object_view& value)
 {
 	ASSERT(0 < mPath.size() && mPath.back().isValid());
 	ios::pos_type pos = os.tellp();
@@ -309,7 +333,7 @@ bool Writer<F>::Write(ostream& os, const object& value)
 		mFormat.typeInfo(os, mPath.back());
 	}
 
-	ObjectList::size_type top = mPath.size() - 1;
+	ViewList::size_type top = mPath.size() - 1;
 	if (ExtendPathTo(mPath, value))
 	{	// The path has been modified, write out path navigation to value
 		if (mPath[top].IsEnumerable())
@@ -320,11 +344,11 @@ bool Writer<F>::Write(ostream& os, const object& value)
 		{
 			mFormat.OpenMap(os);
 		}
-		for (ObjectList::size_type i = top + 1; i < mPath.size(); ++i)
+		for (ViewList::size_type i = top + 1; i < mPath.size(); ++i)
 		{
 			// mFormat.WriteNewLine(os);
 			mFormat.NewLine(os);
-			for (ObjectList::size_type depth = 1; depth <= i; ++depth)
+			for (ViewList::size_type depth = 1; depth <= i; ++depth)
 			{
 				mFormat.Indent(os);
 			}
@@ -355,18 +379,7 @@ bool Writer<F>::Write(ostream& os, const object& value)
 			}
 		}
 	}
-	else if (Translate<bool>(os, value))				{}
-	else if (Translate<marbles::uint8_t>(os, value))	{}
-	else if (Translate<marbles::uint16_t>(os, value))	{}
-	else if (Translate<marbles::uint32_t>(os, value))	{}
-	else if (Translate<marbles::uint64_t>(os, value))	{}
-	else if (Translate<marbles::int8_t>(os, value))		{}
-	else if (Translate<marbles::int16_t>(os, value))	{}
-	else if (Translate<marbles::int32_t>(os, value))	{}
-	else if (Translate<marbles::int64_t>(os, value))	{}
-	else if (Translate<float>(os, value))				{}
-	else if (Translate<double>(os, value))				{}
-	else if (Translate<string>(os, value))			{}
+	else if (WritePrimitive(os, value))					{}
 	else if (WriteReference(os, value))					{}
 	else if (WriteEnumerable(os, value))				{}
 	else if (WriteMembers(os, value))					{}
@@ -22,12 +22,19 @@
 // --------------------------------------------------------------------------------------------------------------------
 
 #include <Common/Allocator.h>
+#include <Common/Arena.h>
+#include <Common/ObjectPool.h>
+#include <Common/SizeClassAllocator.h>
+#include <Reflection/AllocatorStats.h>
+#include <thread>
 
 // --------------------------------------------------------------------------------------------------------------------
 TEST(block_allocator, basic_operations)
 {
 	static const int32_t block_size = 16;
-	marbles::block_allocator<block_size> blocksOf16;
+	typedef marbles::block_allocator<block_size> allocator_t;
+	static const int32_t per_slab = allocator_t::blocks_per_slab;
+	allocator_t blocksOf16;
 
 	EXPECT_EQ(0, blocksOf16.num_available());
 	EXPECT_FALSE(blocksOf16.can_allocate());
@@ -35,59 +42,739 @@ TEST(block_allocator, basic_operations)
 
 	blocksOf16.reserve(1);
 	EXPECT_TRUE(blocksOf16.can_allocate());
-	EXPECT_EQ(1, blocksOf16.num_available());
-	EXPECT_EQ(1, blocksOf16.num_reserved());
+	EXPECT_EQ(per_slab, blocksOf16.num_available());
+	EXPECT_EQ(per_slab, blocksOf16.num_reserved());
 
 	int32_t* block = blocksOf16.allocate<int32_t>();
 	EXPECT_TRUE(nullptr != block);
-	EXPECT_FALSE(blocksOf16.can_allocate());
-	EXPECT_EQ(0, blocksOf16.num_available());
-	EXPECT_EQ(1, blocksOf16.num_reserved());
-
-	int32_t* block2 = blocksOf16.allocate<int32_t>();
-	EXPECT_EQ(nullptr, block2);
-	EXPECT_FALSE(blocksOf16.can_allocate());
-	EXPECT_EQ(0, blocksOf16.num_available());
-	EXPECT_EQ(1, blocksOf16.num_reserved());
-
-	blocksOf16.free(block);
-	EXPECT_TRUE(blocksOf16.can_allocate());
-	EXPECT_EQ(1, blocksOf16.num_available());
-	EXPECT_EQ(1, blocksOf16.num_reserved());
+	EXPECT_EQ(per_slab - 1, blocksOf16.num_available());
+	EXPECT_EQ(per_slab, blocksOf16.num_reserved());
 
 	struct badBlock { int32_t mem[block_size]; }; // larger than block size
 	//badBlock* block3 = blocksOf16.allocate<badBlock>(); // uncomment to cause static_assert
 
-	int32_t* block4 = blocksOf16.allocate<int32_t>();
-	EXPECT_TRUE(nullptr != block4);
-	EXPECT_FALSE(blocksOf16.can_allocate());
-	EXPECT_EQ(0, blocksOf16.num_available());
-	EXPECT_EQ(1, blocksOf16.num_reserved());
+	EXPECT_EQ(0, blocksOf16.release()); // The slab is still in use
+	EXPECT_EQ(per_slab - 1, blocksOf16.num_available());
+	EXPECT_EQ(per_slab, blocksOf16.num_reserved());
 
-	EXPECT_EQ(0, blocksOf16.release());
-	EXPECT_FALSE(blocksOf16.can_allocate());
-	EXPECT_EQ(0, blocksOf16.num_available());
-	EXPECT_EQ(1, blocksOf16.num_reserved());
-
-	EXPECT_TRUE(blocksOf16.reserve(2));
-	EXPECT_TRUE(blocksOf16.can_allocate());
-	EXPECT_EQ(2, blocksOf16.num_available());
-	EXPECT_EQ(3, blocksOf16.num_reserved());
+	EXPECT_TRUE(blocksOf16.reserve(per_slab + 1));
+	EXPECT_EQ(3 * per_slab - 1, blocksOf16.num_available());
+	EXPECT_EQ(3 * per_slab, blocksOf16.num_reserved());
 
-	EXPECT_EQ(1, blocksOf16.release(1));
-	EXPECT_TRUE(blocksOf16.can_allocate());
-	EXPECT_EQ(1, blocksOf16.num_available());
-	EXPECT_EQ(2, blocksOf16.num_reserved());
+	EXPECT_EQ(0, blocksOf16.release(per_slab - 1)); // Less than a slab
+	EXPECT_EQ(per_slab, blocksOf16.release(per_slab));
+	EXPECT_EQ(2 * per_slab - 1, blocksOf16.num_available());
+	EXPECT_EQ(2 * per_slab, blocksOf16.num_reserved());
 
-	EXPECT_TRUE(blocksOf16.free(block4));
-	EXPECT_TRUE(blocksOf16.can_allocate());
-	EXPECT_EQ(2, blocksOf16.num_available());
-	EXPECT_EQ(2, blocksOf16.num_reserved());
+	EXPECT_EQ(per_slab, blocksOf16.release());
+	EXPECT_EQ(per_slab - 1, blocksOf16.num_available());
+	EXPECT_EQ(per_slab, blocksOf16.num_reserved());
 
-	EXPECT_EQ(2, blocksOf16.release());
+	EXPECT_TRUE(blocksOf16.free(block));
+	EXPECT_EQ(per_slab, blocksOf16.num_available());
+	EXPECT_EQ(per_slab, blocksOf16.release());
 	EXPECT_FALSE(blocksOf16.can_allocate());
 	EXPECT_EQ(0, blocksOf16.num_available());
 	EXPECT_EQ(0, blocksOf16.num_reserved());
 }
 
+// --------------------------------------------------------------------------------------------------------------------
+TEST(block_allocator, stats)
+{
+	typedef marbles::block_allocator<16> allocator_t;
+	static const int32_t per_slab = allocator_t::blocks_per_slab;
+	allocator_t blocks;
+
+	EXPECT_EQ(nullptr, blocks.allocate_block());
+	marbles::allocator_stats stats = blocks.stats();
+	EXPECT_EQ(0, stats.reserved);
+	EXPECT_EQ(1u, stats.failed_allocations);
+	EXPECT_EQ(0u, stats.reserve_calls);
+
+	blocks.reserve(2 * per_slab);
+	void* first = blocks.allocate_block();
+	void* second = blocks.allocate_block();
+	blocks.free_block(first);
+	void* third = blocks.allocate_block();
+
+	stats = blocks.stats();
+	EXPECT_EQ(2 * per_slab, stats.reserved);
+	EXPECT_EQ(2 * per_slab - 2, stats.available);
+	EXPECT_EQ(2, stats.outstanding);
+	EXPECT_EQ(2, stats.peak_outstanding);
+	EXPECT_EQ(1u, stats.reserve_calls);
+	EXPECT_EQ(1u, stats.failed_allocations);
+	EXPECT_EQ(2, blocks.num_outstanding());
+
+	blocks.free_block(second);
+	blocks.free_block(third);
+	EXPECT_EQ(2 * per_slab, blocks.release());
+
+	stats = blocks.stats();
+	EXPECT_EQ(0, stats.reserved);
+	EXPECT_EQ(0, stats.available);
+	EXPECT_EQ(0, stats.outstanding);
+	EXPECT_EQ(2, stats.peak_outstanding); // High water mark is kept after the blocks are freed
+
+	// Stats are reflected so instrumentation can poll any pool generically
+	marbles::reflection::object reflected(stats);
+	EXPECT_EQ(2, reflected.at("peak_outstanding").as<int32_t>());
+	EXPECT_EQ(1u, reflected.at("failed_allocations").as<uint64_t>());
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(block_allocator, slab_layout)
+{
+	typedef marbles::block_allocator<64> allocator_t;
+	allocator_t blocks;
+	blocks.reserve(1);
+
+	// Every block of a reservation comes from one slab aligned to slab_size
+	const uintptr_t mask = ~(uintptr_t(allocator_t::slab_size) - 1);
+	marbles::vector<uint64_t*> allocated;
+	uint64_t* block = nullptr;
+	while (nullptr != (block = blocks.allocate<uint64_t>(allocated.size())))
+	{
+		EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(block) % 64);
+		allocated.push_back(block);
+	}
+	ASSERT_EQ(size_t(allocator_t::blocks_per_slab), allocated.size());
+	for (auto* item : allocated)
+	{
+		EXPECT_EQ(reinterpret_cast<uintptr_t>(allocated.front()) & mask, reinterpret_cast<uintptr_t>(item) & mask);
+		EXPECT_EQ((reinterpret_cast<uintptr_t>(item) - reinterpret_cast<uintptr_t>(allocated.front())) / 64, *item);
+	}
+
+	for (auto* item : allocated)
+	{
+		blocks.free(item);
+	}
+	EXPECT_EQ(allocator_t::blocks_per_slab, blocks.release());
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(block_allocator, concurrent_allocate_free)
+{
+	static const int32_t num_threads = 8;
+	static const int32_t num_blocks = 64;
+	static const int32_t num_cycles = 2000;
+	marbles::block_allocator<16> blocks;
+	blocks.reserve(num_blocks);
+	const int32_t reserved = blocks.num_reserved();
+	EXPECT_LE(num_blocks, reserved);
+
+	std::thread workers[num_threads];
+	for (int32_t id = 0; id < num_threads; ++id)
+	{
+		std::thread worker([&blocks, id]()
+		{	// Rapid reuse of the same few blocks is the pattern that exposes ABA on the free list
+			for (int32_t i = 0; i < num_cycles; ++i)
+			{
+				int32_t* first = blocks.allocate<int32_t>(id);
+				int32_t* second = blocks.allocate<int32_t>(id);
+				if (first) { EXPECT_EQ(id, *first); }
+				if (second) { EXPECT_EQ(id, *second); }
+				blocks.free(first);
+				blocks.free(second);
+			}
+		});
+		workers[id].swap(worker);
+	}
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+
+	EXPECT_EQ(reserved, blocks.num_available());
+	EXPECT_EQ(reserved, blocks.num_reserved());
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(block_allocator, allocate_during_release)
+{	// A release holds the free list while it inspects the slabs, allocations made meanwhile wait for it to return
+	typedef marbles::block_allocator<64> allocator_t;
+	static const int32_t num_threads = 4;
+	static const int32_t num_held = 8;
+	allocator_t blocks;
+	blocks.reserve(1);
+	void* kept = blocks.allocate_block(); // Keeps one slab with free blocks alive through every release
+	marbles::atomic<bool> done = false;
+
+	std::thread workers[num_threads];
+	for (auto& slot : workers)
+	{
+		std::thread worker([&blocks, &done]()
+		{
+			void* held[num_held] = {};
+			while (!done.load())
+			{
+				for (void*& block : held)
+				{
+					block = blocks.allocate_block();
+					EXPECT_NE(nullptr, block);
+				}
+				for (void* block : held)
+				{
+					blocks.free_block(block);
+				}
+			}
+		});
+		slot.swap(worker);
+	}
+
+	for (int32_t i = 0; i < 200; ++i)
+	{
+		blocks.reserve(16 * allocator_t::blocks_per_slab);
+		blocks.release();
+	}
+	done.store(true);
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+
+	EXPECT_EQ(0u, blocks.stats().failed_allocations);
+	blocks.free_block(kept);
+	const int32_t reserved = blocks.num_reserved();
+	EXPECT_EQ(reserved, blocks.release());
+	EXPECT_EQ(0, blocks.num_reserved());
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(magazine_allocator, basic_operations)
+{
+	typedef marbles::magazine_allocator<16, 8> allocator_t;
+	static const int32_t per_slab = marbles::block_allocator<16>::blocks_per_slab;
+	allocator_t blocks;
+
+	EXPECT_FALSE(blocks.can_allocate());
+	EXPECT_EQ(nullptr, blocks.allocate<int32_t>());
+
+	blocks.reserve(1);
+	EXPECT_TRUE(blocks.can_allocate());
+	EXPECT_EQ(per_slab, blocks.num_available());
+	EXPECT_EQ(per_slab, blocks.num_reserved());
+
+	int32_t* block = blocks.allocate<int32_t>(7);
+	ASSERT_TRUE(nullptr != block);
+	EXPECT_EQ(7, *block);
+	EXPECT_EQ(1, blocks.num_outstanding());
+	EXPECT_EQ(per_slab - 1, blocks.num_available());
+	EXPECT_EQ(per_slab, blocks.num_reserved());
+
+	// More allocations than a magazine holds refill it from the shared list
+	marbles::vector<int32_t*> allocated;
+	for (int32_t i = 0; i < 3 * allocator_t::batch_size; ++i)
+	{
+		allocated.push_back(blocks.allocate<int32_t>(i));
+	}
+	EXPECT_EQ(1 + 3 * allocator_t::batch_size, blocks.num_outstanding());
+	for (int32_t i = 0; i < 3 * allocator_t::batch_size; ++i)
+	{
+		EXPECT_EQ(i, *allocated[i]);
+		blocks.free(allocated[i]);
+	}
+	EXPECT_EQ(1, blocks.num_outstanding());
+	EXPECT_EQ(per_slab - 1, blocks.num_available());
+
+	// Blocks freed by another thread are counted against that thread
+	std::thread other([&blocks, block]() { blocks.free(block); });
+	other.join();
+	EXPECT_EQ(0, blocks.num_outstanding());
+	EXPECT_EQ(per_slab, blocks.num_available());
+
+	// Cached blocks keep their slab alive until flushed
+	EXPECT_EQ(0, blocks.release());
+	blocks.flush();
+	EXPECT_EQ(0, blocks.release());
+	std::thread flusher([&blocks]() { blocks.flush(); });
+	flusher.join();
+	EXPECT_EQ(per_slab, blocks.release());
+	EXPECT_EQ(0, blocks.num_available());
+	EXPECT_EQ(0, blocks.num_reserved());
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(magazine_allocator, concurrent_allocate_free)
+{
+	static const int32_t num_threads = 8;
+	static const int32_t num_blocks = 32;
+	static const int32_t num_cycles = 500;
+	marbles::magazine_allocator<16> blocks;
+	blocks.reserve(num_threads * num_blocks);
+	const int32_t reserved = blocks.num_reserved();
+
+	std::thread workers[num_threads];
+	for (int32_t id = 0; id < num_threads; ++id)
+	{
+		std::thread worker([&blocks, id]()
+		{
+			int32_t* items[num_blocks];
+			for (int32_t i = 0; i < num_cycles; ++i)
+			{
+				for (auto& item : items)
+				{
+					item = blocks.allocate<int32_t>(id);
+				}
+				for (auto& item : items)
+				{
+					if (item) { EXPECT_EQ(id, *item); }
+					blocks.free(item);
+				}
+			}
+		});
+		workers[id].swap(worker);
+	}
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+
+	EXPECT_EQ(0, blocks.num_outstanding());
+	EXPECT_EQ(reserved, blocks.num_available());
+	EXPECT_EQ(reserved, blocks.num_reserved());
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(magazine_allocator, refill_flush_stress)
+{	// Small magazines over a scarce pool keep every thread refilling and flushing, allocated blocks are filled so a
+	// refill that follows the links of blocks it has not popped reads a payload as a pointer
+	struct payload { marbles::uint64_t _words[2]; };
+	typedef marbles::magazine_allocator<sizeof(payload), 4> allocator_t;
+	static const int32_t num_threads = 8;
+	static const int32_t max_held = 24;
+	static const int32_t num_cycles = 100000;
+	static const marbles::uint64_t pattern = 0xA5A5A5A5A5A5A5A5ull;
+	allocator_t blocks;
+	blocks.reserve(1);
+	const int32_t reserved = blocks.num_reserved();
+
+	std::thread workers[num_threads];
+	for (int32_t id = 0; id < num_threads; ++id)
+	{
+		std::thread worker([&blocks, id]()
+		{
+			payload* items[max_held] = {};
+			for (int32_t i = 0; i < num_cycles; ++i)
+			{
+				const int32_t held = 1 + (i * 7 + id) % max_held;
+				for (int32_t j = 0; j < held; ++j)
+				{
+					items[j] = blocks.allocate<payload>();
+					if (items[j]) { items[j]->_words[0] = items[j]->_words[1] = pattern ^ id; }
+				}
+				for (int32_t j = 0; j < held; ++j)
+				{
+					if (items[j]) { EXPECT_EQ(pattern ^ id, items[j]->_words[0] & items[j]->_words[1]); }
+					blocks.free(items[j]);
+				}
+			}
+			blocks.flush();
+		});
+		workers[id].swap(worker);
+	}
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+
+	EXPECT_EQ(0, blocks.num_outstanding());
+	EXPECT_EQ(reserved, blocks.num_available());
+	EXPECT_EQ(reserved, blocks.release());
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(magazine_allocator, slot_overflow)
+{	// Threads beyond max_threads get no magazine and allocate from the shared free list
+	typedef marbles::magazine_allocator<16> allocator_t;
+	static const int32_t num_threads = allocator_t::max_threads + 2;
+	allocator_t blocks;
+	blocks.reserve(num_threads * allocator_t::batch_size); // Each magazine takes a batch
+	marbles::atomic<int32_t> allocated = 0;
+	marbles::atomic<bool> release = false;
+
+	std::thread workers[num_threads];
+	for (int32_t id = 0; id < num_threads; ++id)
+	{
+		std::thread worker([&blocks, &allocated, &release, id]()
+		{
+			int32_t* item = blocks.allocate<int32_t>(id);
+			++allocated;
+			while (!release.load())
+			{
+				std::this_thread::yield();
+			}
+			if (item) { EXPECT_EQ(id, *item); }
+			EXPECT_TRUE(blocks.free(item));
+		});
+		workers[id].swap(worker);
+	}
+	while (num_threads != allocated.load())
+	{
+		std::this_thread::yield();
+	}
+	EXPECT_EQ(num_threads, blocks.num_outstanding());
+
+	release.store(true);
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+	EXPECT_EQ(0, blocks.num_outstanding());
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+namespace
+{
+// Nanoseconds per allocate and free pair, averaged over every thread
+template<typename allocator_t>
+double allocation_benchmark(allocator_t& blocks)
+{
+	static const int32_t num_threads = 4;
+	static const int32_t num_held = 8;
+	static const int32_t num_cycles = 50000;
+	blocks.reserve(2 * num_threads * 32);
+
+	std::thread workers[num_threads];
+	auto start = marbles::chrono::high_resolution_clock::now();
+	for (auto& slot : workers)
+	{
+		std::thread worker([&blocks]()
+		{
+			int32_t* held[num_held] = {};
+			for (int32_t i = 0; i < num_cycles; ++i)
+			{
+				for (auto& item : held)
+				{
+					item = blocks.template allocate<int32_t>(i);
+				}
+				for (auto* item : held)
+				{
+					blocks.free(item);
+				}
+			}
+		});
+		slot.swap(worker);
+	}
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+	marbles::chrono::duration<double, std::nano> elapsed = marbles::chrono::high_resolution_clock::now() - start;
+	return elapsed.count() / (num_threads * num_cycles * num_held);
+}
+} // namespace <>
+
+TEST(block_allocator_benchmark, allocate_free)
+{
+	marbles::block_allocator<16> shared;
+	marbles::magazine_allocator<16> cached;
+	::testing::Test::RecordProperty("block_allocator_ns", static_cast<int>(allocation_benchmark(shared)));
+	::testing::Test::RecordProperty("magazine_allocator_ns", static_cast<int>(allocation_benchmark(cached)));
+	EXPECT_EQ(0, shared.num_outstanding());
+	EXPECT_EQ(0, cached.num_outstanding());
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(size_class_allocator, classes)
+{
+	typedef marbles::size_class_allocator allocator_t;
+	EXPECT_EQ(0, allocator_t::size_class(1));
+	EXPECT_EQ(0, allocator_t::size_class(16));
+	EXPECT_EQ(1, allocator_t::size_class(17));
+	EXPECT_EQ(1, allocator_t::size_class(8, 32));
+	EXPECT_EQ(7, allocator_t::size_class(2048));
+	EXPECT_EQ(-1, allocator_t::size_class(2049));
+	EXPECT_EQ(-1, allocator_t::size_class(16, 4096));
+	for (int32_t i = 0; i < allocator_t::num_classes; ++i)
+	{
+		EXPECT_EQ(i, allocator_t::size_class(allocator_t::class_size(i)));
+	}
+
+	allocator_t pools;
+	void* small = pools.allocate(24);
+	void* aligned = pools.allocate(8, 64);
+	void* large = pools.allocate(4096);
+	EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(small) % 32);
+	EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(aligned) % 64);
+	EXPECT_LT(0, pools.num_reserved(1));
+	EXPECT_LT(0, pools.num_reserved(2));
+	EXPECT_EQ(0, pools.num_reserved(0));
+
+	pools.deallocate(small, 24);
+	pools.deallocate(aligned, 8, 64);
+	pools.deallocate(large, 4096);
+	EXPECT_LT(0u, pools.release());
+	EXPECT_EQ(0, pools.num_reserved(1));
+	EXPECT_EQ(0, pools.num_reserved(2));
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(size_class_allocator, adapters)
+{
+	marbles::size_class_allocator pools;
+	{
+		marbles::pooled_allocator<int32_t> ints(pools);
+		std::vector<int32_t, marbles::pooled_allocator<int32_t>> values(ints);
+		for (int32_t i = 0; i < 1000; ++i)
+		{
+			values.push_back(i);
+		}
+		EXPECT_EQ(999, values.back());
+
+		std::basic_string<char, std::char_traits<char>, marbles::pooled_allocator<char>> text("pooled", ints);
+		text.append(100, '!');
+		EXPECT_EQ(106u, text.size());
+		EXPECT_TRUE(ints == text.get_allocator());
+		EXPECT_TRUE(ints != marbles::pooled_allocator<char>());
+	}
+
+	{
+		marbles::pooled_resource resource(pools);
+		std::pmr::vector<std::pmr::string> names(&resource);
+		for (int32_t i = 0; i < 100; ++i)
+		{
+			names.emplace_back(std::string(i, 'x'));
+		}
+		EXPECT_EQ(99u, names.back().size());
+		EXPECT_EQ(&resource, names.back().get_allocator().resource());
+		EXPECT_TRUE(resource.is_equal(marbles::pooled_resource(pools)));
+		EXPECT_FALSE(resource.is_equal(marbles::pooled_resource()));
+	}
+
+	EXPECT_LT(0u, pools.release());
+	for (int32_t i = 0; i < marbles::size_class_allocator::num_classes; ++i)
+	{
+		EXPECT_EQ(0, pools.num_reserved(i));
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(arena, rewind)
+{
+	struct counted
+	{
+		counted(int32_t& count) : _count(count) { ++_count; }
+		~counted() { --_count; }
+		int32_t& _count;
+	};
+
+	marbles::arena scratch(256);
+	EXPECT_EQ(0u, scratch.bytes_reserved());
+
+	int32_t* first = static_cast<int32_t*>(scratch.allocate(sizeof(int32_t), alignof(int32_t)));
+	int32_t* second = static_cast<int32_t*>(scratch.allocate(sizeof(int32_t), alignof(int32_t)));
+	EXPECT_EQ(first + 1, second);
+	void* aligned = scratch.allocate(1, 64);
+	EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(aligned) % 64);
+
+	int32_t live = 0;
+	const marbles::arena::marker start = scratch.mark();
+	const size_t used = scratch.bytes_used();
+	for (int32_t i = 0; i < 20; ++i)
+	{	// Spans several chunks
+		scratch.create<counted>(live);
+		scratch.allocate(32);
+	}
+	EXPECT_EQ(20, live);
+	EXPECT_LT(256u, scratch.bytes_reserved());
+
+	const size_t reserved = scratch.bytes_reserved();
+	scratch.rewind(start);
+	EXPECT_EQ(0, live);
+	EXPECT_EQ(used, scratch.bytes_used());
+	EXPECT_EQ(reserved, scratch.bytes_reserved());
+
+	// Chunks are reused after a rewind
+	void* large = scratch.allocate(1024);
+	EXPECT_TRUE(nullptr != large);
+	{
+		marbles::scoped_arena scope(scratch);
+		scope.create<counted>(live);
+		scope.allocate(100);
+		EXPECT_EQ(1, live);
+	}
+	EXPECT_EQ(0, live);
+
+	scratch.reset();
+	EXPECT_EQ(0u, scratch.bytes_used());
+	scratch.release();
+	EXPECT_EQ(0u, scratch.bytes_reserved());
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(arena, adapters)
+{
+	marbles::arena scratch;
+	{
+		marbles::scoped_arena scope(scratch);
+		std::vector<int32_t, marbles::arena_allocator<int32_t>> values(scope);
+		for (int32_t i = 0; i < 1000; ++i)
+		{
+			values.push_back(i);
+		}
+		EXPECT_EQ(999, values.back());
+		EXPECT_TRUE(values.get_allocator() == marbles::arena_allocator<char>(scratch));
+
+		auto shared = std::allocate_shared<std::string>(marbles::arena_allocator<std::string>(scratch), "arena");
+		EXPECT_EQ("arena", *shared);
+	}
+	EXPECT_EQ(0u, scratch.bytes_used());
+
+	marbles::arena_resource resource(scratch);
+	{
+		std::pmr::vector<std::pmr::string> names(&resource);
+		names.emplace_back("a fairly long string that does not fit inline");
+		EXPECT_EQ(&resource, names.back().get_allocator().resource());
+	}
+	EXPECT_LT(0u, scratch.bytes_used());
+	EXPECT_TRUE(resource.is_equal(marbles::arena_resource(scratch)));
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(object_pool, handles)
+{
+	typedef marbles::object_pool<std::string> pool_t;
+	pool_t pool;
+	EXPECT_TRUE(pool.empty());
+	EXPECT_FALSE(pool_t::handle().valid());
+	EXPECT_EQ(nullptr, pool.get(pool_t::handle()));
+
+	pool_t::handle a = pool.create("a");
+	pool_t::handle b = pool.create(3, 'b');
+	pool_t::handle c = pool.create("c");
+	EXPECT_EQ(3u, pool.size());
+	EXPECT_EQ("a", *pool.get(a));
+	EXPECT_EQ("bbb", *pool.get(b));
+	const std::string* stable = pool.get(c);
+
+	// Destroying leaves the other objects in place, handles and pointers still resolve
+	EXPECT_TRUE(pool.destroy(a));
+	EXPECT_FALSE(pool.destroy(a));
+	EXPECT_FALSE(pool.contains(a));
+	EXPECT_EQ(nullptr, pool.get(a));
+	EXPECT_EQ("c", *pool.get(c));
+	EXPECT_EQ(stable, pool.get(c));
+	EXPECT_EQ("bbb", *pool.get(b));
+
+	// The slot is reused with a new generation
+	pool_t::handle d = pool.create("d");
+	EXPECT_NE(a, d);
+	EXPECT_EQ(nullptr, pool.get(a));
+	EXPECT_EQ("d", *pool.get(d));
+
+	std::string joined;
+	for (const std::string& value : pool)
+	{
+		joined += value;
+	}
+	EXPECT_EQ("cbbbd", joined);
+	for (size_t i = 0; i < pool.size(); ++i)
+	{
+		EXPECT_EQ(&*(pool.begin() + i), pool.get(pool.handle_at(i)));
+	}
+
+	pool.clear();
+	EXPECT_TRUE(pool.empty());
+	EXPECT_EQ(nullptr, pool.get(b));
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(object_pool, lifetime)
+{
+	struct tracked
+	{
+		tracked(int32_t& live) : _live(&live) { ++*_live; }
+		tracked(tracked&& rhs) : _live(rhs._live) { rhs._live = nullptr; }
+		tracked& operator=(tracked&& rhs) { release(); _live = rhs._live; rhs._live = nullptr; return *this; }
+		~tracked() { release(); }
+		void release() { if (_live) { --*_live; _live = nullptr; } }
+		int32_t* _live;
+	};
+
+	int32_t live = 0;
+	{
+		marbles::object_pool<tracked> pool;
+		marbles::vector<marbles::object_pool<tracked>::handle> handles;
+		for (int32_t i = 0; i < 100; ++i)
+		{
+			handles.push_back(pool.create(live));
+		}
+		EXPECT_EQ(100, live);
+		for (size_t i = 0; i < handles.size(); i += 2)
+		{
+			pool.destroy(handles[i]);
+		}
+		EXPECT_EQ(50, live);
+		EXPECT_EQ(50u, pool.size());
+		for (size_t i = 1; i < handles.size(); i += 2)
+		{
+			EXPECT_TRUE(pool.contains(handles[i]));
+		}
+	}
+	EXPECT_EQ(0, live);
+
+	// Objects never move so they need not be movable and may hold pointers to themselves
+	struct pinned
+	{
+		pinned(int32_t& live) : _self(this), _live(&live) { ++*_live; }
+		pinned(const pinned&) = delete;
+		pinned& operator=(const pinned&) = delete;
+		~pinned() { --*_live; }
+		pinned* _self;
+		int32_t* _live;
+	};
+
+	{
+		marbles::object_pool<pinned> pool;
+		marbles::object_pool<pinned>::handle first = pool.create(live);
+		marbles::object_pool<pinned>::handle second = pool.create(live);
+		marbles::object_pool<pinned>::handle third = pool.create(live);
+		EXPECT_TRUE(pool.destroy(first));
+		EXPECT_EQ(2, live);
+		EXPECT_EQ(pool.get(second), pool.get(second)->_self);
+		EXPECT_EQ(pool.get(third), pool.get(third)->_self);
+		for (pinned& object : pool)
+		{
+			EXPECT_EQ(&object, object._self);
+		}
+	}
+	EXPECT_EQ(0, live); // Destroying the pool destroys the remaining objects
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(object_pool, large_objects)
+{
+	// Larger than a page and over-aligned, objects stay in place while the pool grows past several chunks
+	struct alignas(64) large
+	{
+		large(int32_t value) : _value(value) { _payload[0] = static_cast<char>(value); }
+		int32_t	_value;
+		char	_payload[8 * 1024];
+	};
+
+	typedef marbles::object_pool<large> pool_t;
+	pool_t pool;
+	marbles::vector<pool_t::handle> handles;
+	marbles::vector<large*> addresses;
+	for (int32_t i = 0; i < 200; ++i)
+	{
+		handles.push_back(pool.create(i));
+		addresses.push_back(pool.get(handles.back()));
+		EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(addresses.back()) % alignof(large));
+	}
+	for (size_t i = 0; i < handles.size(); ++i)
+	{
+		EXPECT_EQ(addresses[i], pool.get(handles[i]));
+		EXPECT_EQ(static_cast<int32_t>(i), pool.get(handles[i])->_value);
+	}
+
+	// A destroyed object's slot and storage are reused by the next object
+	EXPECT_TRUE(pool.destroy(handles[10]));
+	pool_t::handle reused = pool.create(1000);
+	EXPECT_EQ(addresses[10], pool.get(reused));
+	EXPECT_EQ(1000, pool.get(reused)->_value);
+	EXPECT_EQ(200u, pool.size());
+}
+
 // End of file --------------------------------------------------------------------------------------------------------
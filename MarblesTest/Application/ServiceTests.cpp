@@ -1,6 +1,7 @@
 #include <application/event.h>
 #include <application/service.h>
 #include <application/application.h>
+#include <application/memoryservice.h>
 
 struct ExecutedService
 {
@@ -124,3 +125,32 @@ TEST(service, multiple_thread_test)
 	const int stopCount = winner->provider<ApplicationStop>()->count;
 	EXPECT_EQ(numCyclesToStop, stopCount);
 }
+
+TEST(service, memory_service)
+{
+	const size_t budget = marbles::memory::budget();
+	{
+		const int interval_ms = 5;
+		marbles::application app;
+		marbles::shared_service memory = app.start<marbles::memory_service>(size_t(1), interval_ms);
+		marbles::shared_service racer = app.start<ApplicationStop>(0, 100);
+		app.run(1);
+
+		// Collections run on the provider's timer, the worker threads are not needed
+		const marbles::memory_service* provider = memory->provider<marbles::memory_service>();
+		for (int i = 0; i < 1000 && 2u > provider->collections(); ++i)
+		{
+			marbles::application::sleep(1);
+		}
+		EXPECT_LE(2u, provider->collections());
+		EXPECT_EQ(marbles::memory_pressure::critical, provider->pressure()); // Any usage is beyond a one byte budget
+		EXPECT_EQ(1u, marbles::memory::budget());
+
+		// The timer sleeps between collections rather than polling
+		const int waited_ms = 50;
+		const uint32_t before = provider->collections();
+		marbles::application::sleep(waited_ms);
+		EXPECT_GE(uint32_t(waited_ms / interval_ms + 2), provider->collections() - before);
+	}
+	EXPECT_EQ(budget, marbles::memory::budget()); // Restored once the service is destroyed
+}
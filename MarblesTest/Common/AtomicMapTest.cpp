@@ -0,0 +1,273 @@
+// This source file is part of marbles library.
+//
+// Copyright (c) 2023 Dan Cobban
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// --------------------------------------------------------------------------------------------------------------------
+
+#include <Common/AtomicMap.h>
+#include <Common/AtomicHashMap.h>
+#include <thread>
+#include <shared_mutex>
+#include <mutex>
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(atomic_map, map_operations)
+{
+	marbles::atomic_map<int, int> map;
+
+	EXPECT_TRUE(map.empty());
+	EXPECT_TRUE(map.insert(5, 50));
+	EXPECT_TRUE(map.insert(1, 10));
+	EXPECT_TRUE(map.emplace(3, 30));
+	EXPECT_FALSE(map.insert(3, 31));
+	EXPECT_EQ(3u, map.size());
+
+	int value = 0;
+	EXPECT_TRUE(map.find(3, value));
+	EXPECT_EQ(30, value);
+	EXPECT_FALSE(map.find(2, value));
+	EXPECT_TRUE(map.contains(5));
+
+	int previous = 0;
+	map.for_each([&previous](const std::pair<const int, int>& item)
+	{
+		EXPECT_LT(previous, item.first);
+		EXPECT_EQ(item.first * 10, item.second);
+		previous = item.first;
+	});
+	EXPECT_EQ(5, previous);
+
+	EXPECT_TRUE(map.erase(3));
+	EXPECT_FALSE(map.erase(3));
+	EXPECT_FALSE(map.contains(3));
+	EXPECT_EQ(2u, map.size());
+	EXPECT_TRUE(map.insert(3, 32));
+	EXPECT_TRUE(map.find(3, value));
+	EXPECT_EQ(32, value);
+
+	map.clear();
+	EXPECT_TRUE(map.empty());
+	EXPECT_FALSE(map.contains(1));
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(atomic_map, hash_map_operations)
+{
+	marbles::atomic_hash_map<marbles::string, int> map(10);
+
+	EXPECT_EQ(16u, map.bucket_count());
+	EXPECT_TRUE(map.insert("one", 1));
+	EXPECT_TRUE(map.insert("two", 2));
+	EXPECT_FALSE(map.insert("two", 3));
+	EXPECT_EQ(2u, map.size());
+
+	int value = 0;
+	EXPECT_TRUE(map.find("two", value));
+	EXPECT_EQ(2, value);
+	EXPECT_TRUE(map.erase("one"));
+	EXPECT_FALSE(map.contains("one"));
+	EXPECT_EQ(1u, map.size());
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(atomic_map, concurrent_insert_erase)
+{
+	static const int num_threads = 8;
+	static const int num_keys = 2000;
+	marbles::atomic_map<int, int> map;
+	marbles::atomic<int> inserted = 0;
+	marbles::atomic<int> erased = 0;
+
+	std::thread workers[num_threads];
+	for (int id = 0; id < num_threads; ++id)
+	{
+		std::thread worker([&map, &inserted, &erased, id]()
+		{	// Every thread races over the same keys
+			for (int i = 0; i < num_keys; ++i)
+			{
+				const int key = (i * 7 + id) % num_keys;
+				if (map.insert(key, key))
+				{
+					++inserted;
+				}
+				if (0 == key % 3 && map.erase(key))
+				{
+					++erased;
+				}
+			}
+		});
+		workers[id].swap(worker);
+	}
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+
+	EXPECT_EQ(static_cast<size_t>(inserted - erased), map.size());
+	int count = 0;
+	int previous = -1;
+	map.for_each([&count, &previous](const std::pair<const int, int>& item)
+	{
+		EXPECT_LT(previous, item.first);
+		EXPECT_EQ(item.first, item.second);
+		previous = item.first;
+		++count;
+	});
+	EXPECT_EQ(inserted - erased, count);
+	marbles::atomic_epoch::collect();
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(atomic_map, epoch_overflow)
+{	// More threads than pin slots, the threads without a slot share a pin that holds the epoch still
+	static const int num_threads = marbles::atomic_epoch::max_threads + 2;
+	marbles::atomic<int> pinned = 0;
+	marbles::atomic<bool> release = false;
+
+	std::thread workers[num_threads];
+	for (auto& slot : workers)
+	{
+		std::thread worker([&pinned, &release]()
+		{
+			marbles::atomic_epoch::guard pin;
+			++pinned;
+			while (!release.load())
+			{
+				std::this_thread::yield();
+			}
+		});
+		slot.swap(worker);
+	}
+	while (num_threads != pinned.load())
+	{
+		std::this_thread::yield();
+	}
+
+	EXPECT_FALSE(marbles::atomic_epoch::collect());
+
+	release.store(true);
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+	EXPECT_TRUE(marbles::atomic_epoch::collect());
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+template<typename K, typename V>
+class locked_map
+{
+public:
+	bool find(const K& key, V& out) const
+	{
+		std::shared_lock<std::shared_mutex> lock(_mutex);
+		auto i = _map.find(key);
+		if (i != _map.end())
+		{
+			out = i->second;
+		}
+		return i != _map.end();
+	}
+	bool insert(const K& key, const V& value)
+	{
+		std::unique_lock<std::shared_mutex> lock(_mutex);
+		return _map.insert(std::make_pair(key, value)).second;
+	}
+	bool erase(const K& key)
+	{
+		std::unique_lock<std::shared_mutex> lock(_mutex);
+		return 0 != _map.erase(key);
+	}
+private:
+	mutable std::shared_mutex _mutex;
+	marbles::map<K, V> _map;
+};
+
+// Runs a mix of lookups and insert/erase pairs, write_percent of the operations are writes.
+template<typename map_t>
+double map_benchmark(map_t& map, int write_percent)
+{
+	static const int num_threads = 4;
+	static const int num_keys = 4096;
+	static const int num_operations = 100000;
+	for (int key = 0; key < num_keys; key += 2)
+	{
+		map.insert(key, key);
+	}
+
+	std::thread workers[num_threads];
+	auto start = marbles::chrono::high_resolution_clock::now();
+	for (int id = 0; id < num_threads; ++id)
+	{
+		std::thread worker([&map, write_percent, id]()
+		{
+			marbles::uint32_t seed = 2463534242u + id;
+			int value = 0;
+			for (int i = 0; i < num_operations; ++i)
+			{
+				seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+				const int key = static_cast<int>(seed % num_keys);
+				if (static_cast<int>((seed >> 16) % 100) < write_percent)
+				{
+					map.insert(key, key);
+					map.erase((key + 1) % num_keys);
+				}
+				else
+				{
+					map.find(key, value);
+				}
+			}
+		});
+		workers[id].swap(worker);
+	}
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+	marbles::chrono::duration<double, std::milli> elapsed = marbles::chrono::high_resolution_clock::now() - start;
+	return elapsed.count();
+}
+
+void map_benchmark_report(const char* label, int write_percent)
+{
+	marbles::atomic_map<int, int> ordered;
+	marbles::atomic_hash_map<int, int> hashed(1024);
+	locked_map<int, int> locked;
+	const double ordered_ms = map_benchmark(ordered, write_percent);
+	const double hashed_ms = map_benchmark(hashed, write_percent);
+	const double locked_ms = map_benchmark(locked, write_percent);
+	::testing::Test::RecordProperty("workload", label);
+	::testing::Test::RecordProperty("atomic_map_us", static_cast<int>(1000.0 * ordered_ms));
+	::testing::Test::RecordProperty("atomic_hash_map_us", static_cast<int>(1000.0 * hashed_ms));
+	::testing::Test::RecordProperty("shared_mutex_map_us", static_cast<int>(1000.0 * locked_ms));
+	marbles::atomic_epoch::collect();
+}
+
+TEST(atomic_map_benchmark, read_heavy)
+{
+	map_benchmark_report("read heavy 5% writes", 5);
+}
+
+TEST(atomic_map_benchmark, write_heavy)
+{
+	map_benchmark_report("write heavy 50% writes", 50);
+}
+
+// End of file --------------------------------------------------------------------------------------------------------
@@ -24,6 +24,7 @@
 #include <Common/AtomicList.h>
 #include <Common/AtomicBuffer.h>
 #include <Common/AtomicQueue.h>
+#include <Common/Backoff.h>
 #include <thread>
 
 void rest_thread(int value)
@@ -44,6 +45,28 @@ private:
     T _value;
 };
 
+TEST(atomic_test, tagged_pointer)
+{
+	int a = 1;
+	int b = 2;
+	marbles::atomic_tagged_ptr<int> pointer(&a);
+
+	marbles::tagged_ptr<int> stale = pointer.load();
+	EXPECT_EQ(&a, stale.ptr);
+
+	// a is removed then reinserted, the pointer matches but the tag does not
+	EXPECT_EQ(&a, pointer.exchange(&b));
+	EXPECT_EQ(&b, pointer.exchange(&a));
+	EXPECT_EQ(&a, pointer.load().ptr);
+	EXPECT_FALSE(pointer.compare_exchange_strong(stale, &b));
+	EXPECT_EQ(&a, stale.ptr);
+	EXPECT_EQ(pointer.load(), stale);
+
+	EXPECT_TRUE(pointer.compare_exchange_strong(stale, &b));
+	EXPECT_EQ(&b, pointer.load().ptr);
+	EXPECT_EQ(stale.tag + 1, pointer.load().tag);
+}
+
 TEST(atomic_test, list_operations)
 {
     typedef marbles::atomic_list<int> list_t;
@@ -209,6 +232,104 @@ TEST(atomic_test, queue_operations)
 	EXPECT_TRUE(queue.empty());
 }
 
+TEST(atomic_test, queue_pool)
+{
+	const int size = 4;
+	typedef marbles::atomic_queue<int, size> queue_t;
+	const int per_slab = queue_t::segments_per_slab();
+	queue_t queue(1);
+	queue_t other;
+
+	EXPECT_EQ(1, queue.max_idle());
+	EXPECT_EQ(per_slab, queue.num_reserved());
+	EXPECT_EQ(per_slab, other.num_reserved());
+
+	// Each segment holds size - 1 elements, fill enough segments to need more slabs
+	int push = 0;
+	while (2 * per_slab * size != push)
+	{
+		queue.enqueue(push++);
+	}
+
+	const int reserved = queue.num_reserved();
+	EXPECT_LT(per_slab, reserved);
+	EXPECT_EQ(0, reserved % per_slab);
+	EXPECT_EQ(per_slab, other.num_reserved()); // Segments are not shared between queues
+
+	int value = 0;
+	while (queue.dequeue(value)) {}
+
+	EXPECT_TRUE(queue.empty());
+	EXPECT_EQ(reserved, queue.num_reserved()); // Draining does not trim
+
+	// Drained segments return to the pool once every thread has moved past the epoch they were retired in
+	for (int i = 0; i < 3; ++i)
+	{
+		marbles::atomic_epoch::collect();
+	}
+	queue.trim();
+	EXPECT_EQ(per_slab, queue.num_reserved()); // Only the slab holding the active segment is kept
+
+	queue.set_max_idle(0);
+	EXPECT_EQ(per_slab, queue.num_reserved());
+}
+
+struct no_default
+{
+	no_default(int a, int b) : _sum(a + b) {}
+	int _sum;
+};
+
+TEST(atomic_test, move_only_elements)
+{
+	typedef marbles::unique_ptr<int> unique_int;
+	marbles::atomic_buffer<unique_int, 4> buffer;
+
+	EXPECT_TRUE(buffer.try_push(marbles::make_unique<int>(1)));
+	EXPECT_TRUE(buffer.try_emplace(new int(2)));
+	unique_int last = marbles::make_unique<int>(3);
+	EXPECT_TRUE(buffer.try_push(marbles::move(last)));
+	EXPECT_EQ(nullptr, last);
+	unique_int full = marbles::make_unique<int>(4);
+	EXPECT_FALSE(buffer.try_push(marbles::move(full)));
+	EXPECT_NE(nullptr, full); // Not consumed when the buffer is full
+
+	EXPECT_EQ(1, *buffer.pop());
+	marbles::optional<unique_int> second = buffer.try_pop();
+	EXPECT_TRUE(second.has_value());
+	EXPECT_EQ(2, **second);
+	int consumed = 0;
+	EXPECT_TRUE(buffer.try_consume([&consumed](unique_int&& value) { consumed = *value; }));
+	EXPECT_EQ(3, consumed);
+	EXPECT_FALSE(buffer.try_pop().has_value());
+
+	marbles::atomic_buffer<no_default, 4> sums;
+	sums.emplace(1, 2);
+	EXPECT_EQ(3, sums.pop()._sum);
+
+	marbles::atomic_queue<unique_int, 4> queue;
+	for (int i = 0; i < 16; ++i)
+	{
+		queue.enqueue(marbles::make_unique<int>(i));
+	}
+	for (int i = 0; i < 16; ++i)
+	{
+		marbles::optional<unique_int> value = queue.dequeue();
+		EXPECT_TRUE(value.has_value());
+		EXPECT_EQ(i, **value);
+	}
+	EXPECT_FALSE(queue.dequeue().has_value());
+
+	marbles::atomic_queue<std::packaged_task<int()>, 4> tasks;
+	tasks.emplace([]() { return 7; });
+	EXPECT_TRUE(tasks.consume([](std::packaged_task<int()>&& task)
+	{
+		marbles::future<int> result = task.get_future();
+		task();
+		EXPECT_EQ(7, result.get());
+	}));
+}
+
 template<typename queue_t> void push_pop_multi()
 {
 	static const int32_t num_consumers = 3;
@@ -289,6 +410,71 @@ template<typename queue_t> void push_pop_multi()
 	}
 }
 
+TEST(atomic_test, backoff_policies)
+{
+	marbles::spin_backoff spin;
+	marbles::pause_backoff pause;
+	marbles::yield_backoff yield;
+	marbles::exponential_backoff<1, 4> exponential;
+	marbles::park_backoff<2, 4> park;
+	for (auto i = 10; i--;)
+	{
+		spin();
+		pause();
+		yield();
+		exponential();
+		park();
+	}
+	EXPECT_EQ(spin.retries(), 10u);
+	EXPECT_EQ(pause.retries(), 10u);
+	EXPECT_EQ(yield.retries(), 10u);
+	EXPECT_EQ(exponential.retries(), 10u);
+	EXPECT_EQ(park.retries(), 10u);
+
+	marbles::retry_counter counter;
+	counter.record(marbles::spin_backoff());
+	EXPECT_EQ(counter.load(), 0u);
+	counter.record(spin);
+	counter.record(park);
+	EXPECT_EQ(counter.load(), 20u);
+	counter.reset();
+	EXPECT_EQ(counter.load(), 0u);
+
+	// Producers wait on a full buffer until the consumer starts
+	const int32_t quantity = 200;
+	const int32_t numProducers = 4;
+	marbles::atomic_buffer<int32_t, 4, marbles::yield_backoff> data;
+	EXPECT_EQ(data.retries(), 0u);
+
+	marbles::array<std::thread, numProducers> producerThreads;
+	for (auto id = numProducers; id--;)
+	{
+		std::thread producer([&data, quantity]()
+		{
+			for (auto i = quantity; i--;)
+			{
+				data.push(i);
+			}
+		});
+		producerThreads[id].swap(producer);
+	}
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	int32_t total = 0;
+	for (auto i = quantity * numProducers; i--;)
+	{
+		total += data.pop() + 1;
+	}
+
+	for (auto& producer : producerThreads)
+	{
+		producer.join();
+	}
+	EXPECT_EQ(total, numProducers * quantity * (quantity + 1) / 2);
+	EXPECT_TRUE(data.empty());
+	EXPECT_LT(0u, data.retries());
+}
+
 TEST(atomic_test, buffer_push_pop_multi)
 {
 	const int32_t quantity = 150;
@@ -461,6 +647,74 @@ TEST(atomic_test, queue_push_pop_multi)
 	}
 }
 
+TEST(atomic_test, queue_segment_handoff)
+{	// Tiny segments force producers and consumers to cross segment boundaries constantly, every element must arrive
+	const int32_t quantity = 4000;
+	const int32_t numProducers = 8;
+	const int32_t numConsumers = 4;
+
+	marbles::array<marbles::atomic<int32_t>, numProducers> tally;
+	for (auto& sum : tally)
+	{
+		sum.store(0);
+	}
+
+	marbles::atomic<int> producerCount = numProducers;
+	marbles::atomic_queue<int32_t, 4> data;
+
+	marbles::array<std::thread, numProducers> producerThreads;
+	for (auto id = numProducers; id--;)
+	{
+		std::thread producer([&producerCount, &data, id, quantity]()
+		{
+			for (auto i = quantity; i--;)
+			{
+				data.enqueue(id);
+			}
+			producerCount--;
+		});
+		producerThreads[id].swap(producer);
+	}
+
+	marbles::array<std::thread, numConsumers> consumerThreads;
+	for (auto id = numConsumers; id--;)
+	{
+		std::thread consumer([&producerCount, &tally, &data]()
+		{
+			int32_t value = 0;
+			while (0 != producerCount.load())
+			{
+				if (data.dequeue(value))
+				{
+					tally[value].fetch_add(1);
+				}
+			}
+		});
+		consumerThreads[id].swap(consumer);
+	}
+
+	for (auto& producer : producerThreads)
+	{
+		producer.join();
+	}
+	for (auto& consumer : consumerThreads)
+	{
+		consumer.join();
+	}
+
+	int32_t value = 0;
+	while (data.dequeue(value))
+	{
+		tally[value].fetch_add(1);
+	}
+
+	for (auto& sum : tally)
+	{
+		EXPECT_EQ(quantity, sum.load());
+	}
+	EXPECT_TRUE(data.empty());
+}
+
 TEST(atomic_test, multi_thread_usage)
 {
 	const int quantity = 150;
@@ -570,5 +824,9 @@ TEST(atomic_test, multi_thread_usage)
 	// Clean up
 	accumulatorThread.join();
 	accumulator2Thread.join();
+
+	// Retries are counted per list, contention on the lists above is not reported by another
+	List untouched;
+	EXPECT_EQ(0u, untouched.retries());
 }
 
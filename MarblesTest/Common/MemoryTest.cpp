@@ -0,0 +1,318 @@
+// This source file is part of marbles library.
+//
+// Copyright (c) 2023 Dan Cobban
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// --------------------------------------------------------------------------------------------------------------------
+
+#include <Common/Common.h>
+#include <Common/AtomicQueue.h>
+#include <Common/SizeClassAllocator.h>
+#include <thread>
+
+namespace
+{
+	struct alignas(64) cache_line
+	{
+		int32_t _value[16];
+	};
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(memory_test, thread_stats)
+{
+	const marbles::memory_stats before = marbles::memory::thread_stats();
+	int32_t* volatile value = new int32_t(5);
+	const marbles::memory_stats allocated = marbles::memory::thread_stats();
+	EXPECT_EQ(before.allocations + 1, allocated.allocations);
+	EXPECT_EQ(before.bytes_allocated + sizeof(int32_t), allocated.bytes_allocated);
+	EXPECT_EQ(before.live_allocations() + 1, allocated.live_allocations());
+
+	delete value;
+	const marbles::memory_stats freed = marbles::memory::thread_stats();
+	EXPECT_EQ(before.deallocations + 1, freed.deallocations);
+	EXPECT_EQ(before.live_bytes(), freed.live_bytes());
+
+	// Allocations by other threads are counted against them and appear in the global stats
+	const marbles::memory_stats global = marbles::memory::stats();
+	marbles::memory_stats other_before;
+	marbles::memory_stats other_after;
+	std::thread other([&other_before, &other_after]() 
+	{ 
+		other_before = marbles::memory::thread_stats();
+		int64_t* volatile value = new int64_t(0); // volatile prevents the allocation from being elided
+		delete value;
+		other_after = marbles::memory::thread_stats();
+	});
+	other.join();
+	EXPECT_EQ(other_before.allocations + 1, other_after.allocations);
+	EXPECT_EQ(other_before.bytes_allocated + sizeof(int64_t), other_after.bytes_allocated);
+	EXPECT_LE(global.allocations + 1, marbles::memory::stats().allocations);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(memory_test, aligned_and_sized)
+{
+	cache_line* line = new cache_line();
+	EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(line) % 64);
+	delete line;
+
+	cache_line* lines = new cache_line[3];
+	EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(lines) % 64);
+	delete[] lines;
+
+	void* raw = ::operator new(100);
+	::operator delete(raw, 100);
+
+	void* none = ::operator new(16, std::nothrow);
+	EXPECT_TRUE(nullptr != none);
+	::operator delete(none);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(memory_test, counting_backend)
+{
+	static marbles::counting_memory s_counter;
+	s_counter.reset();
+
+	marbles::vector<int32_t> values;
+	values.reserve(64);
+
+	marbles::memory_backend* previous = marbles::memory::install(&s_counter);
+	EXPECT_EQ(&s_counter, &marbles::memory::backend());
+	for (int32_t i = 0; i < 64; ++i)
+	{	// Hot path, no allocation expected
+		values.push_back(i);
+	}
+	const uint64_t hot_path = s_counter.allocations();
+	int32_t* allocated = new int32_t(1);
+	marbles::memory::install(previous);
+
+	EXPECT_EQ(0u, hot_path);
+	EXPECT_EQ(1u, s_counter.allocations());
+
+	// Memory is returned to the backend that allocated it
+	delete allocated;
+	EXPECT_EQ(1u, s_counter.deallocations());
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(memory_test, pooled_backend)
+{
+	static marbles::pooled_memory s_pooled;
+	marbles::memory_backend* previous = marbles::memory::install(&s_pooled);
+
+	marbles::vector<marbles::unique_ptr<int64_t>> values;
+	for (int64_t i = 0; i < 1000; ++i)
+	{
+		values.emplace_back(new int64_t(i));
+	}
+	cache_line* line = new cache_line();
+	EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(line) % 64);
+	int8_t* large = new int8_t[16 * 1024];
+	marbles::memory::install(previous);
+
+	for (int64_t i = 0; i < 1000; ++i)
+	{
+		EXPECT_EQ(i, *values[i]);
+	}
+	values.clear();
+	values.shrink_to_fit();
+	delete line;
+	delete[] large;
+	EXPECT_LT(0u, s_pooled.release());
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(memory_test, pooled_exhausted)
+{	// Backends return nullptr when memory is exhausted, only the throwing operator new turns that into bad_alloc
+	static marbles::pooled_memory s_pooled;
+	const size_t huge = 4 < sizeof(size_t) ? static_cast<size_t>(uint64_t(1) << 46) : size_t(3) << 30;
+	marbles::memory_backend* previous = marbles::memory::install(&s_pooled);
+	int8_t* failed = new (std::nothrow) int8_t[huge];
+	int8_t* unreachable = nullptr;
+	bool thrown = false;
+	try
+	{
+		unreachable = new int8_t[huge];
+	}
+	catch (const std::bad_alloc&)
+	{
+		thrown = true;
+	}
+	marbles::memory::install(previous);
+	EXPECT_EQ(nullptr, failed);
+	EXPECT_EQ(nullptr, unreachable);
+	EXPECT_TRUE(thrown);
+
+	marbles::size_class_allocator pools;
+	EXPECT_EQ(nullptr, pools.try_allocate(huge));
+	EXPECT_THROW(pools.allocate(huge), std::bad_alloc);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(memory_test, arena_backend)
+{
+	static marbles::arena_memory s_arena(1024);
+	marbles::memory_backend* previous = marbles::memory::install(&s_arena);
+	int32_t* first = new int32_t(1);
+	int32_t* second = new int32_t(2);
+	cache_line* line = new cache_line();
+	int8_t* large = new int8_t[4096];
+	marbles::memory::install(previous);
+
+	EXPECT_EQ(1, *first);
+	EXPECT_EQ(2, *second);
+	EXPECT_LT(first, second);
+	EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(line) % 64);
+	large[4095] = 1;
+
+	delete first;
+	delete second;
+	delete line;
+	delete[] large;
+	s_arena.reset();
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(memory_test, site_tracking)
+{
+	static const char* const label = "memory_test.site_tracking";
+	marbles::memory::track(1);
+	EXPECT_EQ(1u, marbles::memory::sample_rate());
+
+	marbles::vector<int32_t*> values;
+	values.reserve(10);
+	{
+		marbles::memory::site_scope scope(label);
+		for (int32_t i = 0; i < 10; ++i)
+		{
+			values.push_back(new int32_t(i));
+		}
+	}
+	int64_t* unlabelled = new int64_t(0);
+
+	auto find_label = []()
+	{
+		for (const auto& site : marbles::memory::sites())
+		{
+			if (label == site.label) { return site; }
+		}
+		return marbles::allocation_site();
+	};
+
+	marbles::allocation_site site = find_label();
+	EXPECT_EQ(nullptr, site.address);
+	EXPECT_EQ(10, site.live_count);
+	EXPECT_EQ(10 * int64_t(sizeof(int32_t)), site.live_bytes);
+	EXPECT_EQ(10, site.total_count);
+
+	bool found_address = false;
+	for (const auto& other : marbles::memory::sites())
+	{
+		found_address = found_address || (nullptr != other.address && 1 <= other.live_count);
+	}
+	EXPECT_TRUE(found_address);
+
+	for (int32_t* value : values)
+	{
+		delete value;
+	}
+	delete unlabelled;
+	marbles::memory::track(0);
+
+	site = find_label();
+	EXPECT_EQ(0, site.live_count);
+	EXPECT_EQ(0, site.live_bytes);
+	EXPECT_EQ(10, site.total_count);
+	marbles::memory::report(5);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(memory_test, pressure)
+{
+	using marbles::memory_pressure;
+	int32_t calls = 0;
+	memory_pressure last = memory_pressure::none;
+	marbles::memory::trimmer trimmer([&calls, &last](memory_pressure level)
+	{
+		++calls;
+		last = level;
+		return size_t(0);
+	});
+
+	EXPECT_EQ(0u, marbles::memory::budget());
+	EXPECT_EQ(memory_pressure::none, marbles::memory::collect());
+	EXPECT_EQ(0, calls);
+
+	// Usage beyond the budget is critical, trimmers are only called as the pressure rises
+	marbles::memory::set_budget(1);
+	EXPECT_EQ(memory_pressure::critical, marbles::memory::collect());
+	EXPECT_EQ(memory_pressure::critical, marbles::memory::collect());
+	EXPECT_EQ(1, calls);
+	EXPECT_EQ(memory_pressure::critical, last);
+
+	marbles::memory::set_budget(size_t(1) << 48);
+	EXPECT_EQ(memory_pressure::none, marbles::memory::collect());
+	EXPECT_EQ(1, calls);
+
+	const size_t live = static_cast<size_t>(marbles::memory::stats().live_bytes());
+	marbles::memory::set_budget(live + live / 5);
+	EXPECT_EQ(memory_pressure::moderate, marbles::memory::collect());
+	EXPECT_EQ(2, calls);
+	EXPECT_EQ(memory_pressure::moderate, last);
+
+	marbles::memory::set_budget(0);
+	EXPECT_EQ(memory_pressure::none, marbles::memory::collect());
+	EXPECT_EQ(2, calls);
+
+	// Trimming directly calls every trimmer regardless of the budget
+	marbles::memory::trim(memory_pressure::moderate);
+	EXPECT_EQ(3, calls);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(memory_test, trim_pools)
+{
+	marbles::size_class_allocator pools;
+	void* block = pools.allocate(24);
+	pools.deallocate(block, 24);
+	EXPECT_LT(0, pools.num_reserved(1));
+
+	marbles::atomic_queue<int32_t> queue(0);
+	const int32_t count = 4 * marbles::atomic_queue<int32_t>::segments_per_slab() * 64;
+	for (int32_t i = 0; i < count; ++i)
+	{
+		queue.enqueue(i);
+	}
+	while (queue.dequeue()) {}
+	for (int32_t i = 0; i < 3; ++i)
+	{
+		marbles::atomic_epoch::collect();
+	}
+	const int32_t drained = queue.num_reserved();
+
+	// Critical pressure releases every free slab
+	EXPECT_LT(0u, marbles::memory::trim(marbles::memory_pressure::critical));
+	EXPECT_EQ(0, pools.num_reserved(1));
+	EXPECT_GE(drained, queue.num_reserved());
+	EXPECT_GE(marbles::atomic_queue<int32_t>::segments_per_slab(), queue.num_reserved());
+}
+
+// End of file --------------------------------------------------------------------------------------------------------
@@ -0,0 +1,238 @@
+// This source file is part of marbles library.
+//
+// Copyright (c) 2023 Dan Cobban
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// --------------------------------------------------------------------------------------------------------------------
+
+#include <Common/Common.h>
+#include <Common/VirtualMemory.h>
+#include <Common/Allocator.h>
+#include <Common/AtomicQueue.h>
+#include <thread>
+
+using namespace marbles;
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(virtual_memory, commit_decommit)
+{
+	const size_t page = virtual_memory::page_size();
+	EXPECT_LT(0u, page);
+
+	const size_t size = 16 * page;
+	uint8_t* base = static_cast<uint8_t*>(virtual_memory::reserve(size));
+	ASSERT_NE(nullptr, base);
+
+	EXPECT_TRUE(virtual_memory::commit(base, 4 * page, true));
+	base[0] = 1;
+	base[4 * page - 1] = 2;
+	EXPECT_EQ(1, base[0]);
+	EXPECT_EQ(2, base[4 * page - 1]);
+
+	// Decommitted pages stay reserved and read back zeroed once committed again
+	virtual_memory::decommit(base, 4 * page);
+	EXPECT_TRUE(virtual_memory::commit(base, 4 * page));
+	EXPECT_EQ(0, base[0]);
+	virtual_memory::release(base, size);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(virtual_memory, block_allocator_slabs)
+{
+	typedef virtual_slabs<64 * mb> slab_source;
+	typedef block_allocator<64, pause_backoff, slab_source> allocator;
+	allocator pool;
+
+	const int32_t per_slab = allocator::blocks_per_slab;
+	pool.reserve(4 * per_slab);
+	EXPECT_EQ(4 * per_slab, pool.num_reserved());
+
+	vector<uint8_t*> blocks;
+	for (int32_t i = 0; i < 4 * per_slab; ++i)
+	{
+		uint8_t* block = static_cast<uint8_t*>(pool.allocate_block());
+		ASSERT_NE(nullptr, block);
+		*block = static_cast<uint8_t>(i);
+		blocks.push_back(block);
+	}
+	EXPECT_FALSE(pool.can_allocate());
+
+	for (uint8_t* block : blocks)
+	{
+		pool.free_block(block);
+	}
+	EXPECT_EQ(4 * per_slab, pool.release());
+	EXPECT_EQ(0, pool.num_reserved());
+
+	// Released slabs are decommitted and handed out again
+	pool.reserve(per_slab);
+	EXPECT_EQ(per_slab, pool.num_reserved());
+	void* reused = pool.allocate_block();
+	EXPECT_NE(nullptr, reused);
+	pool.free_block(reused);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(virtual_memory, concurrent_release)
+{	// Released slabs are decommitted, threads still popping the free list must never read a decommitted slab
+	typedef block_allocator<64, pause_backoff, virtual_slabs<64 * mb>> allocator;
+	allocator pool;
+	atomic<bool> done = false;
+
+	std::thread workers[4];
+	for (auto& slot : workers)
+	{
+		std::thread worker([&pool, &done]()
+		{
+			void* blocks[8] = {};
+			while (!done.load())
+			{
+				for (void*& block : blocks)
+				{
+					block = pool.allocate_block();
+					if (nullptr == block)
+					{
+						pool.reserve(1);
+					}
+				}
+				for (void* block : blocks)
+				{
+					pool.free_block(block);
+				}
+			}
+		});
+		slot.swap(worker);
+	}
+
+	for (int32_t i = 0; i < 200; ++i)
+	{
+		pool.release();
+		std::this_thread::yield();
+	}
+	done.store(true);
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+	EXPECT_EQ(0, pool.num_outstanding());
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(virtual_memory, slab_reuse_and_fallback)
+{
+	const size_t slab = 64 * kb;
+	virtual_slabs<4 * 64 * kb, 64 * kb> source;
+	ASSERT_TRUE(source.reserved());
+
+	void* slabs[4] = {};
+	for (void*& memory : slabs)
+	{
+		memory = source.allocate(slab, slab);
+		ASSERT_NE(nullptr, memory);
+		EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(memory) % slab);
+	}
+	EXPECT_EQ(4 * slab, source.bytes_used());
+
+	// The reservation is exhausted so further slabs come from the heap
+	void* overflow = source.allocate(slab, slab);
+	ASSERT_NE(nullptr, overflow);
+	EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(overflow) % slab);
+
+	// A returned slab is reused before the heap is touched again
+	source.deallocate(slabs[2], slab, slab);
+	EXPECT_EQ(slabs[2], source.allocate(slab, slab));
+
+	// Requests that do not match the bound slab size also fall back
+	void* other = source.allocate(2 * slab, 2 * slab);
+	ASSERT_NE(nullptr, other);
+
+	source.deallocate(other, 2 * slab, 2 * slab);
+	source.deallocate(overflow, slab, slab);
+	for (void* memory : slabs)
+	{
+		source.deallocate(memory, slab, slab);
+	}
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+namespace
+{
+// Pages that refuse to commit while fail() is set, as when the system is out of commit charge
+struct flaky_pages : public virtual_memory
+{
+	static bool& fail() { static bool s_fail = false; return s_fail; }
+
+	static bool commit(void* address, size_t size, bool huge = false)
+	{
+		return !fail() && virtual_memory::commit(address, size, huge);
+	}
+};
+} // namespace <>
+
+TEST(virtual_memory, commit_failure)
+{	// A slab whose pages cannot be committed comes from the heap, its range is kept and committed on the next request
+	const size_t slab = 64 * kb;
+	virtual_slabs<4 * 64 * kb, 64 * kb, false, flaky_pages> source;
+	ASSERT_TRUE(source.reserved());
+
+	flaky_pages::fail() = true;
+	void* fallback = source.allocate(slab, slab);
+	ASSERT_NE(nullptr, fallback);
+	EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(fallback) % slab);
+	EXPECT_EQ(slab, source.bytes_used());
+
+	flaky_pages::fail() = false;
+	void* reused = source.allocate(slab, slab);
+	ASSERT_NE(nullptr, reused);
+	EXPECT_NE(fallback, reused);
+	EXPECT_EQ(slab, source.bytes_used());
+	static_cast<uint8_t*>(reused)[slab - 1] = 1;
+
+	source.deallocate(reused, slab, slab);
+	source.deallocate(fallback, slab, slab);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+TEST(virtual_memory, queue_slabs)
+{
+	atomic_queue<int32_t, 64, virtual_slabs<64 * mb>> queue(0);
+	const int32_t count = 64 * 1024;
+
+	std::thread producer([&queue, count]()
+	{
+		for (int32_t i = 0; i < count; ++i)
+		{
+			queue.enqueue(i);
+		}
+	});
+
+	int32_t expected = 0;
+	while (expected < count)
+	{
+		int32_t value = -1;
+		if (queue.dequeue(value))
+		{
+			ASSERT_EQ(expected++, value);
+		}
+	}
+	producer.join();
+	EXPECT_TRUE(queue.empty());
+}
+
+// End of file --------------------------------------------------------------------------------------------------------
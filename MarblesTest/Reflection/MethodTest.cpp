@@ -0,0 +1,270 @@
+// This source file is part of marbles library.
+//
+// Copyright (c) 2023 Dan Cobban
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// --------------------------------------------------------------------------------------------------------------------
+
+#include "FooBar.h"
+
+using namespace marbles::reflection;
+
+struct Account
+{
+	Account() : balance(0), deposits(0) {}
+
+	marbles::int32_t	balance;
+	marbles::int32_t	deposits;
+	marbles::string		owner;
+
+	marbles::int32_t	deposit(marbles::int32_t amount)		{ balance += amount; ++deposits; return balance; }
+	double				interest(float rate, marbles::int32_t years) const { return balance * rate * years; }
+	void				rename(const marbles::string& name)	{ owner = name; }
+	const marbles::string& name() const							{ return owner; }
+	Account*			self()									{ return this; }
+	void				close()									{ balance = 0; }
+	bool				transfer(Account* to, marbles::int32_t amount)
+	{
+		if (NULL == to || balance < amount)
+		{
+			return false;
+		}
+		balance -= amount;
+		to->balance += amount;
+		return true;
+	}
+};
+
+REFLECT_TYPE(Account,
+	REFLECT_CREATOR()
+	REFLECT_MEMBER("balance", &Account::balance, "")
+	REFLECT_MEMBER("deposits", &Account::deposits, "")
+	REFLECT_MEMBER("owner", &Account::owner, "")
+	REFLECT_MEMBER("deposit", &Account::deposit, "")
+	REFLECT_MEMBER("interest", &Account::interest, "")
+	REFLECT_MEMBER("rename", &Account::rename, "")
+	REFLECT_MEMBER("name", &Account::name, "")
+	REFLECT_MEMBER("self", &Account::self, "")
+	REFLECT_MEMBER("close", &Account::close, "")
+	REFLECT_MEMBER("transfer", &Account::transfer, "")
+	)
+
+TEST(reflection_method, call)
+{
+	Account account;
+	object self(account);
+	shared_member deposit = self.memberInfo("deposit");
+	ASSERT_TRUE(deposit);
+	EXPECT_TRUE(deposit->callable());
+	EXPECT_EQ(3u, type_of<Account>()->fields().size());
+
+	// Arguments refer to the values the objects were made from
+	marbles::int32_t amount = 25;
+	object args[] = { object(amount) };
+	object balance = deposit->call(self, args, 1);
+	ASSERT_TRUE(balance.isValid());
+	EXPECT_EQ(25, balance.as<marbles::int32_t>());
+	amount = 5;
+	EXPECT_EQ(30, deposit->call(self, args, 1).as<marbles::int32_t>());
+	EXPECT_EQ(30, account.balance);
+	EXPECT_EQ(2, account.deposits);
+	EXPECT_EQ(25, balance.as<marbles::int32_t>()); // Returned values are held by the result
+
+	float rate = 0.5f;
+	marbles::int32_t years = 2;
+	object interestArgs[] = { object(rate), object(years) };
+	object interest = self.memberInfo("interest")->call(self, interestArgs, 2);
+	ASSERT_TRUE(interest.isValid());
+	EXPECT_EQ(30.0, interest.as<double>());
+
+	// Nothing is returned by a void method
+	marbles::string name("savings");
+	object nameArgs[] = { object(name) };
+	EXPECT_FALSE(self.memberInfo("rename")->call(self, nameArgs, 1).isValid());
+	EXPECT_EQ(name, account.owner);
+
+	// Returned references refer to the value
+	object owner = self.memberInfo("name")->call(self, NULL, 0);
+	ASSERT_TRUE(owner.isValid());
+	EXPECT_EQ(&account.owner, owner.address());
+	EXPECT_TRUE(owner.isConstant());
+
+	// Pointers are passed and returned as references
+	Account other;
+	Account* to = &other;
+	marbles::int32_t moved = 10;
+	object transferArgs[] = { object(to), object(moved) };
+	EXPECT_TRUE(self.memberInfo("transfer")->call(self, transferArgs, 2).as<bool>());
+	EXPECT_EQ(20, account.balance);
+	EXPECT_EQ(10, other.balance);
+	to = NULL;
+	EXPECT_FALSE(self.memberInfo("transfer")->call(self, transferArgs, 2).as<bool>());
+	object same = self.memberInfo("self")->call(self, NULL, 0);
+	ASSERT_TRUE(same.isReference());
+	EXPECT_EQ(&account, same.as<Account*>());
+
+	// Called on a value through a reference to it
+	Account* pointer = &other;
+	object reference(pointer);
+	self.memberInfo("close")->call(reference, NULL, 0);
+	EXPECT_EQ(0, other.balance);
+	EXPECT_EQ(20, account.balance);
+
+	// Methods are reached as callable objects
+	object callable = self.at("deposit");
+	EXPECT_TRUE(callable.isCallable());
+	EXPECT_EQ(deposit, callable.memberInfo());
+
+	type_info::clear_registrar();
+}
+
+TEST(reflection_method, mismatch)
+{
+	Account account;
+	object self(account);
+	shared_member deposit = self.memberInfo("deposit");
+	ASSERT_TRUE(deposit);
+
+	marbles::int32_t amount = 25;
+	float wrong = 25.0f;
+	object args[] = { object(amount), object(amount) };
+	object wrongArgs[] = { object(wrong) };
+	EXPECT_FALSE(deposit->call(self, args, 2).isValid());
+	EXPECT_FALSE(deposit->call(self, NULL, 0).isValid());
+	EXPECT_FALSE(deposit->call(self, wrongArgs, 1).isValid());
+	EXPECT_EQ(0, account.deposits);
+
+	// Only const methods are called on a constant value
+	const Account& constant = account;
+	object constantSelf(constant);
+	EXPECT_FALSE(deposit->call(constantSelf, args, 1).isValid());
+	float rate = 0.5f;
+	object interestArgs[] = { object(rate), object(amount) };
+	EXPECT_TRUE(self.memberInfo("interest")->call(constantSelf, interestArgs, 2).isValid());
+
+	// Constant values are copied into value parameters but never bound to mutable ones
+	const marbles::int32_t constantAmount = 5;
+	object constantArgs[] = { object(constantAmount) };
+	EXPECT_TRUE(deposit->call(self, constantArgs, 1).isValid());
+	EXPECT_EQ(5, account.balance);
+	const Account other;
+	object transferArgs[] = { object(other), object(amount) };
+	EXPECT_FALSE(self.memberInfo("transfer")->call(self, transferArgs, 2).isValid());
+	EXPECT_EQ(0, other.balance);
+
+	// Values of other types are not called on
+	Foo foo;
+	object notAccount(foo);
+	EXPECT_FALSE(deposit->call(notAccount, args, 1).isValid());
+	EXPECT_EQ(1, account.deposits);
+
+	type_info::clear_registrar();
+}
+
+TEST(reflection_method, invoke)
+{
+	Account account;
+	object self(account);
+	shared_member deposit = self.memberInfo("deposit");
+	ASSERT_TRUE(deposit);
+
+	marbles::int32_t amount = 25;
+	marbles::int32_t balance = 0;
+	object args[] = { object(amount) };
+	EXPECT_TRUE(deposit->invoke(self, args, 1, object(balance)));
+	EXPECT_EQ(25, balance);
+
+	// Results of another type are not written and the method is not called
+	float wrong = 0.0f;
+	EXPECT_FALSE(deposit->invoke(self, args, 1, object(wrong)));
+	EXPECT_EQ(25, account.balance);
+
+	// An invalid result discards the returned value
+	EXPECT_TRUE(deposit->invoke(self, args, 1, object_view()));
+	EXPECT_EQ(50, account.balance);
+	EXPECT_TRUE(self.memberInfo("close")->invoke(self, NULL, 0, object_view()));
+	EXPECT_EQ(0, account.balance);
+
+	Account* returned = NULL;
+	EXPECT_TRUE(self.memberInfo("self")->invoke(self, NULL, 0, object(returned)));
+	EXPECT_EQ(&account, returned);
+
+	marbles::string name("checking");
+	account.owner = name;
+	marbles::string copied;
+	EXPECT_TRUE(self.memberInfo("name")->invoke(self, NULL, 0, object(copied)));
+	EXPECT_EQ(name, copied);
+
+	type_info::clear_registrar();
+}
+
+TEST(reflection_method_benchmark, call)
+{
+	static const int num_calls = 1000000;
+	Account direct;
+	marbles::int64_t direct_sum = 0;
+	auto start = marbles::chrono::high_resolution_clock::now();
+	for (int i = 0; i < num_calls; ++i)
+	{
+		direct_sum += direct.deposit(i & 7);
+	}
+	marbles::chrono::duration<double, std::milli> direct_time = marbles::chrono::high_resolution_clock::now() - start;
+
+	// Arguments are marshalled from an array on the stack, the returned value is allocated
+	Account called;
+	object self(called);
+	shared_member deposit = self.memberInfo("deposit");
+	ASSERT_TRUE(deposit);
+	marbles::int32_t amount = 0;
+	object args[] = { object(amount) };
+	marbles::int64_t call_sum = 0;
+	start = marbles::chrono::high_resolution_clock::now();
+	for (int i = 0; i < num_calls; ++i)
+	{
+		amount = i & 7;
+		call_sum += deposit->call(self, args, 1).as<marbles::int32_t>();
+	}
+	marbles::chrono::duration<double, std::milli> call_time = marbles::chrono::high_resolution_clock::now() - start;
+
+	// Nothing is allocated, the returned value is written to the caller's storage
+	Account invoked;
+	object invokedSelf(invoked);
+	marbles::int32_t balance = 0;
+	object result(balance);
+	marbles::int64_t invoke_sum = 0;
+	start = marbles::chrono::high_resolution_clock::now();
+	for (int i = 0; i < num_calls; ++i)
+	{
+		amount = i & 7;
+		deposit->invoke(invokedSelf, args, 1, result);
+		invoke_sum += balance;
+	}
+	marbles::chrono::duration<double, std::milli> invoke_time = marbles::chrono::high_resolution_clock::now() - start;
+
+	EXPECT_EQ(direct_sum, call_sum);
+	EXPECT_EQ(direct_sum, invoke_sum);
+	::testing::Test::RecordProperty("calls", num_calls);
+	::testing::Test::RecordProperty("direct_us", static_cast<int>(1000.0 * direct_time.count()));
+	::testing::Test::RecordProperty("call_us", static_cast<int>(1000.0 * call_time.count()));
+	::testing::Test::RecordProperty("invoke_us", static_cast<int>(1000.0 * invoke_time.count()));
+
+	type_info::clear_registrar();
+}
+
+// End of file --------------------------------------------------------------------------------------------------------
@@ -25,6 +25,38 @@
 
 using namespace marbles::reflection;
 
+struct Point
+{
+	marbles::int32_t x;
+	marbles::int32_t y;
+	marbles::int32_t z;
+};
+
+REFLECT_TYPE(Point,
+	REFLECT_MEMBER("x", &Point::x, "")
+	REFLECT_MEMBER("y", &Point::y, "")
+	REFLECT_MEMBER("z", &Point::z, "")
+	)
+
+// Integers compare as one run of bytes, the float by value
+struct Record
+{
+	marbles::int32_t a, b, c, d, e, f, g, h;
+	float weight;
+};
+
+REFLECT_TYPE(Record,
+	REFLECT_MEMBER("a", &Record::a, "")
+	REFLECT_MEMBER("b", &Record::b, "")
+	REFLECT_MEMBER("c", &Record::c, "")
+	REFLECT_MEMBER("d", &Record::d, "")
+	REFLECT_MEMBER("e", &Record::e, "")
+	REFLECT_MEMBER("f", &Record::f, "")
+	REFLECT_MEMBER("g", &Record::g, "")
+	REFLECT_MEMBER("h", &Record::h, "")
+	REFLECT_MEMBER("weight", &Record::weight, "")
+	)
+
 TEST(reflection_object, reflection_object_field )
 {
 	Foo foo;
@@ -77,6 +109,138 @@ TEST(reflection_object, reflection_object_field )
 	bar_obj.at("weak_foo") = bar_obj.at("shared_foo");
 	Foo* test3 = bar_obj.at("weak_foo").as<Foo*>();
 	EXPECT_EQ(test1, test3);
+
+	// An expired weak reference reads as a null pointer
+	Foo expired;
+	expired.bar.weak_foo = marbles::make_shared<Foo>();
+	EXPECT_EQ(nullptr, object(expired).at("Bar").at("weak_foo").as<Foo*>());
 	
 	marbles::reflection::type_info::clear_registrar();
 }
+
+TEST(reflection_object, object_view)
+{
+	Foo foo;
+	foo.x = 1;
+	foo.y = 2.0f;
+	foo.z = 3ull;
+	foo.bar.reference_foo = &foo;
+	foo.bar.shared_foo = marbles::make_shared<Foo>();
+	foo.bar.shared_foo->x = 4;
+	foo.bar.weak_foo = foo.bar.shared_foo;
+
+	object foo_obj(foo);
+	object_view foo_view(foo_obj);
+	ASSERT_TRUE(foo_view.isValid());
+	EXPECT_EQ(foo_obj.typeInfo().get(), foo_view.typeInfo());
+	EXPECT_EQ(foo_obj.hashName(), foo_view.hashName());
+
+	// Views reach the same values as objects
+	EXPECT_EQ(foo.x, foo_view.at("X").as<int>());
+	EXPECT_EQ(foo.z, foo_view.at("Z").as<marbles::uint64_t>());
+	EXPECT_STREQ("X", foo_view.at("X").memberInfo()->name());
+	const object_view bar_view = foo_view.at("Bar");
+	EXPECT_TRUE(bar_view.identical(object_view(foo_obj.at("Bar"))));
+	EXPECT_EQ(foo_obj.at("Bar").at("shared_foo").hashName(), bar_view.at("shared_foo").hashName());
+	EXPECT_EQ((*foo_obj.at("Bar").at("shared_foo")).hashName(), (*bar_view.at("shared_foo")).hashName());
+	EXPECT_EQ(&foo, &bar_view.at("reference_foo").as<Foo>());
+	EXPECT_EQ(4, bar_view.at("shared_foo").at("X").as<int>());
+	EXPECT_EQ(4, bar_view.at("weak_foo").at("X").as<int>());
+	EXPECT_FALSE(foo_view.at("W").isValid());
+
+	foo_view.at("Y").as<float>() = 0.5f;
+	EXPECT_EQ(0.5f, foo.y);
+
+	// Assignment through views follows the reference semantics of objects
+	EXPECT_TRUE(bar_view.at("reference_zero").assign(bar_view.at("shared_foo")));
+	EXPECT_EQ(foo.bar.shared_foo.get(), foo.bar.reference_zero);
+	EXPECT_TRUE(bar_view.at("reference_zero").assignZero());
+	EXPECT_EQ(nullptr, foo.bar.reference_zero);
+	EXPECT_TRUE(bar_view.at("weak_foo").assignZero());
+	EXPECT_TRUE(foo.bar.weak_foo.expired());
+	EXPECT_TRUE(bar_view.at("weak_foo").assign(bar_view.at("shared_foo")));
+	EXPECT_EQ(foo.bar.shared_foo, foo.bar.weak_foo.lock());
+
+	// Member wise assignment of a whole object
+	Foo copy;
+	object copy_obj(copy);
+	copy_obj = foo_obj;
+	EXPECT_EQ(foo.x, copy.x);
+	EXPECT_EQ(foo.y, copy.y);
+	EXPECT_EQ(foo.z, copy.z);
+	EXPECT_EQ(foo.bar.shared_foo, copy.bar.shared_foo);
+
+	object round_trip = foo_view.at("Bar").toObject();
+	EXPECT_TRUE(round_trip.identical(foo_obj.at("Bar")));
+	EXPECT_STREQ("Bar", round_trip.memberInfo()->name());
+
+	marbles::reflection::type_info::clear_registrar();
+}
+
+TEST(reflection_object, equal)
+{
+	Foo foo;
+	foo.x = 1;
+	foo.y = 0.0f;
+	foo.z = 3ull;
+	foo.bar.reference_foo = &foo;
+	foo.bar.shared_foo = marbles::make_shared<Foo>();
+	Foo other;
+	other.x = 1;
+	other.y = -0.0f;
+	other.z = 3ull;
+	other.bar.reference_foo = &foo;
+	other.bar.shared_foo = foo.bar.shared_foo;
+
+	// Values compare member by member, floats by value and references by the address they refer to
+	object foo_obj(foo);
+	object other_obj(other);
+	EXPECT_TRUE(foo_obj.equal(other_obj));
+	EXPECT_TRUE(foo_obj == other_obj);
+	EXPECT_FALSE(foo_obj.identical(other_obj));
+	other.z = 4ull;
+	EXPECT_TRUE(foo_obj != other_obj);
+	other.z = 3ull;
+	other.bar.shared_foo = marbles::make_shared<Foo>();
+	EXPECT_FALSE(foo_obj == other_obj); // An equal value at another address is a different reference
+	other.bar.shared_foo = foo.bar.shared_foo;
+	other.bar.weak_foo = foo.bar.shared_foo;
+	EXPECT_FALSE(foo_obj == other_obj);
+	foo.bar.weak_foo = foo.bar.shared_foo;
+	EXPECT_TRUE(foo_obj == other_obj);
+
+	// A reference compares equal to the value it refers to, cycles through references terminate
+	EXPECT_TRUE(foo_obj.at("Bar").at("reference_foo") == foo_obj);
+	EXPECT_TRUE(foo_obj.at("Bar").at("reference_foo") == other_obj.at("Bar").at("reference_foo"));
+	EXPECT_FALSE(foo_obj.at("Bar") == foo_obj);
+	EXPECT_FALSE(foo_obj.at("Bar").at("reference_zero") == foo_obj);
+
+	// Trivially comparable values compare with one memcmp
+	Point point = { 1, 2, 3 };
+	Point same = { 1, 2, 3 };
+	EXPECT_TRUE(object(point) == object(same));
+	same.z = 4;
+	EXPECT_FALSE(object(point) == object(same));
+
+	// The base member assignment copies runs of trivially copyable fields at once
+	Foo copy;
+	object copy_obj(copy);
+	type_of<Foo>()->valueDeclaration().memberInfo()->member::assign(copy_obj, foo_obj);
+	EXPECT_EQ(foo.x, copy.x);
+	EXPECT_EQ(foo.z, copy.z);
+	EXPECT_EQ(&foo, copy.bar.reference_foo);
+	EXPECT_EQ(foo.bar.shared_foo, copy.bar.shared_foo);
+	EXPECT_TRUE(copy_obj == foo_obj);
+
+	Record record = { 1, 2, 3, 4, 5, 6, 7, 8, 0.5f };
+	Record record_copy = {};
+	object record_obj(record);
+	object record_copy_obj(record_copy);
+	type_of<Record>()->valueDeclaration().memberInfo()->member::assign(record_copy_obj, record_obj);
+	EXPECT_EQ(0, memcmp(&record, &record_copy, sizeof(Record)));
+	EXPECT_TRUE(record_obj == record_copy_obj);
+	record_copy.h = 9;
+	EXPECT_FALSE(record_obj == record_copy_obj);
+
+	marbles::reflection::type_info::clear_registrar();
+}
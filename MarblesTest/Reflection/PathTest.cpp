@@ -0,0 +1,134 @@
+// This source file is part of marbles library.
+//
+// Copyright (c) 2023 Dan Cobban
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// --------------------------------------------------------------------------------------------------------------------
+
+#include "FooBar.h"
+
+using namespace marbles::reflection;
+
+TEST(reflection_path, parse)
+{
+	const char* route = "Bar.shared_foo.X";
+	path parsed(route);
+	ASSERT_EQ(3u, parsed.size());
+	EXPECT_EQ(type_info::hash("Bar"), parsed[0]);
+	EXPECT_EQ(type_info::hash("shared_foo"), parsed[1]);
+	EXPECT_EQ(type_info::hash("X"), parsed[2]);
+	EXPECT_STREQ("Bar.shared_foo.X", route);
+
+	EXPECT_EQ(1u, path("X").size());
+	EXPECT_EQ(type_info::hash("X"), path("X")[0]);
+}
+
+TEST(reflection_path, compiled_path)
+{
+	Foo foo;
+	foo.x = 1;
+	foo.bar.reference_foo = &foo;
+	foo.bar.shared_foo = marbles::make_shared<Foo>();
+	foo.bar.shared_foo->x = 4;
+	foo.bar.shared_foo->z = 5ull;
+	foo.bar.weak_foo = foo.bar.shared_foo;
+	object foo_obj(foo);
+
+	// Compiled paths reach the same values as object::at(path)
+	const char* routes[] = { "X", "Bar.reference_foo.X", "Bar.shared_foo.X", "Bar.weak_foo.Z", "Bar.shared_foo" };
+	for (const char* route : routes)
+	{
+		compiled_path compiled(type_of<Foo>(), route);
+		ASSERT_TRUE(compiled.isValid()) << route;
+		EXPECT_EQ(path(route).size(), compiled.depth());
+		const object expected = foo_obj.at(path(route));
+		const object_view found = compiled.apply(foo_obj);
+		ASSERT_TRUE(found.isValid()) << route;
+		EXPECT_EQ(expected.hashName(), found.hashName()) << route;
+		EXPECT_EQ(expected.memberInfo().get(), found.memberInfo()) << route;
+	}
+
+	compiled_path x(type_of<Foo>(), "Bar.shared_foo.X");
+	EXPECT_STREQ("X", x.leaf()->name());
+	EXPECT_EQ(4, x.apply(foo_obj).as<int>());
+	x.apply(foo_obj).as<int>() = 6;
+	EXPECT_EQ(6, foo.bar.shared_foo->x);
+
+	// The same path applies to every object of the root type
+	Foo other;
+	other.bar.shared_foo = marbles::make_shared<Foo>();
+	other.bar.shared_foo->x = 7;
+	EXPECT_EQ(7, x.apply(object(other)).as<int>());
+
+	// Null references end the walk
+	EXPECT_FALSE(compiled_path(type_of<Foo>(), "Bar.reference_zero.X").apply(foo_obj).isValid());
+	other.bar.shared_foo.reset();
+	EXPECT_FALSE(x.apply(object(other)).isValid());
+
+	// A value reached through a weak reference is kept alive by the view until the view is dropped
+	{
+		other.bar.shared_foo = marbles::make_shared<Foo>();
+		other.bar.shared_foo->x = 8;
+		other.bar.weak_foo = other.bar.shared_foo;
+		const object_view held = compiled_path(type_of<Foo>(), "Bar.weak_foo.X").apply(object(other));
+		other.bar.shared_foo.reset();
+		EXPECT_FALSE(other.bar.weak_foo.expired());
+		EXPECT_EQ(8, held.as<int>());
+	}
+	EXPECT_TRUE(other.bar.weak_foo.expired());
+
+	// Unknown members do not compile
+	EXPECT_FALSE(compiled_path(type_of<Foo>(), "Bar.W").isValid());
+	EXPECT_FALSE(compiled_path(type_of<Foo>(), "X.Y").isValid());
+	EXPECT_FALSE(compiled_path().apply(foo_obj).isValid());
+
+	type_info::clear_registrar();
+}
+
+TEST(reflection_path, path_cache)
+{
+	path_cache cache(2);
+	EXPECT_EQ(2u, cache.capacity());
+	const shared_type foo = type_of<Foo>();
+	const shared_type bar = type_of<Bar>();
+
+	path_cache::shared_path x = cache.compile(foo, "Bar.shared_foo.X");
+	ASSERT_TRUE(x && x->isValid());
+	EXPECT_EQ(x, cache.compile(foo, marbles::string("Bar.shared_foo.X")));
+	EXPECT_NE(x, cache.compile(bar, "shared_foo.X")); // Same name below a different root
+	EXPECT_EQ(2u, cache.size());
+
+	// Least recently used entry is evicted first
+	cache.compile(foo, "Bar.shared_foo.X");
+	path_cache::shared_path y = cache.compile(foo, "Y");
+	EXPECT_EQ(2u, cache.size());
+	EXPECT_EQ(x, cache.compile(foo, "Bar.shared_foo.X"));
+	EXPECT_EQ(y, cache.compile(foo, "Y"));
+
+	// Invalid paths are cached too
+	EXPECT_FALSE(cache.compile(foo, "W")->isValid());
+
+	cache.clear();
+	EXPECT_EQ(0u, cache.size());
+	EXPECT_NE(x, cache.compile(foo, "Bar.shared_foo.X"));
+
+	type_info::clear_registrar();
+}
+
+// End of file --------------------------------------------------------------------------------------------------------
@@ -0,0 +1,155 @@
+// This source file is part of marbles library.
+//
+// Copyright (c) 2023 Dan Cobban
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// --------------------------------------------------------------------------------------------------------------------
+
+#include "FooBar.h"
+
+using namespace marbles::reflection;
+
+struct Particle
+{
+	float x;
+	float y;
+	float z;
+	marbles::int32_t id;
+	marbles::int32_t unreflected;
+};
+
+REFLECT_TYPE(Particle,
+	REFLECT_MEMBER("x", &Particle::x, "")
+	REFLECT_MEMBER("y", &Particle::y, "")
+	REFLECT_MEMBER("z", &Particle::z, "")
+	REFLECT_MEMBER("id", &Particle::id, "")
+	)
+
+TEST(reflection_soa_vector, columns)
+{
+	soa_vector<Particle> particles;
+	ASSERT_EQ(4u, particles.columns().size());
+	EXPECT_TRUE(particles.empty());
+
+	for (int i = 0; i < 100; ++i)
+	{
+		particles.push_back(Particle{ float(i), float(2 * i), float(3 * i), i, 7 });
+	}
+	ASSERT_EQ(100u, particles.size());
+	EXPECT_LE(100u, particles.capacity());
+
+	// Elements are gathered back from the columns, unreflected fields are not stored
+	const Particle p = particles.get(42);
+	EXPECT_EQ(42.0f, p.x);
+	EXPECT_EQ(84.0f, p.y);
+	EXPECT_EQ(126.0f, p.z);
+	EXPECT_EQ(42, p.id);
+	EXPECT_EQ(0, p.unreflected);
+
+	// Typed columns are contiguous arrays of one member
+	soa_column<float> y = particles.column(&Particle::y);
+	ASSERT_TRUE(y.isValid());
+	ASSERT_EQ(100u, y.size());
+	EXPECT_EQ(particles.column<float>("y").data(), y.data());
+	EXPECT_EQ(y.data() + 1, &y[1]);
+	float sum = 0.0f;
+	for (float value : y)
+	{
+		sum += value;
+	}
+	EXPECT_EQ(9900.0f, sum);
+	particles.column<marbles::int32_t>("id")[5] = 500;
+	EXPECT_EQ(500, particles.get(5).id);
+	EXPECT_FALSE(particles.column(&Particle::unreflected).isValid());
+	EXPECT_FALSE(particles.column<float>("w").isValid());
+
+	// Reflection aware access walks the columns through object_view
+	for (const soa_vector<Particle>::column_info& column : particles.columns())
+	{
+		object_view value = particles.at(7, column);
+		ASSERT_TRUE(value.isValid());
+		EXPECT_EQ(column.member.get(), value.memberInfo());
+		EXPECT_EQ(column.member->typePtr(), value.typeInfo());
+	}
+	particles.at(7, "z").as<float>() = -1.0f;
+	EXPECT_EQ(-1.0f, particles.get(7).z);
+	EXPECT_FALSE(particles.at(7, "w").isValid());
+
+	particles.set(9, Particle{ 1.0f, 2.0f, 3.0f, 4, 5 });
+	EXPECT_EQ(4, particles.get(9).id);
+	particles.pop_back();
+	EXPECT_EQ(99u, particles.size());
+	particles.resize(120);
+	EXPECT_EQ(0, particles.get(110).id);
+	EXPECT_EQ(0.0f, particles.get(99).x);
+	particles.clear();
+	EXPECT_TRUE(particles.empty());
+
+	type_info::clear_registrar();
+}
+
+struct alignas(32) Lane
+{
+	float values[8];
+};
+
+struct Simd
+{
+	marbles::int8_t flag;
+	Lane lane;
+};
+
+REFLECT_TYPE(Lane, REFLECT_CREATOR())
+REFLECT_TYPE(Simd,
+	REFLECT_MEMBER("flag", &Simd::flag, "")
+	REFLECT_MEMBER("lane", &Simd::lane, "")
+	)
+
+TEST(reflection_soa_vector, aligned_columns)
+{
+	soa_vector<Simd> lanes;
+	for (int i = 0; i < 100; ++i)
+	{
+		Simd value = {};
+		value.flag = static_cast<marbles::int8_t>(i);
+		value.lane.values[7] = float(i);
+		lanes.push_back(value);
+	}
+
+	// Every element of an over-aligned column keeps the alignment of its field, also after the columns grew
+	soa_column<Lane> lane = lanes.column(&Simd::lane);
+	ASSERT_TRUE(lane.isValid());
+	for (const Lane& value : lane)
+	{
+		EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(&value) % alignof(Lane));
+	}
+	EXPECT_EQ(42.0f, lane[42].values[7]);
+	EXPECT_EQ(42, lanes.get(42).flag);
+
+	// Columns of a constant vector are read only views of the same storage
+	const soa_vector<Simd>& constant = lanes;
+	soa_column<const Lane> read = constant.column(&Simd::lane);
+	EXPECT_EQ(lane.data(), read.data());
+	EXPECT_EQ(99, constant.column<marbles::int8_t>("flag")[99]);
+	EXPECT_FALSE(constant.column<float>("w").isValid());
+
+	type_info::clear_registrar();
+}
+
+// End of file --------------------------------------------------------------------------------------------------------
@@ -0,0 +1,503 @@
+// This source file is part of marbles library.
+//
+// Copyright (c) 2023 Dan Cobban
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// --------------------------------------------------------------------------------------------------------------------
+
+#include "FooBar.h"
+#include <Reflection/AllocatorStats.h>
+
+using namespace marbles::reflection;
+
+struct Wide
+{
+	int value;
+};
+
+REFLECT_TYPE(Wide,
+	REFLECT_MEMBER("value", &Wide::value, "")
+	)
+
+namespace
+{
+// Builds a type with num_members members named "member_<i>" all bound to Wide::value
+shared_type build_wide_type(const char* name, size_t num_members)
+{
+	type_info::builder builder;
+	shared_type type = builder.create<Wide>(name);
+	for (size_t i = 0; i < num_members; ++i)
+	{
+		marbles::stringstream ss;
+		ss << "member_" << i;
+		builder.addMember(ss.str().c_str(), &Wide::value);
+	}
+	return builder.finalize();
+}
+
+// Times lookups of every member by hash through the index and through a scan of members()
+void member_index_benchmark(size_t num_members)
+{
+	static const int num_passes = 200;
+	marbles::stringstream name;
+	name << "member_index_" << num_members;
+	shared_type type = build_wide_type(name.str().c_str(), num_members);
+	ASSERT_TRUE(type);
+
+	marbles::vector<marbles::hash_t> hashes;
+	for (const shared_member& member : type->members())
+	{
+		hashes.push_back(member->hashName());
+	}
+
+	size_t found = 0;
+	auto start = marbles::chrono::high_resolution_clock::now();
+	for (int pass = 0; pass < num_passes; ++pass)
+	{
+		for (marbles::hash_t hashName : hashes)
+		{
+			found += type->memberIndex(hashName);
+		}
+	}
+	marbles::chrono::duration<double, std::milli> indexed = marbles::chrono::high_resolution_clock::now() - start;
+
+	size_t scanned = 0;
+	start = marbles::chrono::high_resolution_clock::now();
+	for (int pass = 0; pass < num_passes; ++pass)
+	{
+		for (marbles::hash_t hashName : hashes)
+		{
+			size_t i = 0;
+			while (i < type->members().size() && hashName != type->members()[i]->hashName())
+			{
+				++i;
+			}
+			scanned += i;
+		}
+	}
+	marbles::chrono::duration<double, std::milli> linear = marbles::chrono::high_resolution_clock::now() - start;
+
+	EXPECT_EQ(found, scanned);
+	::testing::Test::RecordProperty("members", static_cast<int>(num_members));
+	::testing::Test::RecordProperty("member_index_us", static_cast<int>(1000.0 * indexed.count()));
+	::testing::Test::RecordProperty("linear_scan_us", static_cast<int>(1000.0 * linear.count()));
+}
+} // namespace <>
+
+TEST(reflection_type, member_index)
+{
+	shared_type foo = type_of<Foo>();
+	EXPECT_EQ(0u, foo->memberIndex("Bar"));
+	EXPECT_EQ(3u, foo->memberIndex("Z"));
+	EXPECT_EQ(foo->members().size(), foo->memberIndex("W"));
+
+	shared_type wide = build_wide_type("member_index_wide", 100);
+	ASSERT_TRUE(wide);
+	ASSERT_EQ(100u, wide->members().size());
+	for (size_t i = 0; i < wide->members().size(); ++i)
+	{
+		EXPECT_EQ(i, wide->memberIndex(wide->members()[i]->name()));
+	}
+	EXPECT_EQ(wide->members().size(), wide->memberIndex("member_100"));
+
+	// Duplicate names resolve to the first member as the linear scan did
+	type_info::builder builder;
+	shared_type twice = builder.create<Wide>("member_index_twice");
+	builder.addMember("value", &Wide::value);
+	builder.addMember("other", &Wide::value);
+	builder.addMember("value", &Wide::value);
+	EXPECT_EQ(twice, builder.finalize());
+	EXPECT_EQ(0u, twice->memberIndex("value"));
+	EXPECT_EQ(1u, twice->memberIndex("other"));
+
+	type_info::clear_registrar();
+}
+
+TEST(reflection_type, fields)
+{
+	shared_type foo = type_of<Foo>();
+	const type_info::field_list& fields = foo->fields();
+	ASSERT_EQ(4u, fields.size());
+
+	EXPECT_EQ(offsetof(Foo, bar), fields[0].offset);
+	EXPECT_EQ(sizeof(Bar), fields[0].size);
+	EXPECT_EQ(primitive_kind::composite, fields[0].kind);
+	EXPECT_EQ(offsetof(Foo, x), fields[1].offset);
+	EXPECT_EQ(primitive_kind::int32, fields[1].kind);
+	EXPECT_EQ(offsetof(Foo, y), fields[2].offset);
+	EXPECT_EQ(primitive_kind::float32, fields[2].kind);
+	EXPECT_EQ(offsetof(Foo, z), fields[3].offset);
+	EXPECT_EQ(sizeof(marbles::uint64_t), fields[3].size);
+	EXPECT_EQ(primitive_kind::uint64, fields[3].kind);
+	for (const field_descriptor& field : fields)
+	{
+		EXPECT_EQ(foo->memberIndex(foo->members()[field.member]->name()), field.member);
+	}
+
+	// Walk the primitive fields with pointer arithmetic alone
+	Foo source;
+	source.x = 7;
+	source.y = 0.5f;
+	source.z = 1ull << 40;
+	Foo copy;
+	for (const field_descriptor& field : fields)
+	{
+		if (primitive_kind::composite != field.kind)
+		{
+			memcpy(reinterpret_cast<char*>(&copy) + field.offset, reinterpret_cast<const char*>(&source) + field.offset, field.size);
+		}
+	}
+	EXPECT_EQ(source.x, copy.x);
+	EXPECT_EQ(source.y, copy.y);
+	EXPECT_EQ(source.z, copy.z);
+
+	shared_type bar = type_of<Bar>();
+	ASSERT_EQ(4u, bar->fields().size());
+	EXPECT_EQ(primitive_kind::pointer, bar->fields()[0].kind);
+	EXPECT_EQ(primitive_kind::composite, bar->fields()[2].kind);
+
+	EXPECT_EQ(primitive_kind::boolean, primitive_kind_of<const bool>());
+	EXPECT_EQ(primitive_kind::int8, primitive_kind_of<signed char>());
+	EXPECT_EQ(primitive_kind::uint16, primitive_kind_of<unsigned short>());
+	EXPECT_EQ(primitive_kind::float64, primitive_kind_of<double>());
+	EXPECT_EQ(primitive_kind::composite, primitive_kind_of<marbles::string>());
+
+	type_info::clear_registrar();
+}
+
+TEST(reflection_type, traits)
+{
+	EXPECT_TRUE(type_of<int>()->isTriviallyCopyable());
+	EXPECT_TRUE(type_of<int>()->isTriviallyComparable());
+	EXPECT_TRUE(type_of<float>()->isTriviallyCopyable());
+	EXPECT_FALSE(type_of<float>()->isTriviallyComparable()); // -0.0f == 0.0f
+	EXPECT_TRUE(type_of<Wide>()->isTriviallyComparable());
+	EXPECT_FALSE(type_of<marbles::string>()->isTriviallyCopyable());
+	EXPECT_FALSE(type_of<Foo>()->isTriviallyCopyable());
+	EXPECT_FALSE(type_of<Foo>()->isTriviallyComparable());
+
+	EXPECT_TRUE(is_equality_comparable<marbles::string>::value);
+	EXPECT_FALSE(is_equality_comparable<Foo>::value);
+	EXPECT_FALSE(is_equality_comparable< marbles::vector<Foo> >::value);
+	EXPECT_FALSE(is_trivially_comparable<marbles::string>::value);
+
+	type_info::clear_registrar();
+}
+
+TEST(reflection_type, static_type)
+{
+	// Evaluated from the REFLECT_TYPE definition at compile time
+	typedef static_type<Foo> foo;
+	static_assert(sizeof(Foo) == foo::info.size, "size");
+	static_assert(alignof(Foo) == foo::info.alignment, "alignment");
+	static_assert(marbles::hash::djb2("Foo") == foo::info.hash, "hash");
+	static_assert(4 == foo::info.memberCount && 4 == foo::info.fieldCount, "members");
+	static_assert(marbles::hash::djb2("X") == foo::info.members[1].hash, "member hash");
+	static_assert(primitive_kind::uint64 == foo::info.members[3].kind, "member kind");
+	static_assert(&static_type_of<const Foo*>() == &foo::info, "by value");
+	static_assert(0 == static_type< marbles::shared_ptr<Foo> >::info.hash, "template names are registered");
+	static_assert(primitive_kind::int32 == static_type<marbles::int32_t>::info.kind, "primitive");
+
+	// The registered type refers to the same data
+	shared_type type = type_of<Foo>();
+	ASSERT_TRUE(type);
+	EXPECT_EQ(&foo::info, type->staticInfo());
+	EXPECT_EQ(foo::info.hash, type->hashName());
+	EXPECT_EQ(type, type_info::find(foo::info.hash));
+	EXPECT_STREQ(foo::info.name, type->name());
+	ASSERT_EQ(foo::info.memberCount, type->members().size());
+	ASSERT_EQ(foo::info.fieldCount, type->fields().size());
+	for (uint32_t i = 0; i < foo::info.memberCount; ++i)
+	{
+		EXPECT_STREQ(foo::info.members[i].name, type->members()[i]->name());
+		EXPECT_EQ(foo::info.members[i].hash, type->members()[i]->hashName());
+		EXPECT_EQ(i, type->memberIndex(foo::info.members[i].hash));
+		EXPECT_EQ(foo::info.members[i].size, type->fields()[i].size);
+		EXPECT_EQ(foo::info.members[i].kind, type->fields()[i].kind);
+	}
+
+	// Class templates are named from their registered parameters
+	shared_type shared = type_of< marbles::shared_ptr<Foo> >();
+	ASSERT_TRUE(shared);
+	EXPECT_STREQ("marbles::shared_ptr<Foo>", shared->name());
+	EXPECT_EQ(type_info::hash("marbles::shared_ptr<Foo>"), shared->hashName());
+	EXPECT_EQ(&static_type< marbles::shared_ptr<Foo> >::info, shared->staticInfo());
+
+	// Types built at runtime have no static data
+	type_info::builder builder;
+	shared_type runtime = builder.create("RuntimeOnly");
+	ASSERT_TRUE(runtime);
+	EXPECT_EQ(NULL, runtime->staticInfo());
+	EXPECT_EQ(type_info::hash("RuntimeOnly"), runtime->hashName());
+
+	type_info::clear_registrar();
+}
+
+TEST(reflection_type, registry)
+{
+	static const int num_types = 1000;
+	static const int num_readers = 3;
+	marbles::vector<marbles::string> names;
+	for (int i = 0; i < num_types; ++i)
+	{
+		marbles::stringstream ss;
+		ss << "registry_" << i;
+		names.push_back(ss.str());
+	}
+
+	// Readers look types up while the writer registers them, a type once found must stay found
+	marbles::atomic<bool> done(false);
+	marbles::atomic<int> lost(0);
+	std::thread readers[num_readers];
+	for (auto& reader : readers)
+	{
+		std::thread worker([&names, &done, &lost]()
+		{
+			marbles::vector<bool> seen(names.size(), false);
+			while (!done.load())
+			{
+				for (size_t i = 0; i < names.size(); ++i)
+				{
+					const bool found = nullptr != type_info::find(names[i].c_str());
+					if (seen[i] && !found)
+					{
+						lost.fetch_add(1);
+					}
+					seen[i] = seen[i] || found;
+				}
+			}
+		});
+		reader.swap(worker);
+	}
+
+	for (const marbles::string& name : names)
+	{
+		type_info::builder builder;
+		EXPECT_TRUE(builder.create<Wide>(name.c_str()));
+		EXPECT_TRUE(builder.finalize());
+	}
+	done.store(true);
+	for (auto& reader : readers)
+	{
+		reader.join();
+	}
+	EXPECT_EQ(0, lost.load());
+
+	size_t listed = 0;
+	for (const shared_type& type : type_info::registered())
+	{
+		listed += 0 == strncmp(type->name(), "registry_", 9) ? 1 : 0;
+	}
+	EXPECT_EQ(names.size(), listed);
+
+	for (const marbles::string& name : names)
+	{
+		shared_type type = type_info::find(name.c_str());
+		ASSERT_TRUE(type);
+		EXPECT_STREQ(name.c_str(), type->name());
+	}
+
+	// Registering a name twice fails and keeps the first type
+	shared_type first = type_info::find("registry_0");
+	type_info::builder duplicate;
+	EXPECT_FALSE(duplicate.create<Wide>("registry_0"));
+	EXPECT_EQ(first, type_info::find("registry_0"));
+
+	type_info::clear_registrar();
+	EXPECT_FALSE(type_info::find("registry_0"));
+}
+
+TEST(reflection_type, find_while_defining)
+{
+	static const int num_types = 200;
+	static const size_t num_members = 40;
+	static const int num_readers = 3;
+	marbles::vector<marbles::string> names;
+	for (int i = 0; i < num_types; ++i)
+	{
+		marbles::stringstream ss;
+		ss << "defining_" << i;
+		names.push_back(ss.str());
+	}
+
+	// A type found while others are still being defined must already be complete
+	marbles::atomic<bool> done(false);
+	marbles::atomic<int> partial(0);
+	std::thread readers[num_readers];
+	for (auto& reader : readers)
+	{
+		std::thread worker([&names, &done, &partial]()
+		{
+			while (!done.load())
+			{
+				for (const marbles::string& name : names)
+				{
+					shared_type type = type_info::find(name.c_str());
+					if (type && (num_members != type->members().size() || num_members != type->fields().size() ||
+						sizeof(Wide) != type->size() || primitive_kind::composite != type->kind() || 
+						num_members - 1 != type->memberIndex("member_39")))
+					{
+						partial.fetch_add(1);
+					}
+				}
+			}
+		});
+		reader.swap(worker);
+	}
+
+	for (const marbles::string& name : names)
+	{
+		EXPECT_TRUE(build_wide_type(name.c_str(), num_members));
+	}
+	done.store(true);
+	for (auto& reader : readers)
+	{
+		reader.join();
+	}
+	EXPECT_EQ(0, partial.load());
+
+	// Unfinalized types are never registered
+	type_info::builder pending;
+	shared_type unfinished = pending.create<Wide>("defining_pending");
+	EXPECT_TRUE(unfinished);
+	EXPECT_FALSE(type_info::find("defining_pending"));
+	EXPECT_EQ(unfinished, pending.finalize());
+	EXPECT_EQ(unfinished, type_info::find("defining_pending"));
+
+	type_info::clear_registrar();
+}
+
+TEST(reflection_type_benchmark, member_index)
+{
+	member_index_benchmark(5);
+	member_index_benchmark(50);
+	member_index_benchmark(500);
+	type_info::clear_registrar();
+}
+
+TEST(reflection_type, lazy_registration)
+{
+	type_info::clear_registrar();
+	EXPECT_FALSE(type_info::find("Foo"));
+
+	// Concurrent first requests build the type once, Foo and Bar refer to each other while being built
+	static const int num_threads = 8;
+	shared_type seen[num_threads];
+	marbles::atomic<bool> go(false);
+	std::thread threads[num_threads];
+	for (int i = 0; i < num_threads; ++i)
+	{
+		std::thread worker([&go, &seen, i]()
+		{
+			while (!go.load())
+			{
+				std::this_thread::yield();
+			}
+			seen[i] = 0 == i % 2 ? type_of<Foo>() : type_of<Bar>()->members()[1]->typeInfo();
+		});
+		threads[i].swap(worker);
+	}
+	go.store(true);
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	shared_type foo = type_of<Foo>();
+	ASSERT_TRUE(foo);
+	EXPECT_EQ(foo, type_info::find("Foo"));
+	for (const shared_type& type : seen)
+	{
+		EXPECT_EQ(foo, type);
+	}
+	EXPECT_EQ(type_of<Bar>(), foo->members()[0]->typeInfo());
+
+	// Clearing the registrar makes the next request build and register the type again
+	type_info::clear_registrar();
+	shared_type rebuilt = type_of<Foo>();
+	ASSERT_TRUE(rebuilt);
+	EXPECT_NE(foo, rebuilt);
+	EXPECT_EQ(rebuilt, type_info::find("Foo"));
+	EXPECT_EQ(rebuilt, type_of<Foo>());
+
+	type_info::clear_registrar();
+}
+
+namespace
+{
+// Requests every type the reflection library and these tests reflect
+void request_types()
+{
+	type_of<bool>();
+	type_of<marbles::int8_t>();
+	type_of<marbles::int16_t>();
+	type_of<marbles::int32_t>();
+	type_of<marbles::int64_t>();
+	type_of<marbles::uint8_t>();
+	type_of<marbles::uint16_t>();
+	type_of<marbles::uint32_t>();
+	type_of<marbles::uint64_t>();
+	type_of<float>();
+	type_of<double>();
+	type_of<marbles::string>();
+	type_of<object>();
+	type_of<marbles::allocator_stats>();
+	type_of< marbles::shared_ptr<Foo> >();
+	type_of<Foo>();
+	type_of<Bar>();
+	type_of<Wide>();
+}
+} // namespace <>
+
+TEST(reflection_type_benchmark, registration)
+{
+	static const int num_passes = 20;
+	static const int num_lookups = 100000;
+
+	// Cold start, every type is built and registered on its first request
+	double cold = 0.0;
+	size_t registered = 0;
+	for (int pass = 0; pass < num_passes; ++pass)
+	{
+		type_info::clear_registrar();
+		auto start = marbles::chrono::high_resolution_clock::now();
+		request_types();
+		cold += marbles::chrono::duration<double, std::milli>(marbles::chrono::high_resolution_clock::now() - start).count();
+		registered = type_info::registered().size();
+	}
+
+	// Warm, published types are returned without building or locking
+	size_t found = 0;
+	auto start = marbles::chrono::high_resolution_clock::now();
+	for (int i = 0; i < num_lookups; ++i)
+	{
+		found += type_of<Foo>() ? 1 : 0;
+	}
+	marbles::chrono::duration<double, std::milli> warm = marbles::chrono::high_resolution_clock::now() - start;
+
+	EXPECT_EQ(static_cast<size_t>(num_lookups), found);
+	::testing::Test::RecordProperty("types", static_cast<int>(registered));
+	::testing::Test::RecordProperty("registration_us", static_cast<int>(1000.0 * (cold / num_passes)));
+	::testing::Test::RecordProperty("lookups", num_lookups);
+	::testing::Test::RecordProperty("lookup_us", static_cast<int>(1000.0 * warm.count()));
+
+	type_info::clear_registrar();
+}
+
+// End of file --------------------------------------------------------------------------------------------------------